@@ -0,0 +1,142 @@
+#include "ads1220.h"
+
+// commands
+#define ADS1220_CMD_RESET 0x06
+#define ADS1220_CMD_START 0x08
+#define ADS1220_CMD_POWERDOWN 0x02
+#define ADS1220_CMD_WREG 0x40
+#define ADS1220_NOP 0xFF
+
+// output data rates by DR bits
+static const uint16_t normalRates[] = {20, 45, 90, 175, 330, 600, 1000};
+static const uint16_t turboRates[] = {40, 90, 180, 350, 660, 1200, 2000};
+static const byte rateCount = sizeof(normalRates) / sizeof(normalRates[0]);
+
+ADS1220::ADS1220(SPIClass &spi) : LoadCellADC(ADS1220_DEFAULT_SPS), spi(spi)
+{
+  deferredReadout = true;
+}
+
+void ADS1220::begin(byte cs, byte drdy, byte gain, uint16_t sps)
+{
+  CS = cs;
+  DRDY = drdy;
+
+  pinMode(CS, OUTPUT);
+  digitalWrite(CS, HIGH);
+  pinMode(DRDY, INPUT);
+  spi.begin();
+
+  command(ADS1220_CMD_RESET);
+  delay(1);
+  started = true;
+  set_gain(gain);
+  set_rate(sps);
+
+  begin_supervision();
+}
+
+bool ADS1220::is_ready()
+{
+  return digitalRead(DRDY) == LOW;
+}
+
+void ADS1220::set_rate(uint16_t sps)
+{
+  // closest rate, the normal mode wins a tie because of its lower noise
+  uint16_t best = normalRates[0];
+  dataRate = 0;
+  turbo = false;
+  for (byte mode = 0; mode < 2; mode++)
+  {
+    const uint16_t *rates = mode == 0 ? normalRates : turboRates;
+    for (byte i = 0; i < rateCount; i++)
+    {
+      if (abs((int)rates[i] - (int)sps) < abs((int)best - (int)sps))
+      {
+        best = rates[i];
+        dataRate = i;
+        turbo = mode == 1;
+      }
+    }
+  }
+
+  set_nominal_rate(best);
+  write_config();
+}
+
+void ADS1220::set_gain(byte gain)
+{
+  GAIN = 1;
+  while (GAIN < 128 && GAIN * 2 <= gain)
+  {
+    GAIN *= 2;
+  }
+  write_config();
+}
+
+void ADS1220::power_down()
+{
+  command(ADS1220_CMD_POWERDOWN);
+}
+
+void ADS1220::power_up()
+{
+  command(ADS1220_CMD_START);
+}
+
+long ADS1220::read_raw()
+{
+  // in continuous conversion mode the result is shifted out directly, no RDATA needed
+  uint8_t data[3];
+  spi.beginTransaction(SPISettings(ADS1220_SPI_CLOCK_HZ, MSBFIRST, SPI_MODE1));
+  digitalWrite(CS, LOW);
+  data[0] = spi.transfer(ADS1220_NOP);
+  data[1] = spi.transfer(ADS1220_NOP);
+  data[2] = spi.transfer(ADS1220_NOP);
+  digitalWrite(CS, HIGH);
+  spi.endTransaction();
+
+  return word_to_sample(data);
+}
+
+// private
+void ADS1220::command(byte cmd)
+{
+  spi.beginTransaction(SPISettings(ADS1220_SPI_CLOCK_HZ, MSBFIRST, SPI_MODE1));
+  digitalWrite(CS, LOW);
+  spi.transfer(cmd);
+  digitalWrite(CS, HIGH);
+  spi.endTransaction();
+}
+
+void ADS1220::write_config()
+{
+  if (!started)
+    return;
+
+  byte gainBits = 0;
+  while ((1 << gainBits) < GAIN)
+  {
+    gainBits++;
+  }
+
+  byte config[4];
+  config[0] = gainBits << 1;                                // MUX AIN0/AIN1, PGA enabled
+  config[1] = dataRate << 5 | (turbo ? 0x10 : 0x00) | 0x04; // DR, MODE, continuous conversion
+  config[2] = 0x40;                                         // external reference REFP0/REFN0
+  config[3] = 0x00;                                         // no IDACs, DRDY pin only
+
+  spi.beginTransaction(SPISettings(ADS1220_SPI_CLOCK_HZ, MSBFIRST, SPI_MODE1));
+  digitalWrite(CS, LOW);
+  spi.transfer(ADS1220_CMD_WREG | 3); // registers 0 to 3
+  for (byte i = 0; i < 4; i++)
+  {
+    spi.transfer(config[i]);
+  }
+  digitalWrite(CS, HIGH);
+  spi.endTransaction();
+
+  // a write restarts the conversion
+  command(ADS1220_CMD_START);
+}
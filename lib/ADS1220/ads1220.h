@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+
+#include "loadcell_adc.h"
+
+#define ADS1220_SPI_CLOCK_HZ 2000000
+#define ADS1220_DEFAULT_SPS 1000
+
+// TI ADS1220, 24-bit delta-sigma ADC with PGA, read out by SPI at up to 2000 SPS.
+// The bridge is connected to AIN0/AIN1 and its excitation to REFP0/REFN0, so the
+// measurement is ratiometric like with the HX711. The chip runs in continuous
+// conversion mode and DRDY goes low for every new conversion.
+// SPIClass is not safe in an interrupt, poll() reads the conversion out.
+class ADS1220 : public LoadCellADC
+{
+private:
+  SPIClass &spi;
+  byte CS;              // chip select pin
+  byte GAIN = 128;      // PGA gain
+  bool turbo = false;   // turbo mode doubles the rates of the normal mode
+  byte dataRate = 0;    // DR bits of config register 1
+  bool started = false; // registers are only written after begin()
+
+  // send a single command byte
+  void command(byte cmd);
+
+  // write the four configuration registers
+  void write_config();
+
+protected:
+  long read_raw() override;
+
+public:
+  // spi: bus the chip is connected to, must not be shared with the display
+  ADS1220(SPIClass &spi = SPI);
+
+  // Reset the chip, configure it and start the continuous conversion.
+  // gain: 1, 2, 4, 8, 16, 32, 64 or 128; sps: see set_rate()
+  void begin(byte cs, byte drdy, byte gain = 128, uint16_t sps = ADS1220_DEFAULT_SPS);
+
+  // Check if a conversion is ready, DRDY is low until it is read out
+  bool is_ready() override;
+
+  // Select the output data rate closest to sps:
+  // normal mode 20, 45, 90, 175, 330, 600, 1000 SPS, turbo mode 40 ... 2000 SPS.
+  // Call it before the capture is started, the conversion restarts.
+  void set_rate(uint16_t sps);
+
+  // set the PGA gain, rounded down to a power of two
+  void set_gain(byte gain = 128) override;
+
+  // stops the conversion and puts the chip into power down mode
+  void power_down() override;
+
+  // wakes up the chip and starts the conversion again
+  void power_up() override;
+};
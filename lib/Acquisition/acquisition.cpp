@@ -0,0 +1,387 @@
+#include "acquisition.h"
+
+#include "esp_timer.h"
+
+bool Acquisition::begin(LoadCellADC *cell, BaseType_t core, UBaseType_t priority)
+{
+  loadcell = cell;
+  BaseType_t result = xTaskCreatePinnedToCore(task, "acquisition", ACQ_TASK_STACK, this, priority, &taskHandle, core);
+  return result == pdPASS;
+}
+
+void Acquisition::task(void *arg)
+{
+  Acquisition *self = static_cast<Acquisition *>(arg);
+  self->zeroTracker.set_reference(self->loadcell->get_zeropoint_offset());
+  self->update_zero_limits();
+  if (self->statePeriod == 0)
+  {
+    uint32_t samples = (uint32_t)self->loadcell->get_rate() * ACQ_STATE_PERIOD_MS / 1000;
+    self->statePeriod = samples < 1 ? 1 : samples > LOADCELL_BLOCK_SIZE ? LOADCELL_BLOCK_SIZE : samples;
+  }
+  self->loadcell->begin_capture(xTaskGetCurrentTaskHandle());
+
+  for (;;)
+  {
+    // sleep until the next sample, but not past the moment it is overdue
+    int64_t wait = self->loadcell->get_health_deadline() - esp_timer_get_time();
+    TickType_t ticks = wait > 0 ? pdMS_TO_TICKS(wait / 1000) + 1 : 1;
+    if (ticks > pdMS_TO_TICKS(ACQ_TASK_WAIT_MS))
+      ticks = pdMS_TO_TICKS(ACQ_TASK_WAIT_MS);
+    ulTaskNotifyTake(pdTRUE, ticks);
+
+    self->apply_calibration();
+    LoadCellBlock block;
+    for (;;)
+    {
+      if (self->statePosition == 0)
+        self->apply_state();
+      // a block ends with the state period at the latest
+      if (self->loadcell->poll_block(block, self->statePeriod - self->statePosition) == 0)
+        break;
+      self->process(block);
+    }
+    self->check_health();
+  }
+}
+
+void Acquisition::check_health()
+{
+  LoadCellHealth state = loadcell->get_health();
+  LoadCellHealth previous = health.exchange(state);
+  if (state != LOADCELL_HEALTH_OK && previous == LOADCELL_HEALTH_OK && faultCallback != NULL)
+    faultCallback(state);
+}
+
+void Acquisition::apply_calibration()
+{
+  CalibrationCommand command = calibrationCommand.load(std::memory_order_acquire);
+  bool result = true;
+  switch (command)
+  {
+  case CALIBRATION_ZERO:
+    // clears the correction, the tracking starts over from the new zero point
+    loadcell->set_zeropoint_offset(calibrationValue);
+    zeroTracker.set_reference(calibrationValue);
+    zeroCorrection = 0;
+    break;
+  case CALIBRATION_SCALE_CURRENT:
+    result = calibrationValue != 0;
+    if (result)
+      loadcell->set_scale_current(calibrationValue);
+    break;
+  case CALIBRATION_ADD_POINT:
+    result = loadcell->add_calibration_point(calibrationValue);
+    break;
+  case CALIBRATION_CLEAR_TABLE:
+    loadcell->clear_calibration_table();
+    break;
+  default:
+    return;
+  }
+  update_zero_limits();
+  calibrationResult = result;
+  calibrationCommand.store(CALIBRATION_NONE, std::memory_order_release);
+}
+
+void Acquisition::process(const LoadCellBlock &block)
+{
+  if (resetRequested.exchange(false))
+  {
+    maxForce = 0;
+    maxForceMilli = 0;
+    compensatedMaxForce = 0;
+    peak.reset();
+    hasMinForceReached = false;
+    breakDetectionStart = 0;
+    breakDetected = false;
+    loadcell->reset_sample_stats();
+    capture.arm();
+    testRecord.clear();
+  }
+
+  for (size_t i = 0; i < block.count; i++)
+  {
+    process(block, i);
+  }
+  sampleCount += block.count;
+  statePosition = (statePosition + block.count) % statePeriod;
+}
+
+void Acquisition::process(const LoadCellBlock &block, size_t i)
+{
+  ForceSample sample;
+  sample.seq = block.seq[i];
+  sample.raw = block.raw[i];
+  sample.reading = block.reading[i];
+  sample.force = block.force[i];
+  sample.rate = block.rate[i];
+  sample.timestamp = block.timestamp[i];
+
+  float *record = recordBuffer.load(std::memory_order_acquire);
+  if (record != NULL)
+  {
+    record[recordIndex++] = sample.raw;
+    if (recordIndex >= recordSize)
+    {
+      recordBuffer = NULL;
+      recordDone.store(true, std::memory_order_release);
+    }
+  }
+
+  peak.update(sample.force, block.unfiltered[i], sample.rate, block.rateVariance[i]);
+  maxForce = peak.get_filtered_max();
+  compensatedMaxForce = peak.get_compensated_max();
+  if (maxForceMilli < block.forceMilli[i])
+    maxForceMilli = block.forceMilli[i];
+
+  if (zeroTrackingActive)
+    zeroTracker.update(sample.reading, sample.timestamp);
+
+  capture.push(sample);
+  if (testingActive)
+  {
+    testRecord.push(block.unfiltered[i], sample.timestamp);
+    detect_break(block, i);
+  }
+
+  if (queue.push(sample))
+  {
+    uint32_t waiting = queue.available();
+    if (waiting > queueHighWater)
+      queueHighWater = waiting;
+  }
+}
+
+void Acquisition::detect_break(const LoadCellBlock &block, size_t i)
+{
+  if (breakDetected)
+    return;
+
+  int32_t force = block.forceMilli[i];
+  int64_t timestamp = block.timestamp[i];
+  float rate = block.rate[i];
+
+  // overcome minimum force to rule out noise
+  if (force > minForceForBreak)
+  {
+    hasMinForceReached = true;
+  }
+  // low force triggers break detection
+  if (hasMinForceReached && (int64_t)force * 65536 < (int64_t)maxForceMilli * breakLevel)
+  {
+    if (breakDetectionStart == 0)
+      breakDetectionStart = timestamp;
+  }
+  else
+  { // break detection is reset, when a higher force is measured
+    breakDetectionStart = 0;
+  }
+
+  // the force stayed low long enough, independent of the sample rate
+  bool isBreak = breakDetectionStart != 0 && timestamp - breakDetectionStart >= breakDetectionMinTime;
+
+  // the force drops significantly faster than any regular unloading
+  if (breakRate > 0 && hasMinForceReached && rate < -breakRate && rate * rate > 9 * block.rateVariance[i])
+    isBreak = true;
+
+  if (isBreak)
+  {
+    breakDetected = true;
+    capture.trigger();
+    if (breakCallback != NULL)
+      breakCallback();
+  }
+}
+
+void Acquisition::apply_state()
+{
+  testingActive = testing;
+  // the switch is bumpless
+  loadcell->set_filter_profile(testingActive ? FILTER_PROFILE_TEST : FILTER_PROFILE_IDLE);
+  // the lag of the filter the next samples go through
+  peak.set_delay(loadcell->get_filter_delay());
+
+  if (!zeroTrackerReady)
+    return;
+  zeroTrackingActive = zeroTracking && !testingActive;
+  if (!zeroTrackingActive)
+  {
+    zeroTracker.hold();
+    return;
+  }
+  // tracked over the last period, applies to the next one
+  float correction = zeroTracker.get_correction();
+  loadcell->set_zero_correction(correction);
+  zeroCorrection = correction;
+}
+
+void Acquisition::update_zero_limits()
+{
+  float sensitivity = fabsf(loadcell->get_sensitivity());
+  zeroTracker.set_limits(zeroMaxStddev * sensitivity, zeroBand * sensitivity, zeroMaxCorrection * sensitivity,
+                         zeroMaxRate * sensitivity);
+}
+
+bool Acquisition::pop(ForceSample &sample)
+{
+  return queue.pop(sample);
+}
+
+void Acquisition::set_break_detection(float minForce, float forceDrop, uint32_t minTime)
+{
+  minForceForBreak = lroundf(minForce * 1000);
+  breakLevel = lroundf((1 - forceDrop) * 65536);
+  breakDetectionMinTime = minTime * 1000;
+}
+
+void Acquisition::set_break_rate(float rate)
+{
+  breakRate = rate;
+}
+
+void Acquisition::on_break(void (*callback)())
+{
+  breakCallback = callback;
+}
+
+bool Acquisition::set_break_capture(size_t pre, size_t post)
+{
+  return capture.begin(pre, post);
+}
+
+const BreakCapture &Acquisition::get_break_capture()
+{
+  return capture;
+}
+
+bool Acquisition::set_test_record(size_t samples)
+{
+  return testRecord.begin(samples);
+}
+
+const TestRecorder &Acquisition::get_test_record()
+{
+  return testRecord;
+}
+
+void Acquisition::on_fault(void (*callback)(LoadCellHealth health))
+{
+  faultCallback = callback;
+}
+
+LoadCellHealth Acquisition::get_health()
+{
+  return health;
+}
+
+bool Acquisition::set_zero_tracking(uint16_t window, float maxStddev, float band, float maxCorrection, float maxRate)
+{
+  zeroMaxStddev = maxStddev;
+  zeroBand = band;
+  zeroMaxCorrection = maxCorrection;
+  zeroMaxRate = maxRate;
+  zeroTrackerReady = zeroTracker.begin(window);
+  return zeroTrackerReady;
+}
+
+void Acquisition::enable_zero_tracking(bool enable)
+{
+  zeroTracking = enable;
+}
+
+float Acquisition::get_zero_correction()
+{
+  return zeroCorrection;
+}
+
+bool Acquisition::calibrate(CalibrationCommand command, float value)
+{
+  if (is_calibration_pending())
+    return false;
+  calibrationValue = value;
+  // hand the value over to the acquisition task
+  calibrationCommand.store(command, std::memory_order_release);
+  return true;
+}
+
+bool Acquisition::is_calibration_pending()
+{
+  return calibrationCommand.load(std::memory_order_acquire) != CALIBRATION_NONE;
+}
+
+bool Acquisition::get_calibration_result()
+{
+  return !is_calibration_pending() && calibrationResult;
+}
+
+void Acquisition::set_testing(bool isTesting)
+{
+  testing = isTesting;
+}
+
+void Acquisition::set_state_period(uint8_t samples)
+{
+  statePeriod = samples > LOADCELL_BLOCK_SIZE ? LOADCELL_BLOCK_SIZE : samples;
+}
+
+void Acquisition::reset_test()
+{
+  // applied by the acquisition task before the next sample
+  resetRequested = true;
+  breakDetected = false;
+  maxForce = 0;
+  compensatedMaxForce = 0;
+}
+
+bool Acquisition::is_break_detected()
+{
+  return breakDetected;
+}
+
+float Acquisition::get_max_force()
+{
+  return maxForce;
+}
+
+float Acquisition::get_compensated_max_force()
+{
+  return compensatedMaxForce;
+}
+
+bool Acquisition::record_raw(float *buffer, uint16_t count)
+{
+  if (recordBuffer != NULL || count == 0)
+    return false;
+  recordDone = false;
+  recordSize = count;
+  recordIndex = 0;
+  // hand the buffer over to the acquisition task
+  recordBuffer.store(buffer, std::memory_order_release);
+  return true;
+}
+
+bool Acquisition::is_record_done()
+{
+  return recordDone.load(std::memory_order_acquire);
+}
+
+uint32_t Acquisition::get_sample_count()
+{
+  return sampleCount;
+}
+
+uint32_t Acquisition::get_dropped()
+{
+  return queue.get_dropped();
+}
+
+uint32_t Acquisition::get_capture_dropped()
+{
+  return loadcell->get_capture_dropped();
+}
+
+uint32_t Acquisition::get_queue_high_water()
+{
+  return queueHighWater;
+}
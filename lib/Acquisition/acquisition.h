@@ -0,0 +1,241 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+#include "break_capture.h"
+#include "force_sample.h"
+#include "freertos/task.h"
+#include "loadcell_adc.h"
+#include "peak_tracker.h"
+#include "sample_ring.h"
+#include "test_recorder.h"
+#include "zero_tracker.h"
+
+// The acquisition task runs on the core that does not run loop(), so LVGL redraws
+// can not delay sampling or break detection.
+#ifndef ACQ_TASK_CORE
+#define ACQ_TASK_CORE (ARDUINO_RUNNING_CORE == 0 ? 1 : 0)
+#endif
+#define ACQ_TASK_PRIORITY 5
+#define ACQ_TASK_STACK 6144 // room for a LoadCellBlock and the pipeline buffers
+// wake up at least this often, even without samples
+#define ACQ_TASK_WAIT_MS 100
+// default time between the points where set_testing() and the zero tracking take
+// effect, see Acquisition::set_state_period()
+#define ACQ_STATE_PERIOD_MS 10
+
+// changes of the loadcell calibration, see Acquisition::calibrate()
+enum CalibrationCommand : uint8_t
+{
+  CALIBRATION_NONE,
+  CALIBRATION_ZERO,          // zero point to value, in raw reading units
+  CALIBRATION_SCALE_CURRENT, // scale from the last readings at the known force value
+  CALIBRATION_ADD_POINT,     // point of the multi-point calibration at the known force value
+  CALIBRATION_CLEAR_TABLE,   // drop the multi-point calibration
+};
+
+class Acquisition
+{
+private:
+  LoadCellADC *loadcell = NULL;
+  TaskHandle_t taskHandle = NULL;
+
+  // samples for the UI task
+  static const size_t queueSize = 64;
+  SampleRing<ForceSample, queueSize> queue;
+  std::atomic<uint32_t> queueHighWater{0};
+  std::atomic<uint32_t> sampleCount{0};
+
+  // break detection, only touched by the acquisition task
+  std::atomic<bool> testing{false};
+  std::atomic<bool> resetRequested{false};
+  std::atomic<bool> breakDetected{false};
+  std::atomic<float> maxForce{0};
+  std::atomic<float> compensatedMaxForce{0};
+  PeakTracker peak; // maximum force with and without the lag of the filter
+  bool hasMinForceReached = false;
+  int64_t breakDetectionStart = 0; // timestamp of the first reading below the threshold
+  // in 1/1000 force units like LoadCellBlock::forceMilli, the comparisons are integer
+  int32_t maxForceMilli = 0;
+  int32_t minForceForBreak = 100000;
+  int32_t breakLevel = 13107; // 1 - force drop with 16 fraction bits
+  uint32_t breakDetectionMinTime = 400000; // in us
+  float breakRate = 0;                     // a faster drop in force units per s is a break, 0 = off
+  void (*breakCallback)() = NULL;
+  BreakCapture capture; // samples around the break
+  TestRecorder testRecord; // unfiltered force of the whole test
+
+  // diagnostics recording of raw readings, see record_raw()
+  std::atomic<float *> recordBuffer{NULL};
+  uint16_t recordSize = 0;
+  uint16_t recordIndex = 0;
+  std::atomic<bool> recordDone{false};
+
+  // calibration change of the UI, applied by the acquisition task between two blocks
+  std::atomic<CalibrationCommand> calibrationCommand{CALIBRATION_NONE};
+  float calibrationValue = 0;
+  bool calibrationResult = true; // published with calibrationCommand
+
+  // automatic zero tracking while idle, the task is the only writer of the zero point
+  ZeroTracker zeroTracker;
+  bool zeroTrackerReady = false;
+  // limits in force units, converted with the calibration by update_zero_limits()
+  float zeroMaxStddev = 0;
+  float zeroBand = 0;
+  float zeroMaxCorrection = 0;
+  float zeroMaxRate = 0;
+  std::atomic<bool> zeroTracking{false};
+  std::atomic<float> zeroCorrection{0};
+
+  // State changes of the UI and the zero correction take effect every statePeriod
+  // samples, and no block crosses that point, so the results do not depend on how the
+  // capture ring splits the samples into blocks.
+  uint8_t statePeriod = 0;   // samples, see set_state_period()
+  uint8_t statePosition = 0; // samples since the start of the state period
+  bool testingActive = false; // testing as of the start of the state period
+  bool zeroTrackingActive = false;
+
+  // sensor supervision
+  std::atomic<LoadCellHealth> health{LOADCELL_HEALTH_STALE};
+  void (*faultCallback)(LoadCellHealth health) = NULL;
+
+  static void task(void *arg);
+
+  // evaluate the readings of a block of samples, oldest first
+  void process(const LoadCellBlock &block);
+
+  void process(const LoadCellBlock &block, size_t i);
+
+  void detect_break(const LoadCellBlock &block, size_t i);
+
+  // At the start of a state period: take over set_testing() with its filter profile and
+  // enable_zero_tracking(), and apply the zero correction tracked so far.
+  void apply_state();
+
+  // limits of the zero tracking in readings, after every change of the calibration
+  void update_zero_limits();
+
+  // update the sensor health, also when the samples stop coming
+  void check_health();
+
+  // apply the pending calibrate() to the loadcell
+  void apply_calibration();
+
+public:
+  // start the acquisition task; the task owns the loadcell from now on
+  bool begin(LoadCellADC *loadcell, BaseType_t core = ACQ_TASK_CORE, UBaseType_t priority = ACQ_TASK_PRIORITY);
+
+  // UI side: fetch the oldest published sample, returns false if there is none
+  bool pop(ForceSample &sample);
+
+  // parameters of the break detection:
+  // the force has to exceed minForce first, then a drop by forceDrop (relative to the
+  // maximum force) that lasts for minTime ms of sample time is a break
+  void set_break_detection(float minForce, float forceDrop, uint32_t minTime);
+
+  // Detect a break without waiting for the minimum time when the Kalman estimate of the
+  // loading rate falls below -rate (force units per s) with 3 sigma certainty,
+  // once the minimum force was reached. 0 disables it (default).
+  void set_break_rate(float rate);
+
+  // called from the acquisition task as soon as a break is detected
+  void on_break(void (*callback)());
+
+  // Record pre samples before and post samples after the detected break, call it before
+  // begin(). The pre window has to cover the time the break detection needs to confirm.
+  // returns false if the memory is not available
+  bool set_break_capture(size_t pre, size_t post);
+
+  // samples around the last break, readable once is_frozen(); rearmed by reset_test()
+  const BreakCapture &get_break_capture();
+
+  // Record the unfiltered force of up to samples readings while testing, for an
+  // analysis after the test; call it before begin().
+  // returns false if the memory is not available
+  bool set_test_record(size_t samples);
+
+  // unfiltered force since the start of the test, cleared by reset_test()
+  const TestRecorder &get_test_record();
+
+  // Called from the acquisition task as soon as the sensor health leaves OK, at the
+  // latest half a sample period after a reading is overdue.
+  void on_fault(void (*callback)(LoadCellHealth health));
+
+  // sensor health as seen by the acquisition task
+  LoadCellHealth get_health();
+
+  // Configure the automatic zero tracking, see ZeroTracker; window in readings, the
+  // limits in force units, maxRate per s. The acquisition task converts the limits to
+  // readings with the active calibration. Call it before begin().
+  // returns false if the memory is not available
+  bool set_zero_tracking(uint16_t window, float maxStddev, float band, float maxCorrection, float maxRate);
+
+  // Track the zero point only while the machine is idle and unloaded; it is frozen
+  // while testing in any case. The correction goes to LoadCellADC::set_zero_correction()
+  // at the start of every state period, a CALIBRATION_ZERO sets the new reference and
+  // clears it.
+  void enable_zero_tracking(bool enable);
+
+  // tracked zero point minus the one from the calibration, in raw reading units
+  float get_zero_correction();
+
+  // Change the calibration of the loadcell. The acquisition task applies it between two
+  // blocks, so it never calibrates with half of it; once the task runs, the loadcell
+  // must not be changed from another task, and its calibration table is only read
+  // while no change is pending.
+  // returns false while the previous change is still pending
+  bool calibrate(CalibrationCommand command, float value = 0);
+
+  // true until the acquisition task applied the last calibrate()
+  bool is_calibration_pending();
+
+  // Whether the last calibrate() took effect, once it is no longer pending; false for
+  // a point the table rejected (full or no load) or a scale at a force of 0.
+  bool get_calibration_result();
+
+  // Break detection is only active while testing. The loadcell switches to the
+  // FILTER_PROFILE_TEST filter for the test and back to FILTER_PROFILE_IDLE after it.
+  // Takes effect with the start of the next state period.
+  void set_testing(bool testing);
+
+  // Samples per state period, 1 ... LOADCELL_BLOCK_SIZE: set_testing() and the zero
+  // correction take effect at its start, and the task processes at most one period in
+  // a block. 0 picks ACQ_STATE_PERIOD_MS worth of samples at the configured rate
+  // (default), i.e. every sample at the rates of the HX711. Call it before begin().
+  void set_state_period(uint8_t samples);
+
+  // clear the maximum force, the break detection and the sample statistics
+  void reset_test();
+
+  // true once a break was detected, cleared by reset_test()
+  bool is_break_detected();
+
+  // maximum filtered force since the last reset_test()
+  float get_max_force();
+
+  // Maximum force since the last reset_test() with the lag of the filter compensated:
+  // on a ramp the filtered force is behind by the loading rate times the group delay,
+  // so get_max_force() misses that much of the peak at the break.
+  float get_compensated_max_force();
+
+  // Record the next count raw readings into buffer, e.g. for a noise spectrum.
+  // The buffer has to stay valid until is_record_done().
+  // returns false if a recording is still running
+  bool record_raw(float *buffer, uint16_t count);
+
+  // true once the buffer of record_raw() is complete
+  bool is_record_done();
+
+  // samples processed by the acquisition task
+  uint32_t get_sample_count();
+
+  // samples the UI did not fetch in time
+  uint32_t get_dropped();
+
+  // samples lost between the DOUT interrupt and the acquisition task
+  uint32_t get_capture_dropped();
+
+  // maximum number of samples that were waiting for the UI at once
+  uint32_t get_queue_high_water();
+};
@@ -0,0 +1,110 @@
+#include "break_capture.h"
+
+#include <Arduino.h>
+
+BreakCapture::~BreakCapture()
+{
+  end();
+}
+
+bool BreakCapture::begin(size_t pre, size_t post)
+{
+  end();
+  if (pre + post == 0)
+    return false;
+
+  size_t bytes = (pre + post) * sizeof(ForceSample);
+  buffer = (ForceSample *)ps_malloc(bytes);
+  if (buffer == NULL)
+    buffer = (ForceSample *)malloc(bytes);
+  if (buffer == NULL)
+    return false;
+
+  size = pre + post;
+  postSize = post;
+  arm();
+  return true;
+}
+
+void BreakCapture::end()
+{
+  state = CAPTURE_OFF;
+  free(buffer);
+  buffer = NULL;
+  size = 0;
+}
+
+void BreakCapture::arm()
+{
+  if (buffer == NULL)
+    return;
+  head = 0;
+  filled = 0;
+  postRemaining = 0;
+  triggerIndex = 0;
+  state.store(CAPTURE_ARMED, std::memory_order_release);
+}
+
+void BreakCapture::push(const ForceSample &sample)
+{
+  CaptureState current = state.load(std::memory_order_relaxed);
+  if (current != CAPTURE_ARMED && current != CAPTURE_TRIGGERED)
+    return;
+
+  buffer[head] = sample;
+  head = head + 1 < size ? head + 1 : 0;
+  if (filled < size)
+    filled++;
+
+  if (current == CAPTURE_TRIGGERED && --postRemaining == 0)
+  {
+    // publish the window to the reader
+    state.store(CAPTURE_FROZEN, std::memory_order_release);
+  }
+}
+
+void BreakCapture::trigger()
+{
+  if (state.load(std::memory_order_relaxed) != CAPTURE_ARMED || filled == 0)
+    return;
+
+  // the window ends postSize samples after the trigger
+  triggerIndex = filled - 1;
+  if (filled + postSize > size)
+    triggerIndex = size - 1 - postSize;
+  postRemaining = postSize;
+  if (postRemaining == 0)
+    state.store(CAPTURE_FROZEN, std::memory_order_release);
+  else
+    state.store(CAPTURE_TRIGGERED, std::memory_order_relaxed);
+}
+
+CaptureState BreakCapture::get_state() const
+{
+  return state.load(std::memory_order_acquire);
+}
+
+bool BreakCapture::is_frozen() const
+{
+  return get_state() == CAPTURE_FROZEN;
+}
+
+size_t BreakCapture::get_count() const
+{
+  return filled;
+}
+
+size_t BreakCapture::get_trigger_index() const
+{
+  return triggerIndex;
+}
+
+const ForceSample &BreakCapture::get(size_t i) const
+{
+  // the oldest sample is at head once the ring has wrapped
+  size_t start = filled < size ? 0 : head;
+  size_t index = start + i;
+  if (index >= size)
+    index -= size;
+  return buffer[index];
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "force_sample.h"
+
+enum CaptureState : uint8_t
+{
+  CAPTURE_OFF,       // no buffer
+  CAPTURE_ARMED,     // recording the pre-trigger history
+  CAPTURE_TRIGGERED, // recording the post-trigger window
+  CAPTURE_FROZEN,    // window complete, nothing is written until arm()
+};
+
+// Oscilloscope-style capture of the samples around an event (the break).
+// While armed every sample goes into a ring of pre + post samples. trigger() marks the
+// last pushed sample; after post more samples the ring is frozen and holds the pre
+// samples up to and including the trigger and the post samples after it.
+// push(), trigger() and arm() belong to one task, another task may read the window
+// once is_frozen() returns true.
+class BreakCapture
+{
+private:
+  ForceSample *buffer = NULL;
+  size_t size = 0;         // pre + post
+  size_t postSize = 0;     // samples recorded after the trigger
+  size_t head = 0;         // next slot to write
+  size_t filled = 0;       // valid samples in the ring, up to size
+  size_t postRemaining = 0;
+  size_t triggerIndex = 0; // position of the trigger sample in the frozen window
+  std::atomic<CaptureState> state{CAPTURE_OFF};
+
+public:
+  ~BreakCapture();
+
+  // Allocate the ring, in PSRAM if there is one, and arm it.
+  // returns false if the memory is not available
+  bool begin(size_t pre, size_t post);
+
+  // free the ring
+  void end();
+
+  // drop the recorded samples and wait for the next trigger
+  void arm();
+
+  // record a sample; does nothing unless armed or triggered
+  void push(const ForceSample &sample);
+
+  // freeze the window around the last pushed sample; only the first trigger counts
+  void trigger();
+
+  CaptureState get_state() const;
+
+  // true once the post-trigger window is complete
+  bool is_frozen() const;
+
+  // samples in the frozen window, less than pre + post if the trigger came early
+  size_t get_count() const;
+
+  // position of the trigger sample in the frozen window
+  size_t get_trigger_index() const;
+
+  // sample i of the frozen window, the oldest first
+  const ForceSample &get(size_t i) const;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+// one processed reading, as published to the UI
+struct ForceSample
+{
+  uint32_t seq;      // conversion sequence number, a gap is a missed conversion
+  long raw;          // raw reading without filter
+  float reading;     // filtered reading
+  float force;       // calibrated force
+  float rate;        // loading rate dF/dt in force units per s (Kalman)
+  int64_t timestamp; // time of the data-ready edge in us
+};
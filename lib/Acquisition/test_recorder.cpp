@@ -0,0 +1,76 @@
+#include "test_recorder.h"
+
+#include <Arduino.h>
+
+TestRecorder::~TestRecorder()
+{
+  end();
+}
+
+bool TestRecorder::begin(size_t samples)
+{
+  end();
+  if (samples == 0)
+    return false;
+
+  size_t bytes = samples * sizeof(float);
+  buffer = (float *)ps_malloc(bytes);
+  if (buffer == NULL)
+    buffer = (float *)malloc(bytes);
+  if (buffer == NULL)
+    return false;
+
+  size = samples;
+  clear();
+  return true;
+}
+
+void TestRecorder::end()
+{
+  count = 0;
+  free(buffer);
+  buffer = NULL;
+  size = 0;
+}
+
+void TestRecorder::clear()
+{
+  count.store(0, std::memory_order_release);
+}
+
+void TestRecorder::push(float value, int64_t timestamp)
+{
+  size_t n = count.load(std::memory_order_relaxed);
+  if (n >= size)
+    return;
+  if (n == 0)
+    startTime = timestamp;
+  buffer[n] = value;
+  // publish the value to the reader
+  count.store(n + 1, std::memory_order_release);
+}
+
+size_t TestRecorder::get_count() const
+{
+  return count.load(std::memory_order_acquire);
+}
+
+size_t TestRecorder::get_size() const
+{
+  return size;
+}
+
+bool TestRecorder::is_full() const
+{
+  return size > 0 && get_count() >= size;
+}
+
+int64_t TestRecorder::get_start_time() const
+{
+  return startTime;
+}
+
+float TestRecorder::get(size_t i) const
+{
+  return buffer[i];
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Linear record of the unfiltered force of a whole test, for the analysis after it.
+// One task appends, another task may read the values up to get_count() at any time:
+// they are not written again before clear(). A full record ignores further values.
+class TestRecorder
+{
+private:
+  float *buffer = NULL;
+  size_t size = 0;
+  std::atomic<size_t> count{0};
+  int64_t startTime = 0; // timestamp of the first value in us
+
+public:
+  ~TestRecorder();
+
+  // Allocate room for size values, in PSRAM if there is one.
+  // returns false if the memory is not available
+  bool begin(size_t size);
+
+  // free the record
+  void end();
+
+  // drop the recorded values
+  void clear();
+
+  // append a value; does nothing without memory or when full
+  void push(float value, int64_t timestamp);
+
+  // values recorded so far
+  size_t get_count() const;
+
+  size_t get_size() const;
+
+  bool is_full() const;
+
+  // timestamp of the first value in us
+  int64_t get_start_time() const;
+
+  // value i, the oldest first
+  float get(size_t i) const;
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "hx711_zp.h"
+#include "soc/gpio_struct.h"
+#include "xtensa/hal.h"
+
+// minimum PD_SCK high and low time is 0.2 us (datasheet T3/T4)
+#ifndef HX711_FAST_PULSE_NS
+#define HX711_FAST_PULSE_NS 250
+#endif
+
+// HX711 with the pins fixed at compile time.
+// The readout uses the GPIO set/clear/input registers directly and times the clock
+// pulses with the CPU cycle counter instead of digitalWrite()/delayMicroseconds().
+// That shortens the critical section of a reading from ~60 us to ~15 us.
+// Usage: HX711Fast<4, 2> loadcell; loadcell.begin();
+template <uint8_t DOUT_PIN, uint8_t SCK_PIN>
+class HX711Fast : public HX711
+{
+  static_assert(DOUT_PIN < 40 && SCK_PIN < 34, "invalid HX711 pins");
+
+private:
+  uint32_t pulseCycles = 60; // clock pulse width in CPU cycles, set by begin()
+
+  static inline void IRAM_ATTR sck_high()
+  {
+    if (SCK_PIN < 32)
+      GPIO.out_w1ts = (1UL << (SCK_PIN & 31));
+    else
+      GPIO.out1_w1ts.val = (1UL << (SCK_PIN & 31));
+  }
+
+  static inline void IRAM_ATTR sck_low()
+  {
+    if (SCK_PIN < 32)
+      GPIO.out_w1tc = (1UL << (SCK_PIN & 31));
+    else
+      GPIO.out1_w1tc.val = (1UL << (SCK_PIN & 31));
+  }
+
+  static inline uint32_t IRAM_ATTR dout_level()
+  {
+    if (DOUT_PIN < 32)
+      return (GPIO.in >> (DOUT_PIN & 31)) & 1;
+    return (GPIO.in1.val >> (DOUT_PIN & 31)) & 1;
+  }
+
+  inline void IRAM_ATTR wait_pulse(uint32_t start)
+  {
+    while (xthal_get_ccount() - start < pulseCycles)
+    {
+    }
+  }
+
+protected:
+  long IRAM_ATTR shift_in_raw() override
+  {
+    uint32_t value = 0;
+    uint32_t start;
+
+    // Pulse the clock pin 24 times to read the data, MSB first.
+    // DOUT is valid 0.1 us after the rising edge, so it is sampled just before the falling edge.
+    for (uint8_t i = 0; i < 24; i++)
+    {
+      start = xthal_get_ccount();
+      sck_high();
+      wait_pulse(start);
+      value = (value << 1) | dout_level();
+      start = xthal_get_ccount();
+      sck_low();
+      wait_pulse(start);
+    }
+
+    // Set the channel and the gain factor for the next reading using the clock pin.
+    for (uint8_t i = 0; i < GAIN; i++)
+    {
+      start = xthal_get_ccount();
+      sck_high();
+      wait_pulse(start);
+      start = xthal_get_ccount();
+      sck_low();
+      wait_pulse(start);
+    }
+
+    // Replicate the most significant bit to pad out a 32-bit signed integer
+    if (value & 0x800000)
+      value |= 0xFF000000;
+    return static_cast<long>(static_cast<int32_t>(value));
+  }
+
+public:
+  // Initialize library with gain factor, the pins are given by the template.
+  void begin(byte gain = 128)
+  {
+    pulseCycles = (HX711_FAST_PULSE_NS * getCpuFrequencyMhz() + 999) / 1000;
+    HX711::begin(DOUT_PIN, SCK_PIN, gain);
+  }
+};
@@ -0,0 +1,153 @@
+#include "hx711_multi.h"
+
+#include "hx711_fast.h"
+#include "soc/gpio_struct.h"
+#include "xtensa/hal.h"
+
+bool HX711Multi::begin(const byte *dout, byte count, byte pd_sck, byte gain)
+{
+  if (count == 0 || count > maxChannels || pd_sck >= 34)
+    return false;
+
+  doutMask = 0;
+  for (byte c = 0; c < count; c++)
+  {
+    if (dout[c] >= 32)
+      return false;
+    DOUT[c] = dout[c];
+    doutMask |= 1UL << dout[c];
+    RAWREADINGS[c] = 0;
+  }
+  COUNT = count;
+  PD_SCK = pd_sck;
+  pulseCycles = (HX711_FAST_PULSE_NS * getCpuFrequencyMhz() + 999) / 1000;
+
+  pinMode(PD_SCK, OUTPUT);
+  for (byte c = 0; c < COUNT; c++)
+    pinMode(DOUT[c], INPUT_PULLUP);
+
+  set_gain(gain);
+  return true;
+}
+
+bool HX711Multi::is_ready()
+{
+  return (GPIO.in & doutMask) == 0;
+}
+
+void HX711Multi::set_gain(byte gain)
+{
+  switch (gain)
+  {
+  case 128: // channel A, gain factor 128
+    GAIN = 1;
+    break;
+  case 64: // channel A, gain factor 64
+    GAIN = 3;
+    break;
+  case 32: // channel B, gain factor 32
+    GAIN = 2;
+    break;
+  }
+}
+
+uint32_t IRAM_ATTR HX711Multi::pulse()
+{
+  uint32_t start = xthal_get_ccount();
+  if (PD_SCK < 32)
+    GPIO.out_w1ts = 1UL << PD_SCK;
+  else
+    GPIO.out1_w1ts.val = 1UL << (PD_SCK - 32);
+  while (xthal_get_ccount() - start < pulseCycles)
+  {
+  }
+  uint32_t in = GPIO.in;
+
+  start = xthal_get_ccount();
+  if (PD_SCK < 32)
+    GPIO.out_w1tc = 1UL << PD_SCK;
+  else
+    GPIO.out1_w1tc.val = 1UL << (PD_SCK - 32);
+  while (xthal_get_ccount() - start < pulseCycles)
+  {
+  }
+  return in;
+}
+
+bool HX711Multi::try_read(long *values, uint32_t timeout_ms)
+{
+  uint32_t start = millis();
+  while (!is_ready())
+  {
+    if (millis() - start >= timeout_ms)
+      return false;
+    vTaskDelay(1);
+  }
+  read_ready(values);
+  return true;
+}
+
+void HX711Multi::read_ready(long *values)
+{
+  uint32_t words[24];
+
+  // Same critical section as in HX711::read(), a stretched clock pulse would power
+  // down all chips at once.
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+  portENTER_CRITICAL(&mux);
+  noInterrupts();
+
+  // Pulse the shared clock pin 24 times and keep the whole input register per bit.
+  for (byte i = 0; i < 24; i++)
+    words[i] = pulse();
+
+  // Set the channel and the gain factor for the next reading using the clock pin.
+  for (byte i = 0; i < GAIN; i++)
+    pulse();
+
+  // End of critical section.
+  interrupts();
+  portEXIT_CRITICAL(&mux);
+
+  deinterleave(words, DOUT, COUNT, RAWREADINGS);
+  for (byte c = 0; c < COUNT; c++)
+    values[c] = RAWREADINGS[c];
+}
+
+void HX711Multi::deinterleave(const uint32_t *words, const byte *dout, byte count, long *values)
+{
+  for (byte c = 0; c < count; c++)
+  {
+    uint32_t value = 0;
+    for (byte i = 0; i < 24; i++)
+      value = (value << 1) | ((words[i] >> dout[c]) & 1);
+
+    // Replicate the most significant bit to pad out a 32-bit signed integer
+    if (value & 0x800000)
+      value |= 0xFF000000;
+    values[c] = static_cast<long>(static_cast<int32_t>(value));
+  }
+}
+
+long HX711Multi::get_raw_reading(byte channel)
+{
+  if (channel >= COUNT)
+    return 0;
+  return RAWREADINGS[channel];
+}
+
+byte HX711Multi::get_channel_count()
+{
+  return COUNT;
+}
+
+void HX711Multi::power_down()
+{
+  digitalWrite(PD_SCK, LOW);
+  digitalWrite(PD_SCK, HIGH);
+}
+
+void HX711Multi::power_up()
+{
+  digitalWrite(PD_SCK, LOW);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "freertos/task.h"
+
+// Several HX711 sharing one PD_SCK line.
+// Every clock pulse samples all DOUT pins with a single read of the GPIO input
+// register, so N loadcells cost one readout and their samples are taken at the same
+// instant. The DOUT pins have to be GPIO0..31 (one input register).
+// A standalone reader of the raw values: it is no LoadCellADC, so capture, health,
+// filter and calibration are up to the caller. It never waits longer than asked.
+class HX711Multi
+{
+public:
+  static const byte maxChannels = 8;
+
+private:
+  byte PD_SCK;               // shared Power Down and Serial Clock Input Pin
+  byte DOUT[maxChannels];    // Serial Data Output Pins
+  byte COUNT = 0;            // number of connected chips
+  byte GAIN;                 // amplification factor
+  uint32_t doutMask = 0;     // all DOUT pins in the input register
+  uint32_t pulseCycles = 60; // clock pulse width in CPU cycles
+  long RAWREADINGS[maxChannels];
+
+  // one clock pulse, returns the input register sampled before the falling edge
+  uint32_t pulse();
+
+  // read all chips in one go, they have to be ready
+  void read_ready(long *values);
+
+public:
+  // Initialize with the DOUT pins of all chips, the shared clock pin and the gain factor
+  // (see HX711::begin()). Returns false for more than maxChannels or invalid pins.
+  bool begin(const byte *dout, byte count, byte pd_sck, byte gain = 128);
+
+  // true if all chips have a conversion ready (all DOUT low)
+  bool is_ready();
+
+  // set the gain factor of all chips; takes effect with the conversion after the next
+  // successful try_read()
+  void set_gain(byte gain = 128);
+
+  // Waits at most timeout_ms for all chips to be ready and reads them in one go,
+  // values needs room for get_channel_count() readings.
+  // returns false if there was no conversion in time
+  bool try_read(long *values, uint32_t timeout_ms = 0);
+
+  long get_raw_reading(byte channel);
+
+  byte get_channel_count();
+
+  // Split the input register words of 24 clock pulses (MSB first) into signed 24-bit
+  // readings, one per DOUT pin.
+  static void deinterleave(const uint32_t *words, const byte *dout, byte count, long *values);
+
+  // puts the chips into power down mode
+  void power_down();
+
+  // wakes up the chips after power down mode
+  void power_up();
+};
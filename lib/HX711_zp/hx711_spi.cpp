@@ -0,0 +1,63 @@
+#include "hx711_spi.h"
+
+#include "esp_rom_gpio.h"
+#include "soc/gpio_sig_map.h"
+#include "soc/spi_periph.h"
+
+HX711Spi::HX711Spi(spi_host_device_t host) : host(host)
+{
+  deferredReadout = true;
+}
+
+bool HX711Spi::begin(byte dout, byte pd_sck, byte gain)
+{
+  HX711::begin(dout, pd_sck, gain);
+
+  spi_bus_config_t bus = {};
+  bus.mosi_io_num = -1;
+  bus.miso_io_num = dout;
+  bus.sclk_io_num = pd_sck;
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  if (spi_bus_initialize(host, &bus, SPI_DMA_DISABLED) != ESP_OK)
+    return false;
+
+  spi_device_interface_config_t dev = {};
+  dev.mode = 1; // clock idles low, DOUT changes on the rising edge and is sampled on the falling edge
+  dev.clock_speed_hz = HX711_SPI_CLOCK_HZ;
+  dev.spics_io_num = -1;
+  dev.flags = SPI_DEVICE_HALFDUPLEX;
+  dev.queue_size = 1;
+  if (spi_bus_add_device(host, &dev, &device) != ESP_OK)
+    return false;
+
+  // the bus setup drops the pull-up of DOUT
+  gpio_pullup_en((gpio_num_t)dout);
+  return true;
+}
+
+long HX711Spi::read_raw()
+{
+  // 24 data bits plus 1..3 clocks which set the channel and the gain for the next reading
+  spi_transaction_t t = {};
+  t.flags = SPI_TRANS_USE_RXDATA;
+  t.length = 0;
+  t.rxlength = 24 + GAIN;
+  spi_device_polling_transmit(device, &t);
+
+  return word_to_sample(t.rx_data);
+}
+
+void HX711Spi::power_down()
+{
+  // take PD_SCK away from the SPI peripheral and hold it high
+  esp_rom_gpio_connect_out_signal(PD_SCK, SIG_GPIO_OUT_IDX, false, false);
+  digitalWrite(PD_SCK, LOW);
+  digitalWrite(PD_SCK, HIGH);
+}
+
+void HX711Spi::power_up()
+{
+  digitalWrite(PD_SCK, LOW);
+  esp_rom_gpio_connect_out_signal(PD_SCK, spi_periph_signal[host].spiclk_out, false, false);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "driver/spi_master.h"
+#include "hx711_zp.h"
+
+#define HX711_SPI_CLOCK_HZ 1000000 // PD_SCK high time stays far below the 50 us power down limit
+
+// HX711 read out by the SPI peripheral instead of bit-banging.
+// PD_SCK is the SPI clock and DOUT is MISO. One half-duplex transaction of 25, 26 or 27
+// clocks reads the 24 data bits and sets the gain for the next conversion, the hardware
+// generates the clock, so there is no critical section and interrupts stay enabled.
+// The readout can not run inside the DOUT interrupt, poll() reads the conversion out.
+class HX711Spi : public HX711
+{
+private:
+  spi_host_device_t host;
+  spi_device_handle_t device = NULL;
+
+protected:
+  long read_raw() override;
+
+public:
+  // host: SPI peripheral that is not used by the display, VSPI (SPI3_HOST) by default
+  HX711Spi(spi_host_device_t host = SPI3_HOST);
+
+  // Initialize library with data output pin, clock input pin and gain factor, see HX711::begin()
+  // returns false if the SPI peripheral could not be set up
+  bool begin(byte dout, byte pd_sck, byte gain = 128);
+
+  // puts the chip into power down mode
+  void power_down() override;
+
+  // wakes up the chip after power down mode
+  void power_up() override;
+};
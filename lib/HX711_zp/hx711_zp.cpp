@@ -5,7 +5,7 @@
 // - https://github.com/bogde/HX711/issues/75
 // - https://github.com/arduino/Arduino/issues/6561
 
-uint8_t shiftInSlow(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder)
+uint8_t IRAM_ATTR shiftInSlow(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder)
 {
   uint8_t value = 0;
   uint8_t i;
@@ -24,9 +24,8 @@ uint8_t shiftInSlow(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder)
   return value;
 }
 
-HX711::HX711()
+HX711::HX711() : LoadCellADC(HX711_RATE_10SPS)
 {
-  lpFilter.begin(CUTOFFFREQ);
 }
 
 HX711::~HX711()
@@ -37,11 +36,13 @@ void HX711::begin(byte dout, byte pd_sck, byte gain)
 {
   PD_SCK = pd_sck;
   DOUT = dout;
+  DRDY = dout; // DOUT goes low when a conversion is ready
 
   pinMode(PD_SCK, OUTPUT);
   pinMode(DOUT, INPUT_PULLUP);
 
   set_gain(gain);
+  begin_supervision();
 }
 
 bool HX711::is_ready()
@@ -49,6 +50,16 @@ bool HX711::is_ready()
   return digitalRead(DOUT) == LOW;
 }
 
+void HX711::set_rate(byte sps, int8_t rate_pin)
+{
+  set_nominal_rate(sps == HX711_RATE_80SPS ? HX711_RATE_80SPS : HX711_RATE_10SPS);
+  if (rate_pin >= 0)
+  {
+    pinMode(rate_pin, OUTPUT);
+    digitalWrite(rate_pin, RATE == HX711_RATE_80SPS ? HIGH : LOW);
+  }
+}
+
 void HX711::set_gain(byte gain)
 {
   switch (gain)
@@ -65,14 +76,8 @@ void HX711::set_gain(byte gain)
   }
 }
 
-float HX711::read()
+long HX711::read_raw()
 {
-  // Wait for the chip to become ready.
-  wait_ready();
-
-  // Define structures for reading data into.
-  uint8_t data[3] = {0};
-
   // Protect the read sequence from system interrupts.  If an interrupt occurs during
   // the time the PD_SCK signal is high it will stretch the length of the clock pulse.
   // If the total pulse time exceeds 60 uSec this will cause the HX711 to enter
@@ -92,134 +97,40 @@ float HX711::read()
   portENTER_CRITICAL(&mux);
   noInterrupts();
 
-  // Pulse the clock pin 24 times to read the data.
-  data[2] = shiftInSlow(DOUT, PD_SCK, MSBFIRST);
-  data[1] = shiftInSlow(DOUT, PD_SCK, MSBFIRST);
-  data[0] = shiftInSlow(DOUT, PD_SCK, MSBFIRST);
-
-  // Set the channel and the gain factor for the next reading using the clock pin.
-  for (unsigned int i = 0; i < GAIN; i++)
-  {
-    digitalWrite(PD_SCK, HIGH);
-    delayMicroseconds(1);
-    digitalWrite(PD_SCK, LOW);
-    delayMicroseconds(1);
-  }
+  long raw = shift_in_raw();
 
   // End of critical section.
   interrupts();
   portEXIT_CRITICAL(&mux);
 
-  // Replicate the most significant bit to pad out a 32-bit signed integer
-  uint8_t filler = 0x00;
-  if (data[2] & 0x80)
-  {
-    filler = 0xFF;
-  }
-
-  // Construct a 32-bit signed integer
-  unsigned long value = (static_cast<unsigned long>(filler) << 24 | static_cast<unsigned long>(data[2]) << 16 | static_cast<unsigned long>(data[1]) << 8 | static_cast<unsigned long>(data[0]));
-
-  RAWREADING = static_cast<long>(value);
-  CURRENTREADING = lpFilter.filter((float)RAWREADING);
-
-  lastReadingIndex++;
-  if (lastReadingIndex >= lastReadingsCount)
-    lastReadingIndex = 0;
-  LASTREADINGS[lastReadingIndex] = CURRENTREADING;
-
-  return CURRENTREADING;
-}
-
-long HX711::get_raw_reading()
-{
-  return RAWREADING;
+  return raw;
 }
 
-// private
-void HX711::wait_ready()
+long IRAM_ATTR HX711::shift_in_raw()
 {
-  // Wait for the chip to become ready.
-  while (!is_ready())
-  {
-    vTaskDelay(10);
-  }
-}
+  // Define structures for reading data into.
+  uint8_t data[3] = {0};
 
-float HX711::get_last_reading()
-{
-  return CURRENTREADING;
-}
+  // Pulse the clock pin 24 times to read the data.
+  data[0] = shiftInSlow(DOUT, PD_SCK, MSBFIRST);
+  data[1] = shiftInSlow(DOUT, PD_SCK, MSBFIRST);
+  data[2] = shiftInSlow(DOUT, PD_SCK, MSBFIRST);
 
-float HX711::get_lastreadings_avg()
-{
-  float sum = 0;
-  for (int i = 0; i < lastReadingsCount; i++)
+  // Set the channel and the gain factor for the next reading using the clock pin.
+  for (unsigned int i = 0; i < GAIN; i++)
   {
-    sum += LASTREADINGS[i];
+    digitalWrite(PD_SCK, HIGH);
+    delayMicroseconds(1);
+    digitalWrite(PD_SCK, LOW);
+    delayMicroseconds(1);
   }
-  return sum / lastReadingsCount;
-}
-
-float HX711::get_last_reading_zeroed()
-{
-  return CURRENTREADING - ZEROPOINT_OFFSET_CAL;
-}
-
-float HX711::get_cal_force()
-{
-  return (float)(CURRENTREADING - ZEROPOINT_OFFSET_CAL) / SCALE_CAL;
-}
-
-float HX711::get_tare_force()
-{
-  return get_cal_force() - TARE_OFFSET;
-}
-
-void HX711::tare(byte avgTimes)
-{
-  read();
-  set_tare_offset(get_cal_force());
-}
-
-void HX711::set_scale_current(float force)
-{
-  SCALE_CAL = (get_lastreadings_avg() - ZEROPOINT_OFFSET_CAL) / force;
-}
-
-void HX711::set_scale(float scale)
-{
-  SCALE_CAL = scale;
-}
-
-float HX711::get_scale()
-{
-  return SCALE_CAL;
-}
 
-void HX711::set_tare_offset(float offset)
-{
-  TARE_OFFSET = offset;
-}
-
-float HX711::get_tare_offset()
-{
-  return TARE_OFFSET;
-}
-
-void HX711::set_zeropoint_offset_current()
-{
-  ZEROPOINT_OFFSET_CAL = get_lastreadings_avg();
-}
-
-void HX711::set_zeropoint_offset(float zeropoint_offset)
-{
-  ZEROPOINT_OFFSET_CAL = zeropoint_offset;
+  return word_to_sample(data);
 }
 
-float HX711::get_zeropoint_offset()
+long IRAM_ATTR HX711::read_raw_isr()
 {
-  return ZEROPOINT_OFFSET_CAL;
+  return shift_in_raw();
 }
 
 void HX711::power_down()
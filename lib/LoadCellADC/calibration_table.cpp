@@ -0,0 +1,145 @@
+#include "calibration_table.h"
+
+#include <math.h>
+
+#include "biquad.h"
+
+static int32_t saturate(double value)
+{
+  if (value > INT32_MAX)
+    return INT32_MAX;
+  if (value < INT32_MIN)
+    return INT32_MIN;
+  return (int32_t)lround(value);
+}
+
+void CalibrationTable::clear()
+{
+  count = 0;
+  build();
+}
+
+bool CalibrationTable::add(float reading, float force)
+{
+  if (fabsf(reading) < 1)
+    return false;
+  uint8_t i = 0;
+  while (i < count && points[i].reading < reading - 1)
+    i++;
+  if (i < count && fabsf(points[i].reading - reading) < 1)
+  {
+    points[i].force = force;
+  }
+  else
+  {
+    if (count >= maxPoints)
+      return false;
+    for (uint8_t k = count; k > i; k--)
+      points[k] = points[k - 1];
+    points[i].reading = reading;
+    points[i].force = force;
+    count++;
+  }
+  build();
+  return true;
+}
+
+bool CalibrationTable::set_points(const Point *p, uint8_t n)
+{
+  if (n > maxPoints)
+    return false;
+  clear();
+  for (uint8_t i = 0; i < n; i++)
+    add(p[i].reading, p[i].force);
+  return true;
+}
+
+uint8_t CalibrationTable::get_count() const
+{
+  return count;
+}
+
+const CalibrationTable::Point &CalibrationTable::get(uint8_t i) const
+{
+  return points[i];
+}
+
+bool CalibrationTable::is_active() const
+{
+  return nodeCount >= 2;
+}
+
+float CalibrationTable::get_sensitivity() const
+{
+  const Point *closest = NULL;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (points[i].force != 0 && (closest == NULL || fabsf(points[i].reading) < fabsf(closest->reading)))
+      closest = &points[i];
+  }
+  return closest != NULL ? closest->reading / closest->force : 0;
+}
+
+void CalibrationTable::build()
+{
+  const double one = 1 << Biquad::signalBits;
+
+  // the zero point goes in between the negative and the positive readings
+  nodeCount = 0;
+  bool zeroDone = false;
+  for (uint8_t i = 0; i <= count; i++)
+  {
+    if (!zeroDone && (i == count || points[i].reading > 0))
+    {
+      nodeReading[nodeCount] = 0;
+      nodeMilli[nodeCount++] = 0;
+      zeroDone = true;
+    }
+    if (i < count)
+    {
+      nodeReading[nodeCount] = saturate(points[i].reading * one);
+      nodeMilli[nodeCount++] = saturate(points[i].force * 1000.0);
+    }
+  }
+  if (count == 0)
+    nodeCount = 0;
+
+  double slope[maxPoints];
+  double steepest = 0;
+  for (uint8_t k = 0; k + 1 < nodeCount; k++)
+  {
+    slope[k] = ((double)nodeMilli[k + 1] - nodeMilli[k]) / ((double)nodeReading[k + 1] - nodeReading[k]);
+    if (fabs(slope[k]) > steepest)
+      steepest = fabs(slope[k]);
+  }
+  slopeBits = 1;
+  while (slopeBits < 62 && ldexp(steepest, slopeBits + 1) < (1 << 30))
+    slopeBits++;
+  for (uint8_t k = 0; k + 1 < nodeCount; k++)
+    nodeSlope[k] = saturate(ldexp(slope[k], slopeBits));
+}
+
+int32_t CalibrationTable::evaluate(int32_t reading) const
+{
+  if (nodeCount < 2)
+    return 0;
+
+  // last segment that starts at or below the reading, the outer ones continue
+  uint8_t lo = 0, hi = nodeCount - 2;
+  while (lo < hi)
+  {
+    uint8_t mid = (lo + hi + 1) / 2;
+    if (nodeReading[mid] <= reading)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+
+  int64_t milli = ((int64_t)reading - nodeReading[lo]) * nodeSlope[lo];
+  milli = nodeMilli[lo] + ((milli + ((int64_t)1 << (slopeBits - 1))) >> slopeBits);
+  if (milli > INT32_MAX)
+    return INT32_MAX;
+  if (milli < INT32_MIN)
+    return INT32_MIN;
+  return (int32_t)milli;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+// Multi-point calibration: piecewise linear through measured points of the zeroed
+// reading (counts) and the known force, with the zero point as the implicit first point.
+// Beyond the outermost points the outer segments continue. The evaluation is fixed
+// point: a binary search for the segment and one multiplication, no division.
+class CalibrationTable
+{
+public:
+  static const uint8_t maxPoints = 15;
+
+  struct Point
+  {
+    float reading; // zeroed reading in counts
+    float force;   // known force at that reading
+  };
+
+private:
+  // fraction bits of the slopes, as many as fit the steepest one in 30 bits; the product
+  // with a reading difference stays within 62 bits
+  int slopeBits = 1;
+
+  Point points[maxPoints]; // sorted by the reading
+  uint8_t count = 0;
+
+  // nodes of the fixed point form, including the zero point
+  int32_t nodeReading[maxPoints + 1]; // in fixed point, see Biquad::signalBits
+  int32_t nodeMilli[maxPoints + 1];   // force in 1/1000 units
+  int32_t nodeSlope[maxPoints + 1];   // 1/1000 units per fixed point step to the next node
+  uint8_t nodeCount = 0;
+
+  // compute the fixed point form from the points
+  void build();
+
+public:
+  // drop all points, the table is inactive then
+  void clear();
+
+  // Add a point, sorted in by its reading; a point closer than one count to another
+  // one replaces it.
+  // returns false if the table is full or the reading is at the zero point
+  bool add(float reading, float force);
+
+  // replace all points, e.g. from the settings; returns false if there are too many
+  bool set_points(const Point *points, uint8_t count);
+
+  uint8_t get_count() const;
+
+  // point i, sorted by the reading
+  const Point &get(uint8_t i) const;
+
+  // true with at least one point besides the zero point
+  bool is_active() const;
+
+  // readings per force unit next to the zero point, from the point closest to it;
+  // 0 while the table is inactive
+  float get_sensitivity() const;
+
+  // force in 1/1000 units for a zeroed reading in fixed point, saturated at the int32_t
+  // range; 0 while the table is inactive
+  int32_t evaluate(int32_t reading) const;
+};
@@ -0,0 +1,575 @@
+#include "loadcell_adc.h"
+
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "soc/gpio_struct.h"
+
+LoadCellADC::LoadCellADC(uint16_t sps)
+{
+  for (int k = 0; k < FILTER_PROFILE_COUNT; k++)
+  {
+    filterBank.get_bank((FilterProfile)k).set_lowpass(FILTER_BUTTERWORTH, 2, 2);
+  }
+  lastReadings.begin(20);
+  kalman.begin(500, 2);
+  update_calibration();
+  set_nominal_rate(sps);
+}
+
+LoadCellADC::~LoadCellADC()
+{
+}
+
+void LoadCellADC::set_nominal_rate(uint16_t sps)
+{
+  RATE = sps;
+  INTERVAL_AVG = 0;
+  filterBank.begin(RATE);
+  health.begin(1000000UL / RATE);
+  stats.begin(1000000UL / RATE);
+}
+
+void LoadCellADC::begin_supervision()
+{
+  health.reset(esp_timer_get_time());
+}
+
+uint16_t LoadCellADC::get_rate()
+{
+  return RATE;
+}
+
+bool LoadCellADC::set_filter(FilterProfile profile, FilterResponse type, uint8_t order, float cutoff, float notch)
+{
+  BiquadBank &bank = filterBank.get_bank(profile);
+  bank.set_lowpass(type, order, cutoff);
+  bank.set_notch(notch);
+  return bank.begin(get_sample_rate());
+}
+
+void LoadCellADC::set_filter_profile(FilterProfile profile)
+{
+  filterBank.select(profile);
+}
+
+FilterProfile LoadCellADC::get_filter_profile()
+{
+  return filterBank.get_selected();
+}
+
+float LoadCellADC::get_filter_delay()
+{
+  return filterBank.get_group_delay() / filterBank.get_sample_rate();
+}
+
+bool LoadCellADC::set_spike_filter(uint8_t window, float threshold, float minDeviation)
+{
+  return spikeFilter.begin(window, threshold, minDeviation);
+}
+
+uint32_t LoadCellADC::get_spike_count()
+{
+  return spikeFilter.get_spike_count();
+}
+
+uint32_t LoadCellADC::get_sequence()
+{
+  return stats.get_sequence();
+}
+
+uint32_t LoadCellADC::get_missed_conversions()
+{
+  return stats.get_missed();
+}
+
+const SampleStats &LoadCellADC::get_sample_stats()
+{
+  return stats;
+}
+
+void LoadCellADC::reset_sample_stats()
+{
+  stats.reset();
+}
+
+float LoadCellADC::get_sample_rate()
+{
+  if (INTERVAL_AVG <= 0)
+    return RATE;
+  return 1.0e6 / INTERVAL_AVG;
+}
+
+float LoadCellADC::read()
+{
+  // Wait for the chip to become ready.
+  wait_ready();
+  int64_t timestamp = esp_timer_get_time();
+
+  LoadCellSample sample;
+  sample.raw = read_raw();
+  sample.timestamp = timestamp;
+
+  LoadCellBlock block;
+  process_block(&sample, 1, block);
+
+  return CURRENTREADING;
+}
+
+bool LoadCellADC::try_read(uint32_t timeout_ms)
+{
+  uint32_t start = millis();
+  while (!is_ready())
+  {
+    if (millis() - start >= timeout_ms)
+      return false;
+    vTaskDelay(1);
+  }
+  read();
+  return true;
+}
+
+LoadCellHealth LoadCellADC::get_health()
+{
+  return health.state(esp_timer_get_time());
+}
+
+int64_t LoadCellADC::get_health_deadline()
+{
+  return health.get_deadline();
+}
+
+long LoadCellADC::read_raw_isr()
+{
+  return read_raw();
+}
+
+long IRAM_ATTR LoadCellADC::word_to_sample(const uint8_t *data)
+{
+  // Replicate the most significant bit to pad out a 32-bit signed integer
+  uint8_t filler = 0x00;
+  if (data[0] & 0x80)
+  {
+    filler = 0xFF;
+  }
+
+  // Construct a 32-bit signed integer
+  uint32_t value = (static_cast<uint32_t>(filler) << 24 | static_cast<uint32_t>(data[0]) << 16 | static_cast<uint32_t>(data[1]) << 8 | static_cast<uint32_t>(data[2]));
+
+  return static_cast<long>(static_cast<int32_t>(value));
+}
+
+void LoadCellADC::process_block(const LoadCellSample *samples, size_t n, LoadCellBlock &block)
+{
+  block.count = n;
+  if (n == 0)
+    return;
+
+  const float nominalInterval = 1.0e6 / RATE;
+  float dt[LOADCELL_BLOCK_SIZE];
+  float newRate[LOADCELL_BLOCK_SIZE]; // filter rate from this sample on, 0 = unchanged
+  float clean[LOADCELL_BLOCK_SIZE];   // readings after the spike filter
+  float filterRate = filterBank.get_sample_rate();
+
+  for (size_t i = 0; i < n; i++)
+  {
+    // Measure the real time between the conversions. A gap of several conversions
+    // (first reading, power down, ...) is no sample interval.
+    int64_t timestamp = samples[i].timestamp;
+    float interval = (float)(timestamp - TIMESTAMP);
+    newRate[i] = 0;
+    if (TIMESTAMP != 0 && interval > 0 && interval <= 4 * nominalInterval)
+    {
+      if (INTERVAL_AVG <= 0)
+        INTERVAL_AVG = interval;
+      INTERVAL_AVG += (interval - INTERVAL_AVG) / 16;
+
+      // the filter follows the measured rate, only a change by more than 1% recomputes it
+      if (fabsf(INTERVAL_AVG * filterRate - 1.0e6f) > 1.0e4f)
+      {
+        newRate[i] = 1.0e6 / INTERVAL_AVG;
+        filterRate = newRate[i];
+      }
+    }
+
+    // the Kalman estimator handles any interval, a gap only widens its uncertainty
+    dt[i] = TIMESTAMP != 0 ? interval / 1.0e6 : 0;
+
+    TIMESTAMP = timestamp;
+    health.sample(samples[i].raw, timestamp);
+    stats.sample(timestamp);
+    block.seq[i] = stats.get_sequence();
+    block.raw[i] = samples[i].raw;
+    block.timestamp[i] = timestamp;
+    clean[i] = (float)samples[i].raw;
+  }
+  RAWREADING = samples[n - 1].raw;
+
+  spikeFilter.filter_block(clean, n);
+
+  // the low pass in fixed point, a new sample rate takes effect with the sample that
+  // measured it; the spike filter only passes whole counts
+  int32_t filtered[LOADCELL_BLOCK_SIZE];
+  int32_t unfiltered[LOADCELL_BLOCK_SIZE];
+  for (size_t i = 0; i < n; i++)
+  {
+    unfiltered[i] = (int32_t)clean[i] * (1 << Biquad::signalBits);
+    filtered[i] = unfiltered[i];
+  }
+  size_t start = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (newRate[i] > 0)
+    {
+      filterBank.filter_block(&filtered[start], i - start);
+      filterBank.set_sample_rate(newRate[i]);
+      start = i;
+    }
+  }
+  filterBank.filter_block(&filtered[start], n - start);
+
+  for (size_t i = 0; i < n; i++)
+  {
+    block.reading[i] = filtered[i] * (1.0f / (1 << Biquad::signalBits));
+    block.forceMilli[i] = calibrate(filtered[i]);
+    block.force[i] = block.forceMilli[i] * 0.001f;
+    block.unfiltered[i] = calibrate(unfiltered[i]) * 0.001f;
+    kalman.update(block.unfiltered[i], dt[i]);
+    block.rate[i] = kalman.get_rate();
+    block.rateVariance[i] = kalman.get_rate_variance();
+  }
+  CURRENTFIXED = filtered[n - 1];
+  CURRENTREADING = block.reading[n - 1];
+  lastReadings.push_block(block.reading, n);
+}
+
+int32_t LoadCellADC::calibrate(int32_t reading)
+{
+  if (calibrationTable.is_active())
+    return calibrationTable.evaluate(reading - ZEROPOINT_FIXED);
+
+  // (reading - zero point) / scale * 1000 with the reciprocal, rounded
+  int64_t milli = ((int64_t)reading - ZEROPOINT_FIXED) * SCALE_INV_FIXED;
+  milli = (milli + ((int64_t)1 << (SCALE_INV_BITS - 1))) >> SCALE_INV_BITS;
+  if (milli > INT32_MAX)
+    return INT32_MAX;
+  if (milli < INT32_MIN)
+    return INT32_MIN;
+  return (int32_t)milli;
+}
+
+void LoadCellADC::update_calibration()
+{
+  ZEROPOINT_CAL_FIXED = lroundf(ZEROPOINT_OFFSET_CAL * (1 << Biquad::signalBits));
+  ZEROPOINT_FIXED = ZEROPOINT_CAL_FIXED + lroundf(ZEROPOINT_CORRECTION * (1 << Biquad::signalBits));
+  // mN per fixed point step with about 30 significant bits, saturated for tiny scales;
+  // the product with a 24-bit reading and its fraction bits stays within 62 bits
+  double inv = 1000.0 / ((double)SCALE_CAL * (1 << Biquad::signalBits));
+  SCALE_INV_BITS = 1;
+  while (SCALE_INV_BITS < 62 && fabs(ldexp(inv, SCALE_INV_BITS + 1)) < (1 << 30))
+    SCALE_INV_BITS++;
+  inv = ldexp(inv, SCALE_INV_BITS);
+  if (inv > INT32_MAX)
+    inv = INT32_MAX;
+  if (inv < -INT32_MAX)
+    inv = -INT32_MAX;
+  SCALE_INV_FIXED = (int32_t)lround(inv);
+}
+
+void IRAM_ATTR LoadCellADC::rearm_drdy()
+{
+  if (DRDY < 32)
+    GPIO.status_w1tc = BIT(DRDY);
+  else
+    GPIO.status1_w1tc.val = BIT(DRDY - 32);
+  gpio_intr_enable((gpio_num_t)DRDY);
+}
+
+void IRAM_ATTR LoadCellADC::drdy_isr(void *arg)
+{
+  LoadCellADC *self = static_cast<LoadCellADC *>(arg);
+  static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+  // edges latched during a previous readout arrive with the pin already high again
+  if (digitalRead(self->DRDY) != LOW)
+    return;
+
+  LoadCellSample sample;
+  sample.timestamp = esp_timer_get_time();
+
+  // The data bits may toggle the pin during the readout (HX711: DOUT is DRDY), so mask
+  // our own edge interrupt and clear whatever was latched before enabling it again.
+  gpio_intr_disable((gpio_num_t)self->DRDY);
+  if (self->deferredReadout)
+  {
+    // poll() reads the conversion out and enables the interrupt again
+    self->pendingTimestamp = sample.timestamp;
+    self->readoutPending = true;
+  }
+  else
+  {
+    portENTER_CRITICAL_ISR(&mux);
+    sample.raw = self->read_raw_isr();
+    portEXIT_CRITICAL_ISR(&mux);
+    self->rearm_drdy();
+
+    self->captureRing.push(sample);
+  }
+
+  if (self->notifyTask != NULL)
+  {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->notifyTask, &woken);
+    if (woken)
+      portYIELD_FROM_ISR();
+  }
+}
+
+void LoadCellADC::begin_capture(TaskHandle_t notify)
+{
+  if (capturing)
+    return;
+  notifyTask = notify;
+  captureRing.clear();
+  stats.begin(1000000UL / RATE);
+  begin_supervision();
+  capturing = true;
+  attachInterruptArg(digitalPinToInterrupt(DRDY), drdy_isr, this, FALLING);
+
+  // A conversion that finished before the interrupt was attached has no edge left
+  // and the pin would stay low forever, so fetch it by hand.
+  noInterrupts();
+  if (is_ready())
+    drdy_isr(this);
+  interrupts();
+}
+
+void LoadCellADC::end_capture()
+{
+  if (!capturing)
+    return;
+  detachInterrupt(digitalPinToInterrupt(DRDY));
+  capturing = false;
+  readoutPending = false;
+  captureRing.clear();
+}
+
+bool LoadCellADC::poll()
+{
+  LoadCellBlock block;
+  return poll_block(block, 1) > 0;
+}
+
+size_t LoadCellADC::poll_block(LoadCellBlock &block, size_t max)
+{
+  if (max > LOADCELL_BLOCK_SIZE)
+    max = LOADCELL_BLOCK_SIZE;
+  LoadCellSample samples[LOADCELL_BLOCK_SIZE];
+  size_t n;
+  if (readoutPending)
+  {
+    samples[0].raw = read_raw();
+    samples[0].timestamp = pendingTimestamp;
+    readoutPending = false;
+    rearm_drdy();
+    n = 1;
+  }
+  else
+  {
+    n = captureRing.pop_block(samples, max);
+  }
+
+  process_block(samples, n, block);
+  return n;
+}
+
+uint32_t LoadCellADC::get_capture_dropped()
+{
+  return captureRing.get_dropped();
+}
+
+long LoadCellADC::get_raw_reading()
+{
+  return RAWREADING;
+}
+
+float LoadCellADC::get_kalman_force()
+{
+  return kalman.get_value();
+}
+
+float LoadCellADC::get_force_rate()
+{
+  return kalman.get_rate();
+}
+
+float LoadCellADC::get_kalman_force_variance()
+{
+  return kalman.get_value_variance();
+}
+
+float LoadCellADC::get_force_rate_variance()
+{
+  return kalman.get_rate_variance();
+}
+
+void LoadCellADC::set_kalman_noise(float accelNoise, float measurementNoise)
+{
+  kalman.begin(accelNoise, measurementNoise);
+}
+
+int64_t LoadCellADC::get_last_timestamp()
+{
+  return TIMESTAMP;
+}
+
+// private
+void LoadCellADC::wait_ready()
+{
+  // Wait for the chip to become ready.
+  while (!is_ready())
+  {
+    vTaskDelay(10);
+  }
+}
+
+float LoadCellADC::get_last_reading()
+{
+  return CURRENTREADING;
+}
+
+float LoadCellADC::get_lastreadings_avg()
+{
+  return lastReadings.get_mean();
+}
+
+float LoadCellADC::get_lastreadings_stddev()
+{
+  return lastReadings.get_stddev();
+}
+
+const WindowStats &LoadCellADC::get_reading_stats()
+{
+  return lastReadings;
+}
+
+bool LoadCellADC::set_average_window(uint16_t samples)
+{
+  return lastReadings.begin(samples);
+}
+
+float LoadCellADC::get_last_reading_zeroed()
+{
+  return CURRENTREADING - ZEROPOINT_OFFSET_CAL - ZEROPOINT_CORRECTION;
+}
+
+float LoadCellADC::get_cal_force()
+{
+  return get_cal_force_milli() * 0.001f;
+}
+
+int32_t LoadCellADC::get_cal_force_milli()
+{
+  return calibrate(CURRENTFIXED);
+}
+
+float LoadCellADC::get_tare_force()
+{
+  return get_cal_force() - TARE_OFFSET;
+}
+
+void LoadCellADC::tare(byte avgTimes)
+{
+  if (avgTimes == 0)
+    avgTimes = 1;
+  float sum = 0;
+  for (byte i = 0; i < avgTimes; i++)
+  {
+    read();
+    sum += get_cal_force();
+  }
+  set_tare_offset(sum / avgTimes);
+}
+
+void LoadCellADC::set_scale_current(float force)
+{
+  SCALE_CAL = (get_lastreadings_avg() - ZEROPOINT_OFFSET_CAL - ZEROPOINT_CORRECTION) / force;
+  update_calibration();
+}
+
+void LoadCellADC::set_scale(float scale)
+{
+  SCALE_CAL = scale;
+  update_calibration();
+}
+
+float LoadCellADC::get_scale()
+{
+  return SCALE_CAL;
+}
+
+float LoadCellADC::get_sensitivity()
+{
+  if (calibrationTable.is_active())
+    return calibrationTable.get_sensitivity();
+  return SCALE_CAL;
+}
+
+void LoadCellADC::set_tare_offset(float offset)
+{
+  TARE_OFFSET = offset;
+}
+
+float LoadCellADC::get_tare_offset()
+{
+  return TARE_OFFSET;
+}
+
+void LoadCellADC::set_zeropoint_offset_current()
+{
+  ZEROPOINT_OFFSET_CAL = get_lastreadings_avg();
+  ZEROPOINT_CORRECTION = 0;
+  update_calibration();
+}
+
+void LoadCellADC::set_zeropoint_offset(float zeropoint_offset)
+{
+  ZEROPOINT_OFFSET_CAL = zeropoint_offset;
+  ZEROPOINT_CORRECTION = 0;
+  update_calibration();
+}
+
+float LoadCellADC::get_zeropoint_offset()
+{
+  return ZEROPOINT_OFFSET_CAL;
+}
+
+void LoadCellADC::set_zero_correction(float correction)
+{
+  ZEROPOINT_CORRECTION = correction;
+  ZEROPOINT_FIXED = ZEROPOINT_CAL_FIXED + lroundf(correction * (1 << Biquad::signalBits));
+}
+
+float LoadCellADC::get_zero_correction()
+{
+  return ZEROPOINT_CORRECTION;
+}
+
+bool LoadCellADC::add_calibration_point(float force)
+{
+  return calibrationTable.add(get_lastreadings_avg() - ZEROPOINT_OFFSET_CAL - ZEROPOINT_CORRECTION, force);
+}
+
+void LoadCellADC::clear_calibration_table()
+{
+  calibrationTable.clear();
+}
+
+bool LoadCellADC::set_calibration_table(const CalibrationTable::Point *points, uint8_t count)
+{
+  return calibrationTable.set_points(points, count);
+}
+
+const CalibrationTable &LoadCellADC::get_calibration_table()
+{
+  return calibrationTable;
+}
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "calibration_table.h"
+#include "freertos/task.h"
+#include "kalman_cv.h"
+#include "loadcell_health.h"
+#include "profile_filter.h"
+#include "sample_ring.h"
+#include "sample_stats.h"
+#include "spike_filter.h"
+#include "window_stats.h"
+
+// one conversion result as captured on the data-ready edge
+struct LoadCellSample
+{
+  long raw;          // signed 24-bit reading
+  int64_t timestamp; // esp_timer time of the data-ready edge in us
+};
+
+// maximum number of samples poll_block() processes at once
+#define LOADCELL_BLOCK_SIZE 16
+
+// processed readings of consecutive samples, oldest first
+struct LoadCellBlock
+{
+  size_t count;
+  uint32_t seq[LOADCELL_BLOCK_SIZE];       // sequence numbers, see get_sequence()
+  long raw[LOADCELL_BLOCK_SIZE];           // raw readings without filter
+  float reading[LOADCELL_BLOCK_SIZE];      // filtered readings
+  float force[LOADCELL_BLOCK_SIZE];        // calibrated force of the filtered readings
+  int32_t forceMilli[LOADCELL_BLOCK_SIZE]; // the same in 1/1000 force units
+  float unfiltered[LOADCELL_BLOCK_SIZE];   // calibrated force before the low pass
+  float rate[LOADCELL_BLOCK_SIZE];         // Kalman estimate of the loading rate
+  float rateVariance[LOADCELL_BLOCK_SIZE];
+  int64_t timestamp[LOADCELL_BLOCK_SIZE];
+};
+
+// Common interface of the load cell ADCs (HX711, ADS1220, ...).
+// A driver implements the chip access: is_ready(), read_raw(), gain, rate and power.
+// Everything behind it (capture, filter, calibration, health) lives here and only
+// depends on the sample timestamps, so it works the same at 10 SPS and at 2 kSPS.
+class LoadCellADC
+{
+protected:
+  byte DRDY;     // data ready pin, low while a conversion is ready
+  uint16_t RATE; // configured output data rate in SPS
+
+  // set by backends that can not read the conversion out inside the data-ready
+  // interrupt; the interrupt then only flags the conversion and poll() reads it
+  bool deferredReadout = false;
+
+  // read a conversion that is ready, protected against interrupts
+  virtual long read_raw() = 0;
+
+  // read a conversion that is ready from inside the data-ready interrupt;
+  // only used without deferredReadout
+  virtual long read_raw_isr();
+
+  // set the output data rate the downstream processing expects
+  void set_nominal_rate(uint16_t sps);
+
+  // start the health supervision, call from begin() of the driver
+  void begin_supervision();
+
+private:
+  float TARE_OFFSET = 0;          // used for tare weight
+  float ZEROPOINT_OFFSET_CAL = 0; // used for the basic zero point deviation of a sensor (calibrated)
+  float ZEROPOINT_CORRECTION = 0; // drift of the zero point on top of ZEROPOINT_OFFSET_CAL (zero tracking)
+  float SCALE_CAL = 1;            // used to return weight in grams, kg, ounces, whatever (calibrated)
+  float CURRENTREADING = 0;       // saves the last reading, to calculate weights.
+  int32_t CURRENTFIXED = 0;       // the same in fixed point, see Biquad::signalBits
+  int32_t ZEROPOINT_CAL_FIXED = 0; // ZEROPOINT_OFFSET_CAL in fixed point
+  int32_t ZEROPOINT_FIXED = 0;    // the same with ZEROPOINT_CORRECTION
+  int32_t SCALE_INV_FIXED = 0;    // 1000 / SCALE_CAL per fixed point step, SCALE_INV_BITS fraction bits
+  int SCALE_INV_BITS = 1;         // as many as fit in 30 bits, so every scale keeps its precision
+  CalibrationTable calibrationTable; // multi-point calibration
+  WindowStats lastReadings; // statistics of the last filtered readings
+  long RAWREADING = 0; // raw reading without filter
+  SpikeFilter spikeFilter;  // rejects single corrupted readings before the filter
+  ProfileFilter filterBank; // coefficients for the measured sample rate
+  KalmanCV kalman;          // calibrated force and its rate from the unfiltered readings
+  int64_t TIMESTAMP = 0;  // time of the last reading in us
+  float INTERVAL_AVG = 0; // averaged measured time between two readings in us
+  LoadCellHealthMonitor health;
+  SampleStats stats; // sequence numbers and interval statistics
+
+  // interrupt driven capture, see begin_capture()
+  static const size_t captureRingSize = 32;
+  SampleRing<LoadCellSample, captureRingSize> captureRing;
+  bool capturing = false;
+  TaskHandle_t notifyTask = NULL; // woken for every captured sample
+  volatile bool readoutPending = false;
+  volatile int64_t pendingTimestamp = 0;
+
+  // Wait for the chip to become ready
+  void wait_ready();
+
+  // Feed n consecutive samples through the pipeline one stage at a time: timing and
+  // health, spike filter, low pass, history, calibration and Kalman estimate.
+  // Every stage sees the samples in order, so the result does not depend on how
+  // the samples are split into blocks.
+  void process_block(const LoadCellSample *samples, size_t n, LoadCellBlock &block);
+
+  // filtered reading in fixed point to 1/1000 force units
+  int32_t calibrate(int32_t reading);
+
+  // fixed point form of the zero point and the scale, after every change of them
+  void update_calibration();
+
+  // clear and re-enable the data-ready interrupt after a readout
+  void rearm_drdy();
+
+  // data-ready falling edge: the conversion is ready, read it out and queue it
+  static void drdy_isr(void *arg);
+
+public:
+  LoadCellADC(uint16_t sps);
+
+  virtual ~LoadCellADC();
+
+  // Check if a conversion is ready
+  virtual bool is_ready() = 0;
+
+  // set the gain factor of the chip
+  virtual void set_gain(byte gain) = 0;
+
+  // puts the chip into power down mode
+  virtual void power_down() = 0;
+
+  // wakes up the chip after power down mode
+  virtual void power_up() = 0;
+
+  // waits for the chip to be ready and returns a reading
+  float read();
+
+  // Waits at most timeout_ms for the chip to be ready and reads it.
+  // returns false if there was no conversion in time
+  bool try_read(uint32_t timeout_ms = 0);
+
+  // sensor health at the current time, see LoadCellHealthMonitor
+  LoadCellHealth get_health();
+
+  // latest esp_timer time at which the next reading is due
+  int64_t get_health_deadline();
+
+  // Start the interrupt driven capture: every data-ready edge reads the conversion
+  // out (or flags it, see deferredReadout) and queues it with its timestamp.
+  // read() must not be used while capturing, drain the queue with poll() instead.
+  // If notify is given, that task receives a task notification for every sample.
+  void begin_capture(TaskHandle_t notify = NULL);
+
+  // stop the interrupt driven capture and drop all queued samples
+  void end_capture();
+
+  // Process the oldest captured sample, never waits for the chip.
+  // returns false if no sample was ready
+  bool poll();
+
+  // Process the captured samples, at most max (up to LOADCELL_BLOCK_SIZE), in one go
+  // and return their readings in block; never waits for the chip. The getters reflect
+  // the last sample of the block afterwards.
+  // returns the number of samples, 0 if none was ready
+  size_t poll_block(LoadCellBlock &block, size_t max = LOADCELL_BLOCK_SIZE);
+
+  // number of captured samples that were lost because poll() was not called in time
+  uint32_t get_capture_dropped();
+
+  // Sequence number of the last reading in conversion periods since the capture
+  // started; it skips a number for every conversion that was never read out.
+  uint32_t get_sequence();
+
+  // conversions that were overwritten unread since the capture started
+  uint32_t get_missed_conversions();
+
+  // sequence, missed conversions and the interval statistics;
+  // read from another task it is only a diagnostic snapshot
+  const SampleStats &get_sample_stats();
+
+  // clear the missed conversions and the interval statistics, the sequence continues;
+  // call it from the task that calls poll()
+  void reset_sample_stats();
+
+  // Configure the filter of the readings for a profile: low pass of order 2, 4 or 6 with
+  // the cutoff in Hz, optionally a notch (Hz), 0 disables it.
+  // Butterworth 2nd order at 2 Hz for all profiles by default. Call it before the capture.
+  // returns false if the sample rate is too low for it, the readings are unfiltered then
+  bool set_filter(FilterProfile profile, FilterResponse type, uint8_t order, float cutoff, float notch = 0);
+
+  // switch the filter profile without a step in the readings;
+  // call it from the task that calls poll()
+  void set_filter_profile(FilterProfile profile);
+
+  FilterProfile get_filter_profile();
+
+  // group delay of the selected filter profile at f = 0 in s,
+  // i.e. how long the filtered readings lag behind a slow ramp
+  float get_filter_delay();
+
+  // Replace single outliers by the median of the last window (3, 5, 7 or 9) readings
+  // before the filter, see SpikeFilter. window 0 disables it (default).
+  // returns false for an unsupported window
+  bool set_spike_filter(uint8_t window, float threshold = 5, float minDeviation = 0);
+
+  // number of raw readings replaced by the spike filter
+  uint32_t get_spike_count();
+
+  // configured output data rate in SPS
+  uint16_t get_rate();
+
+  // measured output data rate in SPS, based on the sample timestamps
+  float get_sample_rate();
+
+  float get_last_reading();
+
+  float get_last_reading_zeroed();
+
+  // mean of the last filtered readings, see set_average_window()
+  float get_lastreadings_avg();
+
+  // standard deviation of the last filtered readings
+  float get_lastreadings_stddev();
+
+  // mean, standard deviation, minimum and maximum of the last filtered readings;
+  // read from another task it is only a diagnostic snapshot
+  const WindowStats &get_reading_stats();
+
+  // Number of readings for the averages (20 by default), call it before the capture.
+  // returns false if the memory is not available
+  bool set_average_window(uint16_t samples);
+
+  float get_cal_force();
+
+  // calibrated force in 1/1000 force units (mN with the scale in counts per N),
+  // saturated at the int32_t range
+  int32_t get_cal_force_milli();
+
+  float get_tare_force();
+
+  long get_raw_reading();
+
+  // Kalman estimate of the calibrated force from the unfiltered readings;
+  // it does not lag behind like the low pass
+  float get_kalman_force();
+
+  // Kalman estimate of the loading rate dF/dt in force units per s
+  float get_force_rate();
+
+  // variances of the Kalman estimates
+  float get_kalman_force_variance();
+  float get_force_rate_variance();
+
+  // Tune the Kalman estimator, in calibrated force units:
+  // accelNoise: how fast the loading rate may change, per s^2 and sqrt(Hz)
+  // measurementNoise: standard deviation of a single unfiltered reading
+  void set_kalman_noise(float accelNoise, float measurementNoise);
+
+  // time of the last reading in us (esp_timer)
+  int64_t get_last_timestamp();
+
+  // convert 24 data bits (MSB first, 3 bytes) to a signed reading;
+  // anything after the third byte (e.g. the gain clocks of a SPI transfer) is ignored
+  static long word_to_sample(const uint8_t *data);
+
+  // Set the OFFSET value for tare weight to the average of times readings; blocks and
+  // must not be used while capturing, see TareJob for a tare that waits for settling.
+  void tare(byte times = 10);
+
+  // The calibration setters below must be called before the capture or from the task
+  // that calls poll(), see Acquisition::calibrate().
+
+  // set the SCALE value; this value is used to convert the raw data to "human readable" data (measure units)
+  void set_scale(float scale = 1.f);
+
+  // set the SCALE value; based on the current measurements and the KNOWN FORCE
+  void set_scale_current(float force);
+
+  // get the current SCALE
+  float get_scale();
+
+  // Readings per force unit at the zero point with the active calibration: the scale,
+  // or the slope of the multi-point calibration next to the zero point. For limits
+  // that are given in force units but apply to readings.
+  float get_sensitivity();
+
+  // set OFFSET, the value that's subtracted from the actual reading (tare weight)
+  void set_tare_offset(float offset = 0);
+
+  // get the current OFFSET
+  float get_tare_offset();
+
+  // set BASEOFFSET, the value that's subtracted from the actual reading (base tare weight);
+  // it clears the zero correction
+  void set_zeropoint_offset(float zeropoint_offset);
+
+  // set BASEOFFSET, based on the CURRENT measurements
+  void set_zeropoint_offset_current();
+
+  // get the current BASEOFFSET, without the zero correction
+  float get_zeropoint_offset();
+
+  // Drift of the zero point relative to BASEOFFSET, e.g. from ZeroTracker. It is kept
+  // apart from BASEOFFSET, so a correction of a fraction of a count is not lost in the
+  // float resolution of a large offset.
+  void set_zero_correction(float correction);
+
+  float get_zero_correction();
+
+  // Add a point to the multi-point calibration at the KNOWN FORCE, based on the current
+  // measurements like set_scale_current(). Once it has a point the table replaces the
+  // scale, the zero point still applies.
+  // returns false if the table is full or there is no load
+  bool add_calibration_point(float force);
+
+  // drop the multi-point calibration, the scale applies again
+  void clear_calibration_table();
+
+  // restore the points of the multi-point calibration, e.g. from the settings
+  bool set_calibration_table(const CalibrationTable::Point *points, uint8_t count);
+
+  // read it only while no calibration change is pending, see Acquisition::calibrate()
+  const CalibrationTable &get_calibration_table();
+};
@@ -0,0 +1,75 @@
+#include "loadcell_health.h"
+
+void LoadCellHealthMonitor::begin(uint32_t intervalUs, uint32_t disconnectUs, uint16_t stuck)
+{
+  interval = intervalUs;
+  disconnectTime = disconnectUs;
+  stuckCount = stuck;
+  sameCount = 0;
+}
+
+void LoadCellHealthMonitor::reset(int64_t now)
+{
+  lastTimestamp = now;
+  hasReading = false;
+  sameCount = 0;
+  sampleState = LOADCELL_HEALTH_STALE;
+}
+
+LoadCellHealth LoadCellHealthMonitor::sample(long raw, int64_t timestamp)
+{
+  if (hasReading && raw == lastRaw)
+  {
+    if (sameCount < stuckCount)
+      sameCount++;
+  }
+  else
+  {
+    sameCount = 0;
+  }
+  lastRaw = raw;
+  lastTimestamp = timestamp;
+  hasReading = true;
+
+  if (raw >= 0x7FFFFF || raw <= -0x800000)
+    sampleState = LOADCELL_HEALTH_SATURATED;
+  else if (sameCount >= stuckCount)
+    sampleState = LOADCELL_HEALTH_STUCK;
+  else
+    sampleState = LOADCELL_HEALTH_OK;
+  return sampleState;
+}
+
+LoadCellHealth LoadCellHealthMonitor::state(int64_t now) const
+{
+  int64_t age = now - lastTimestamp;
+  if (age > disconnectTime)
+    return LOADCELL_HEALTH_DISCONNECTED;
+  if (now > get_deadline())
+    return LOADCELL_HEALTH_STALE;
+  return sampleState;
+}
+
+int64_t LoadCellHealthMonitor::get_deadline() const
+{
+  return lastTimestamp + interval + interval / 2;
+}
+
+const char *LoadCellHealthMonitor::name(LoadCellHealth health)
+{
+  switch (health)
+  {
+  case LOADCELL_HEALTH_OK:
+    return "OK";
+  case LOADCELL_HEALTH_STALE:
+    return "STALE";
+  case LOADCELL_HEALTH_SATURATED:
+    return "SATUR.";
+  case LOADCELL_HEALTH_DISCONNECTED:
+    return "NO CONN";
+  case LOADCELL_HEALTH_STUCK:
+    return "STUCK";
+  default:
+    return "?";
+  }
+}
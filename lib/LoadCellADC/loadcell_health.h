@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+enum LoadCellHealth : uint8_t
+{
+  LOADCELL_HEALTH_OK,
+  LOADCELL_HEALTH_STALE,        // the last conversion is overdue
+  LOADCELL_HEALTH_SATURATED,    // reading at the end of the 24-bit range (0x7FFFFF / 0x800000)
+  LOADCELL_HEALTH_DISCONNECTED, // no conversion for a long time, e.g. unplugged cable
+  LOADCELL_HEALTH_STUCK,        // the very same reading over and over, a live ADC always has noise
+};
+
+// Sensor health state machine of a 24-bit load cell ADC.
+// sample() is fed with every reading, state() adds the timing checks for the current time.
+// No Arduino dependencies, the readings and times are passed in.
+class LoadCellHealthMonitor
+{
+private:
+  uint32_t interval = 100000;        // expected time between two readings in us
+  uint32_t disconnectTime = 1000000; // no reading for that long is DISCONNECTED
+  uint16_t stuckCount = 50;          // that many identical readings in a row are STUCK
+  int64_t lastTimestamp = 0; // last reading, or the start of the supervision
+  bool hasReading = false;
+  long lastRaw = 0;
+  uint16_t sameCount = 0;
+  LoadCellHealth sampleState = LOADCELL_HEALTH_STALE;
+
+public:
+  // interval: expected time between two readings in us (1e6 / SPS)
+  // disconnect: time without readings until the sensor counts as disconnected in us
+  // stuck: number of identical readings in a row until the sensor counts as stuck
+  void begin(uint32_t interval, uint32_t disconnect = 1000000, uint16_t stuck = 50);
+
+  // start the supervision at time now in us, without any reading so far
+  void reset(int64_t now);
+
+  // evaluate a new reading, returns the resulting state
+  LoadCellHealth sample(long raw, int64_t timestamp);
+
+  // state at time now in us: a reading is STALE after 1.5 intervals
+  LoadCellHealth state(int64_t now) const;
+
+  // latest time at which the next reading has to arrive before the state turns STALE
+  int64_t get_deadline() const;
+
+  static const char *name(LoadCellHealth health);
+};
@@ -0,0 +1,68 @@
+#include "noise_test.h"
+
+#include <math.h>
+
+void NoiseTest::begin(uint32_t count, uint8_t dataBits)
+{
+  samples = count;
+  bits = dataBits;
+  stats.reset();
+}
+
+void NoiseTest::cancel()
+{
+  samples = 0;
+}
+
+bool NoiseTest::push(long raw)
+{
+  if (!is_running())
+    return false;
+  stats.push(raw);
+  return is_done();
+}
+
+bool NoiseTest::is_running() const
+{
+  return samples > 0 && stats.get_count() < samples;
+}
+
+bool NoiseTest::is_done() const
+{
+  return samples > 0 && stats.get_count() >= samples;
+}
+
+float NoiseTest::get_progress() const
+{
+  if (samples == 0)
+    return 0;
+  return (float)stats.get_count() / samples;
+}
+
+uint32_t NoiseTest::get_count() const
+{
+  return stats.get_count();
+}
+
+float NoiseTest::get_rms() const
+{
+  return stats.get_stddev();
+}
+
+float NoiseTest::get_peak_to_peak() const
+{
+  return stats.get_max() - stats.get_min();
+}
+
+float NoiseTest::get_effective_bits() const
+{
+  // below one count the ADC resolves all its bits
+  float rms = get_rms();
+  return rms > 1 ? bits - log2f(rms) : bits;
+}
+
+float NoiseTest::get_noise_free_bits() const
+{
+  float peakToPeak = get_peak_to_peak();
+  return peakToPeak > 1 ? bits - log2f(peakToPeak) : bits;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "running_stats.h"
+
+// Noise floor of the load cell from a number of raw readings, e.g. to tell a degraded
+// cell, bad wiring or motor interference apart from a good setup. Fed one reading at a
+// time with constant memory. The resolution follows the conventions of the ADC
+// datasheets: effective bits log2(full scale / RMS noise), noise-free bits
+// log2(full scale / peak-to-peak noise). A drift during the test counts as noise.
+class NoiseTest
+{
+private:
+  RunningStats stats;
+  uint32_t samples = 0; // readings of the test, 0 = not running
+  uint8_t bits = 24;    // data bits of the ADC
+
+public:
+  // start over with samples raw readings of an ADC with bits data bits
+  void begin(uint32_t samples, uint8_t bits = 24);
+
+  // stop the test, the results of the readings so far stay available
+  void cancel();
+
+  // add a raw reading; only counts while running, returns true once the test is done
+  bool push(long raw);
+
+  bool is_running() const;
+
+  // all readings of the test are in
+  bool is_done() const;
+
+  // 0 to 1: readings so far
+  float get_progress() const;
+
+  uint32_t get_count() const;
+
+  // RMS noise (standard deviation) in counts
+  float get_rms() const;
+
+  // peak-to-peak noise in counts
+  float get_peak_to_peak() const;
+
+  // effective number of bits
+  float get_effective_bits() const;
+
+  float get_noise_free_bits() const;
+};
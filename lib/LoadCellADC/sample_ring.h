@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-size single-producer / single-consumer ring buffer.
+// The producer (e.g. the DOUT interrupt) only writes `head`, the consumer (e.g. loop())
+// only writes `tail`, so no lock is needed. The capacity N must be a power of two;
+// one slot is kept free to tell "full" from "empty".
+// No Arduino dependencies, so the buffer can also be compiled on a host.
+template <typename T, size_t N>
+class SampleRing
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SampleRing size must be a power of two");
+
+private:
+  T buffer[N];
+  std::atomic<size_t> head{0}; // next slot to write (producer)
+  std::atomic<size_t> tail{0}; // next slot to read (consumer)
+  std::atomic<uint32_t> dropped{0};
+
+public:
+  // producer side: returns false (and counts a drop) if the buffer is full
+  bool push(const T &item)
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t next = (h + 1) & (N - 1);
+    if (next == tail.load(std::memory_order_acquire))
+    {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    buffer[h] = item;
+    head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side: returns false if the buffer is empty
+  bool pop(T &item)
+  {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire))
+      return false;
+    item = buffer[t];
+    tail.store((t + 1) & (N - 1), std::memory_order_release);
+    return true;
+  }
+
+  // consumer side: move up to max items into dst, returns the number of items
+  size_t pop_block(T *dst, size_t max)
+  {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t n = (head.load(std::memory_order_acquire) - t) & (N - 1);
+    if (n > max)
+      n = max;
+    for (size_t i = 0; i < n; i++)
+    {
+      dst[i] = buffer[(t + i) & (N - 1)];
+    }
+    tail.store((t + n) & (N - 1), std::memory_order_release);
+    return n;
+  }
+
+  // number of items ready for the consumer
+  size_t available() const
+  {
+    return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & (N - 1);
+  }
+
+  bool empty() const
+  {
+    return available() == 0;
+  }
+
+  static constexpr size_t capacity()
+  {
+    return N - 1;
+  }
+
+  // number of items rejected because the consumer did not keep up
+  uint32_t get_dropped() const
+  {
+    return dropped.load(std::memory_order_relaxed);
+  }
+
+  // consumer side only: discard everything that is queued
+  void clear()
+  {
+    tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+};
@@ -0,0 +1,111 @@
+#include "sample_stats.h"
+
+void SampleStats::begin(uint32_t interval)
+{
+  nominal = interval;
+  lastTimestamp = 0;
+  sequence = 0;
+  reset();
+}
+
+void SampleStats::reset()
+{
+  for (int i = 0; i < binCount; i++)
+  {
+    bins[i] = 0;
+  }
+  missed = 0;
+  count = 0;
+  sum = 0;
+  minInterval = 0;
+  maxInterval = 0;
+}
+
+uint32_t SampleStats::sample(int64_t timestamp)
+{
+  if (lastTimestamp == 0)
+  {
+    lastTimestamp = timestamp;
+    return 0;
+  }
+
+  int64_t interval = timestamp - lastTimestamp;
+  lastTimestamp = timestamp;
+  if (interval <= 0)
+    return 0;
+
+  // whole conversion periods since the previous sample
+  uint32_t periods = (uint32_t)((interval + nominal / 2) / nominal);
+  if (periods < 1)
+    periods = 1;
+  sequence += periods;
+  missed += periods - 1;
+
+  // only consecutive conversions tell the jitter
+  if (periods == 1)
+  {
+    int bin = (int)((interval - nominal / 2) * binCount / nominal);
+    if (bin < 0)
+      bin = 0;
+    if (bin >= binCount)
+      bin = binCount - 1;
+    bins[bin]++;
+
+    if (count == 0 || interval < minInterval)
+      minInterval = interval;
+    if (interval > maxInterval)
+      maxInterval = interval;
+    sum += interval;
+    count++;
+  }
+  return periods;
+}
+
+uint32_t SampleStats::get_sequence() const
+{
+  return sequence;
+}
+
+uint32_t SampleStats::get_missed() const
+{
+  return missed;
+}
+
+uint32_t SampleStats::get_count() const
+{
+  return count;
+}
+
+float SampleStats::get_min() const
+{
+  return minInterval;
+}
+
+float SampleStats::get_mean() const
+{
+  if (count == 0)
+    return 0;
+  return (float)sum / count;
+}
+
+float SampleStats::get_max() const
+{
+  return maxInterval;
+}
+
+float SampleStats::get_percentile(float p) const
+{
+  if (count == 0)
+    return 0;
+
+  // upper edge of the bin that reaches the requested share of the intervals
+  uint32_t target = (uint32_t)(p / 100 * count + 0.999f);
+  uint32_t cumulative = 0;
+  for (int i = 0; i < binCount; i++)
+  {
+    cumulative += bins[i];
+    if (cumulative >= target)
+      return nominal / 2 + (float)(i + 1) * nominal / binCount;
+  }
+  return maxInterval;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+// Timing statistics of a stream of conversions.
+// Every sample gets a sequence number counted in conversion periods, derived from the
+// measured time since the previous sample, so a conversion that was overwritten unread
+// advances the sequence by two and counts as missed. The intervals between consecutive
+// conversions go into a histogram for the jitter statistics.
+// Written by the task that processes the samples, the getters may be read by another
+// task for diagnostics. No Arduino dependencies, the times are passed in.
+class SampleStats
+{
+private:
+  static const int binCount = 64; // histogram from 0.5 to 1.5 nominal intervals
+  uint32_t bins[binCount];
+  uint32_t nominal = 100000; // expected time between two conversions in us
+  int64_t lastTimestamp = 0;
+  uint32_t sequence = 0;
+  uint32_t missed = 0;
+  uint32_t count = 0; // intervals in the histogram
+  uint64_t sum = 0;
+  uint32_t minInterval = 0;
+  uint32_t maxInterval = 0;
+
+public:
+  // interval: expected time between two conversions in us (1e6 / SPS)
+  // starts over, the next sample gets the sequence number 0
+  void begin(uint32_t interval);
+
+  // clear the missed conversions and the interval statistics, the sequence continues
+  void reset();
+
+  // account a sample converted at timestamp in us
+  // returns the number of conversion periods since the previous sample (0 for the first)
+  uint32_t sample(int64_t timestamp);
+
+  // sequence number of the last sample
+  uint32_t get_sequence() const;
+
+  // conversions that were never read out
+  uint32_t get_missed() const;
+
+  // number of intervals between two consecutive conversions in the statistics
+  uint32_t get_count() const;
+
+  // statistics of the intervals between two consecutive conversions in us;
+  // the percentile has the resolution of a histogram bin (1/64 nominal interval)
+  float get_min() const;
+  float get_mean() const;
+  float get_max() const;
+  float get_percentile(float p) const;
+};
@@ -0,0 +1,70 @@
+#include "tare_job.h"
+
+bool TareJob::begin(uint16_t window, float limit, uint32_t timeoutMs)
+{
+  if (window != stats.get_window() && !stats.begin(window))
+  {
+    state = TARE_IDLE;
+    return false;
+  }
+  stats.reset();
+  maxStddev = limit;
+  timeout = (int64_t)timeoutMs * 1000;
+  startTime = 0;
+  state = TARE_RUNNING;
+  return true;
+}
+
+void TareJob::cancel()
+{
+  state = TARE_IDLE;
+}
+
+TareState TareJob::push(float reading, int64_t timestamp)
+{
+  if (state != TARE_RUNNING)
+    return state;
+
+  if (stats.get_count() == 0)
+    startTime = timestamp;
+  stats.push(reading);
+
+  if (stats.is_full() && stats.get_stddev() <= maxStddev)
+  {
+    result = stats.get_mean();
+    state = TARE_DONE;
+  }
+  else if (timestamp - startTime >= timeout)
+  {
+    state = TARE_MOVING;
+  }
+  return state;
+}
+
+TareState TareJob::get_state() const
+{
+  return state;
+}
+
+float TareJob::get_progress() const
+{
+  if (state == TARE_DONE)
+    return 1;
+  if (stats.get_window() == 0)
+    return 0;
+  float progress = (float)stats.get_count() / stats.get_window();
+  float stddev = stats.get_stddev();
+  if (stddev > maxStddev)
+    progress *= maxStddev / stddev;
+  return progress;
+}
+
+float TareJob::get_stddev() const
+{
+  return stats.get_stddev();
+}
+
+float TareJob::get_result() const
+{
+  return result;
+}
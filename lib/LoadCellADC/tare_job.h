@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "window_stats.h"
+
+enum TareState : uint8_t
+{
+  TARE_IDLE,    // not started or canceled
+  TARE_RUNNING, // collecting readings
+  TARE_DONE,    // settled, see get_result()
+  TARE_MOVING,  // did not settle before the timeout, no result
+};
+
+// Zero point (or tare) from readings that have settled, fed one reading at a time so
+// it never waits. The job collects readings until the standard deviation over the last
+// window falls below a limit and takes the mean of that window. A drift of d over the
+// window shows as a standard deviation of d / sqrt(12), so a load that still moves or
+// creeps keeps the job from settling; after the timeout it fails instead.
+class TareJob
+{
+private:
+  WindowStats stats;
+  float maxStddev = 0;
+  int64_t timeout = 0;   // in us
+  int64_t startTime = 0; // timestamp of the first reading
+  TareState state = TARE_IDLE;
+  float result = 0;
+
+public:
+  // Start over: window readings per window, settled below maxStddev (reading units),
+  // give up after timeout ms of reading time.
+  // returns false if the memory for the window is not available
+  bool begin(uint16_t window, float maxStddev, uint32_t timeout);
+
+  // stop the job, it drops to TARE_IDLE
+  void cancel();
+
+  // add a reading; only counts while running, returns the state after it
+  TareState push(float reading, int64_t timestamp);
+
+  TareState get_state() const;
+
+  // 0 to 1: how far the window is filled, times how close the deviation is to the limit
+  float get_progress() const;
+
+  // standard deviation of the current window
+  float get_stddev() const;
+
+  // mean of the settled window, valid in TARE_DONE
+  float get_result() const;
+};
@@ -0,0 +1,62 @@
+#include "zero_tracker.h"
+
+#include <math.h>
+
+bool ZeroTracker::begin(uint16_t window)
+{
+  bool ok = stats.begin(window);
+  hold();
+  return ok;
+}
+
+void ZeroTracker::set_limits(float stddev, float trackBand, float limit, float rate)
+{
+  maxStddev = stddev;
+  band = trackBand;
+  maxCorrection = limit;
+  maxRate = rate;
+}
+
+void ZeroTracker::set_reference(float value)
+{
+  reference = value;
+  correction = 0;
+  hold();
+}
+
+void ZeroTracker::hold()
+{
+  stats.reset();
+  lastTime = 0;
+}
+
+float ZeroTracker::update(float reading, int64_t timestamp)
+{
+  float dt = lastTime != 0 ? (timestamp - lastTime) / 1.0e6f : 0;
+  lastTime = timestamp;
+  stats.push(reading - reference);
+  if (!stats.is_full() || stats.get_stddev() > maxStddev)
+    return correction;
+
+  float error = stats.get_mean() - correction;
+  if (fabsf(error) > band)
+    return correction;
+
+  // towards the mean at the limited rate, within the limit around the reference
+  float step = maxRate * dt;
+  if (error > step)
+    error = step;
+  else if (error < -step)
+    error = -step;
+  correction += error;
+  if (correction > maxCorrection)
+    correction = maxCorrection;
+  else if (correction < -maxCorrection)
+    correction = -maxCorrection;
+  return correction;
+}
+
+float ZeroTracker::get_correction() const
+{
+  return correction;
+}
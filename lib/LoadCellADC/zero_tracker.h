@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "window_stats.h"
+
+// Automatic zero tracking against a slow drift (temperature) while the machine is idle.
+// The zero point only follows the readings while they are provably static: the window
+// is full, its standard deviation is below a limit and its mean is within a band around
+// the zero point, so a real load is never tracked away. The zero point moves towards
+// that mean at a limited rate and never further than a limit from the reference, the
+// zero point set by the calibration. O(1) per reading.
+// The tracker works on the readings minus the reference: the correction stays a small
+// number, so steps of a fraction of a count add up even at a large zero point.
+class ZeroTracker
+{
+private:
+  WindowStats stats;
+  float maxStddev = 0;
+  float band = 0;
+  float maxCorrection = 0;
+  float maxRate = 0; // per s
+  float reference = 0;
+  float correction = 0; // tracked zero point minus the reference
+  int64_t lastTime = 0; // timestamp of the last reading
+
+public:
+  // window: readings per window
+  // returns false if the memory for the window is not available
+  bool begin(uint16_t window);
+
+  // maxStddev: static below that standard deviation
+  // band: only readings within that distance of the zero point are tracked
+  // maxCorrection: largest distance from the reference, maxRate: largest change per s
+  // all in reading units, 0 until set; the correction so far is kept
+  void set_limits(float maxStddev, float band, float maxCorrection, float maxRate);
+
+  // a new zero point from the calibration, the correction starts over from it
+  void set_reference(float zero);
+
+  // drop the window, e.g. while the machine moves; tracking needs a full window again
+  void hold();
+
+  // add a reading, returns the correction
+  float update(float reading, int64_t timestamp);
+
+  // tracked zero point minus the reference
+  float get_correction() const;
+};
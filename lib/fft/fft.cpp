@@ -0,0 +1,123 @@
+#include "fft.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+FFT::~FFT() {
+  free(cosTable);
+  free(sinTable);
+}
+
+bool FFT::begin(uint16_t n) {
+  free(cosTable);
+  free(sinTable);
+  cosTable = sinTable = NULL;
+  size = 0;
+  if (n < 2 || (n & (n - 1)) != 0)
+    return false;
+
+  cosTable = (float *)malloc(n / 2 * sizeof(float));
+  sinTable = (float *)malloc(n / 2 * sizeof(float));
+  if (cosTable == NULL || sinTable == NULL) {
+    free(cosTable);
+    free(sinTable);
+    cosTable = sinTable = NULL;
+    return false;
+  }
+
+  for (uint16_t k = 0; k < n / 2; k++) {
+    double phi = 2 * M_PI * k / n;
+    cosTable[k] = cos(phi);
+    sinTable[k] = sin(phi);
+  }
+  size = n;
+  return true;
+}
+
+uint16_t FFT::get_size() const {
+  return size;
+}
+
+void FFT::transform(float *re, float *im) const {
+  uint16_t n = size;
+
+  // bit reversed order
+  for (uint16_t i = 1, j = 0; i < n; i++) {
+    uint16_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      float t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+      t = im[i];
+      im[i] = im[j];
+      im[j] = t;
+    }
+  }
+
+  // butterflies
+  // 32 bit, len reaches 2 n, which does not fit in 16 bits for the largest n
+  for (uint32_t len = 2; len <= n; len <<= 1) {
+    uint32_t half = len >> 1;
+    uint32_t step = n / len;
+    for (uint32_t i = 0; i < n; i += len) {
+      for (uint32_t k = 0; k < half; k++) {
+        float wr = cosTable[k * step];
+        float wi = -sinTable[k * step];
+        uint32_t a = i + k;
+        uint32_t b = a + half;
+        float vr = re[b] * wr - im[b] * wi;
+        float vi = re[b] * wi + im[b] * wr;
+        re[b] = re[a] - vr;
+        im[b] = im[a] - vi;
+        re[a] += vr;
+        im[a] += vi;
+      }
+    }
+  }
+}
+
+void FFT::detrend(float *x, uint16_t n) {
+  if (n == 0)
+    return;
+  // line a + b t with t centered, so a is the mean and b is independent of it
+  double center = (n - 1) / 2.0;
+  double sum = 0, sumT = 0, sumTT = 0;
+  for (uint16_t i = 0; i < n; i++) {
+    sum += x[i];
+  }
+  double mean = sum / n;
+  for (uint16_t i = 0; i < n; i++) {
+    double t = i - center;
+    sumT += t * (x[i] - mean);
+    sumTT += t * t;
+  }
+  double slope = sumTT > 0 ? sumT / sumTT : 0;
+  for (uint16_t i = 0; i < n; i++) {
+    x[i] = (float)(x[i] - mean - slope * (i - center));
+  }
+}
+
+void FFT::hann(float *x, uint16_t n) {
+  for (uint16_t i = 0; i < n; i++) {
+    x[i] *= 0.5f * (1 - cosf(2 * (float)M_PI * i / n));
+  }
+}
+
+float FFT::hann_power(uint16_t n) {
+  return 3.0f * n / 8;
+}
+
+void FFT::density(float *re, const float *im, uint16_t n, float fs, float windowPower) {
+  float scale = 1 / (fs * windowPower);
+  for (uint16_t k = 0; k <= n / 2; k++) {
+    float power = (re[k] * re[k] + im[k] * im[k]) * scale;
+    // all bins but DC and Nyquist also hold the negative frequencies
+    if (k != 0 && k != n / 2)
+      power *= 2;
+    re[k] = sqrtf(power);
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// In-place radix-2 FFT of complex float data with precomputed twiddle factors,
+// plus the Hann window and the amplitude spectral density for noise analysis.
+// No Arduino dependencies, so it can also be used by host tools.
+class FFT {
+ private:
+  float *cosTable = NULL;  // cos(2 pi k / n), k < n / 2
+  float *sinTable = NULL;  // sin(2 pi k / n), k < n / 2
+  uint16_t size = 0;
+
+ public:
+  ~FFT();
+
+  // allocate the twiddle factors for n points, n a power of two
+  // returns false for another n or if the memory is not available
+  bool begin(uint16_t n);
+
+  uint16_t get_size() const;
+
+  // forward transform in place, unscaled: X[k] = sum x[i] exp(-2 pi j i k / n)
+  void transform(float *re, float *im) const;
+
+  // Subtract the least squares line from n values, so the offset and a slow drift do
+  // not leak into the lowest bins.
+  static void detrend(float *x, uint16_t n);
+
+  // multiply x by a periodic Hann window of n points
+  static void hann(float *x, uint16_t n);
+
+  // sum of the squared Hann window values, 3 n / 8
+  static float hann_power(uint16_t n);
+
+  // One-sided amplitude spectral density in units/sqrt(Hz) of a transform of n points
+  // sampled at fs, windowed with a window of the given power (sum of w^2).
+  // The n / 2 + 1 values for 0 ... fs / 2 are written to re.
+  static void density(float *re, const float *im, uint16_t n, float fs, float windowPower);
+};
@@ -0,0 +1,170 @@
+#include "biquad.h"
+
+#include <math.h>
+
+// Bessel pole pairs normalized to -3 dB at 1 rad/s: frequency and quality per section
+static const float besselPoles[3][3][2] = {
+    {{1.27202f, 0.57735f}},                                            // order 2
+    {{1.43017f, 0.52193f}, {1.60336f, 0.80554f}},                      // order 4
+    {{1.60392f, 0.51032f}, {1.68917f, 0.61119f}, {1.90471f, 1.02331f}} // order 6
+};
+
+float Biquad::dc_group_delay() const {
+  // tau(0) = sum(k * b_k) / sum(b_k) - sum(k * a_k) / sum(a_k)
+  return (b1 + 2 * b2) / (b0 + b1 + b2) - (a1 + 2 * a2) / (1 + a1 + a2);
+}
+
+void Biquad::settle(float x) {
+  float y = dc_gain() * x;
+  z2 = b2 * x - a2 * y;
+  z1 = y - b0 * x;
+}
+
+void Biquad::quantize() {
+  const float one = 1 << coefBits;
+  qb0 = lroundf(b0 * one);
+  qb1 = lroundf(b1 * one);
+  qb2 = lroundf(b2 * one);
+  qa1 = lroundf(a1 * one);
+  qa2 = lroundf(a2 * one);
+  // Low pass and notch have a gain of 1 at f = 0. Rounding a1 and a2 would change it
+  // a lot for a low cutoff, where 1 + a1 + a2 is tiny, so b1 takes up the difference.
+  qb1 += ((int32_t)1 << coefBits) + qa1 + qa2 - (qb0 + qb1 + qb2);
+}
+
+void Biquad::settle_fixed(int32_t x) {
+  qz2 = (int64_t)qb2 * x - (int64_t)qa2 * x;
+  qz1 = (int64_t)x * (1 << coefBits) - (int64_t)qb0 * x;
+}
+
+// section from the analog prototype 1 / (s^2 / w0^2 + s / (w0 Q) + 1), bilinear
+// transform prewarped at f0 (RBJ cookbook)
+static void lowpass(Biquad &s, float f0, float q, float fs) {
+  float w0 = 2 * (float)M_PI * f0 / fs;
+  float cosw0 = cosf(w0);
+  float alpha = sinf(w0) / (2 * q);
+  float a0 = 1 + alpha;
+  s.b0 = (1 - cosw0) / 2 / a0;
+  s.b1 = (1 - cosw0) / a0;
+  s.b2 = s.b0;
+  s.a1 = -2 * cosw0 / a0;
+  s.a2 = (1 - alpha) / a0;
+}
+
+static void notch(Biquad &s, float f0, float q, float fs) {
+  float w0 = 2 * (float)M_PI * f0 / fs;
+  float cosw0 = cosf(w0);
+  float alpha = sinf(w0) / (2 * q);
+  float a0 = 1 + alpha;
+  s.b0 = 1 / a0;
+  s.b1 = -2 * cosw0 / a0;
+  s.b2 = s.b0;
+  s.a1 = s.b1;
+  s.a2 = (1 - alpha) / a0;
+}
+
+void BiquadBank::set_lowpass(FilterResponse type, uint8_t n, float f0) {
+  response = type;
+  order = n;
+  cutoff = f0;
+}
+
+void BiquadBank::set_notch(float f0, float q) {
+  notchFreq = f0;
+  notchQ = q;
+}
+
+bool BiquadBank::begin(float rate) {
+  fs = rate;
+  bool ok = setCoef();
+  reset();
+  reset_fixed();
+  return ok;
+}
+
+bool BiquadBank::set_sample_rate(float rate) {
+  fs = rate;
+  return setCoef();
+}
+
+float BiquadBank::get_sample_rate() const {
+  return fs;
+}
+
+int BiquadBank::get_section_count() const {
+  return sectionCount;
+}
+
+bool BiquadBank::setCoef() {
+  sectionCount = 0;
+  uint8_t pairs = order / 2;
+  if (pairs < 1 || pairs > 3 || order % 2 != 0)
+    return false;
+
+  for (int k = 0; k < pairs; k++) {
+    float f0 = cutoff;
+    float q;
+    if (response == FILTER_BESSEL) {
+      f0 *= besselPoles[pairs - 1][k][0];
+      q = besselPoles[pairs - 1][k][1];
+    } else {
+      q = 1 / (2 * cosf((2 * k + 1) * (float)M_PI / (4 * pairs)));
+    }
+    if (f0 >= fs / 2) {
+      sectionCount = 0;
+      return false;
+    }
+    lowpass(sections[sectionCount], f0, q, fs);
+    sections[sectionCount++].quantize();
+  }
+
+  if (notchFreq > 0) {
+    if (notchFreq >= fs / 2) {
+      sectionCount = 0;
+      return false;
+    }
+    notch(sections[sectionCount], notchFreq, notchQ, fs);
+    sections[sectionCount++].quantize();
+  }
+  return true;
+}
+
+float BiquadBank::filter(float x) {
+  for (int k = 0; k < sectionCount; k++) {
+    x = sections[k].filter(x);
+  }
+  return x;
+}
+
+void BiquadBank::filter_block(float *x, int n) {
+  for (int k = 0; k < sectionCount; k++) {
+    sections[k].filter_block(x, n);
+  }
+}
+
+void BiquadBank::filter_block(int32_t *x, int n) {
+  for (int k = 0; k < sectionCount; k++) {
+    sections[k].filter_block(x, n);
+  }
+}
+
+void BiquadBank::reset(float x) {
+  for (int k = 0; k < sectionCount; k++) {
+    sections[k].settle(x);
+    x *= sections[k].dc_gain();
+  }
+}
+
+void BiquadBank::reset_fixed(int32_t x) {
+  for (int k = 0; k < sectionCount; k++) {
+    sections[k].settle_fixed(x);
+  }
+}
+
+float BiquadBank::get_group_delay() const {
+  float delay = 0;
+  for (int k = 0; k < sectionCount; k++) {
+    delay += sections[k].dc_group_delay();
+  }
+  return delay;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+
+enum FilterResponse : uint8_t {
+  FILTER_BUTTERWORTH,  // flat pass band
+  FILTER_BESSEL,       // flat group delay, (almost) no overshoot on a step
+};
+
+// Second-order section in transposed direct form II.
+// The fixed point form works on integer counts with signalBits fraction bits and gives
+// the same result on every platform; its coefficients come from quantize().
+struct Biquad {
+  static const int signalBits = 6;  // fraction bits of the fixed point signal
+  static const int coefBits = 28;   // fraction bits of the fixed point coefficients
+
+  float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+  float z1 = 0, z2 = 0;
+  int32_t qb0 = 1 << coefBits, qb1 = 0, qb2 = 0, qa1 = 0, qa2 = 0;
+  int64_t qz1 = 0, qz2 = 0;  // coefBits + signalBits fraction bits
+
+  float filter(float x) {
+    float y = b0 * x + z1;
+    z1 = b1 * x - a1 * y + z2;
+    z2 = b2 * x - a2 * y;
+    return y;
+  }
+
+  // filter n samples in place, the same arithmetic as filter() with the state in registers
+  void filter_block(float *x, int n) {
+    float s1 = z1, s2 = z2;
+    for (int i = 0; i < n; i++) {
+      float y = b0 * x[i] + s1;
+      s1 = b1 * x[i] - a1 * y + s2;
+      s2 = b2 * x[i] - a2 * y;
+      x[i] = y;
+    }
+    z1 = s1;
+    z2 = s2;
+  }
+
+  // The feedback also takes the rounding error e of y, otherwise it is amplified by
+  // 1 / (1 + a1 + a2) to a dead band around the steady state, many counts wide for a
+  // low cutoff at a high sample rate.
+  int32_t filter(int32_t x) {
+    int64_t acc = (int64_t)qb0 * x + qz1;
+    int32_t y = (int32_t)((acc + (1 << (coefBits - 1))) >> coefBits);
+    int64_t e = acc - ((int64_t)y << coefBits);  // coefBits fraction bits of y
+    qz1 = (int64_t)qb1 * x - (int64_t)qa1 * y - (((int64_t)qa1 * e) >> coefBits) + qz2;
+    qz2 = (int64_t)qb2 * x - (int64_t)qa2 * y - (((int64_t)qa2 * e) >> coefBits);
+    return y;
+  }
+
+  // filter n fixed point samples in place
+  void filter_block(int32_t *x, int n) {
+    for (int i = 0; i < n; i++) {
+      x[i] = filter(x[i]);
+    }
+  }
+
+  // fixed point coefficients from the float ones, with the gain at f = 0 kept at 1
+  void quantize();
+
+  // gain at f = 0
+  float dc_gain() const { return (b0 + b1 + b2) / (1 + a1 + a2); }
+
+  // group delay at f = 0 in samples
+  float dc_group_delay() const;
+
+  // set the state to the steady state of a constant input x
+  void settle(float x);
+
+  // the same for the fixed point state, for a section with a gain of 1 at f = 0
+  void settle_fixed(int32_t x);
+};
+
+// Cascade of second-order sections: a low pass of order 2, 4 or 6 and an optional notch.
+// The sections are computed by begin() and set_sample_rate(), never per sample.
+// The float and the fixed point form (see Biquad) have separate states.
+// Both low pass responses are normalized to -3 dB at the cutoff frequency.
+class BiquadBank {
+ private:
+  static const int maxSections = 4;  // 6th order low pass + notch
+  Biquad sections[maxSections];
+  int sectionCount = 0;
+  FilterResponse response = FILTER_BUTTERWORTH;
+  uint8_t order = 2;
+  float cutoff = 2;
+  float notchFreq = 0;
+  float notchQ = 30;
+  float fs = 0;
+
+  // recompute the coefficients, returns false if a frequency is not below fs / 2
+  bool setCoef();
+
+ public:
+  // low pass response, order 2, 4 or 6, cutoff f0 (Hz); takes effect with begin()
+  void set_lowpass(FilterResponse type, uint8_t order, float f0);
+
+  // notch at f0 (Hz) with quality q, e.g. 50 Hz mains pickup; f0 = 0 disables it
+  // takes effect with begin()
+  void set_notch(float f0, float q = 30);
+
+  // compute the sections for the sample rate fs (Hz) and clear the state
+  // returns false if the sample rate is too low for the filter, it passes the signal then
+  bool begin(float fs);
+
+  // compute the sections for another sample rate, the filter state is kept
+  bool set_sample_rate(float fs);
+
+  float get_sample_rate() const;
+
+  int get_section_count() const;
+
+  float filter(float x);
+
+  // filter n samples in place, section by section; the result is identical to
+  // filter() on every sample
+  void filter_block(float *x, int n);
+
+  // the same in fixed point, see Biquad::signalBits
+  void filter_block(int32_t *x, int n);
+
+  // set all sections to the steady state of a constant input x
+  void reset(float x = 0);
+
+  // the same for the fixed point state
+  void reset_fixed(int32_t x = 0);
+
+  // group delay at f = 0 in samples, i.e. how much a slow ramp lags behind
+  float get_group_delay() const;
+};
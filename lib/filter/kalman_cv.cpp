@@ -0,0 +1,68 @@
+#include "kalman_cv.h"
+
+void KalmanCV::begin(float accelNoise, float measurementNoise) {
+  q = accelNoise * accelNoise;
+  r = measurementNoise * measurementNoise;
+  reset();
+}
+
+void KalmanCV::reset() {
+  hasValue = false;
+  hasRate = false;
+  x0 = x1 = 0;
+  p00 = p01 = p11 = 0;
+}
+
+void KalmanCV::update(float z, float dt) {
+  if (!hasValue || dt <= 0) {
+    // first measurement: the value is known, the rate is not
+    x0 = z;
+    p00 = r;
+    hasValue = true;
+    return;
+  }
+  if (!hasRate) {
+    // second measurement: the rate from two points
+    x1 = (z - x0) / dt;
+    x0 = z;
+    p00 = r;
+    p01 = r / dt;
+    p11 = 2 * r / (dt * dt);
+    hasRate = true;
+    return;
+  }
+
+  // predict: x = F x, P = F P F' + Q
+  float dt2 = dt * dt;
+  x0 += dt * x1;
+  p00 += dt * (2 * p01 + dt * p11) + q * dt2 * dt / 3;
+  p01 += dt * p11 + q * dt2 / 2;
+  p11 += q * dt;
+
+  // correct with the measurement of the value
+  float s = p00 + r;
+  float k0 = p00 / s;
+  float k1 = p01 / s;
+  float y = z - x0;
+  x0 += k0 * y;
+  x1 += k1 * y;
+  p11 -= k1 * p01;
+  p01 -= k0 * p01;
+  p00 -= k0 * p00;
+}
+
+float KalmanCV::get_value() const {
+  return x0;
+}
+
+float KalmanCV::get_rate() const {
+  return x1;
+}
+
+float KalmanCV::get_value_variance() const {
+  return p00;
+}
+
+float KalmanCV::get_rate_variance() const {
+  return p11;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Kalman filter with a constant-velocity model: the state is a value and its rate,
+// the rate changes by white noise. Works on irregular sample intervals.
+class KalmanCV {
+ private:
+  float x0 = 0, x1 = 0;             // value, rate
+  float p00 = 0, p01 = 0, p11 = 0;  // covariance
+  float q = 1;                      // spectral density of the rate change
+  float r = 1;                      // variance of a measurement
+  bool hasValue = false, hasRate = false;
+
+ public:
+  // accelNoise: how fast the rate may change, in units/s^2 per sqrt(Hz)
+  // measurementNoise: standard deviation of a measurement
+  void begin(float accelNoise, float measurementNoise);
+
+  // forget the state, the next measurement starts over
+  void reset();
+
+  // add a measurement z taken dt s after the previous one
+  void update(float z, float dt);
+
+  float get_value() const;
+
+  // rate in units/s
+  float get_rate() const;
+
+  float get_value_variance() const;
+
+  float get_rate_variance() const;
+};
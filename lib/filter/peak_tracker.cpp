@@ -0,0 +1,35 @@
+#include "peak_tracker.h"
+
+void PeakTracker::set_delay(float seconds) {
+  delay = seconds;
+}
+
+float PeakTracker::get_delay() const {
+  return delay;
+}
+
+void PeakTracker::reset(float initial) {
+  filteredMax = initial;
+  compensatedMax = initial;
+}
+
+void PeakTracker::update(float filtered, float unfiltered, float rate, float rateVariance) {
+  if (filtered > filteredMax)
+    filteredMax = filtered;
+  float compensated = filtered;
+  if (rate > 0 && rate * rate > 9 * rateVariance) {
+    compensated += rate * delay;
+    if (compensated > unfiltered)
+      compensated = unfiltered > filtered ? unfiltered : filtered;
+  }
+  if (compensated > compensatedMax)
+    compensatedMax = compensated;
+}
+
+float PeakTracker::get_filtered_max() const {
+  return filteredMax;
+}
+
+float PeakTracker::get_compensated_max() const {
+  return compensatedMax;
+}
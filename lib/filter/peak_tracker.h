@@ -0,0 +1,36 @@
+#pragma once
+
+// Maximum of a low pass filtered signal, with and without the lag of the filter.
+// On a ramp with the slope r a low pass lags behind by r times its group delay at f = 0.
+// Adding that back with a slope that does not lag (e.g. from KalmanCV) gives the peak
+// the signal really reached before a sudden drop, which the filtered maximum misses.
+// Only a slope that is significant compared to its own noise is added back, a noisy
+// slope estimate would otherwise push the maximum up on a static or slow load.
+// The compensated value never exceeds the unfiltered one: after a sudden drop the slope
+// estimate rings and may turn positive for a few samples while the filtered value is
+// still high, which would otherwise add up to a maximum far above the real one.
+class PeakTracker {
+ private:
+  float delay = 0;  // group delay of the filter in s
+  float filteredMax = 0;
+  float compensatedMax = 0;
+
+ public:
+  // group delay of the filter at f = 0 in s, see BiquadBank::get_group_delay()
+  void set_delay(float seconds);
+
+  float get_delay() const;
+
+  // start over, both maxima start at initial
+  void reset(float initial = 0);
+
+  // add a filtered value, the same value unfiltered, the slope of the signal in units/s
+  // and its variance; the lag is only compensated for a rising slope with 3 sigma
+  // certainty, up to the unfiltered value
+  void update(float filtered, float unfiltered, float rate, float rateVariance);
+
+  float get_filtered_max() const;
+
+  // maximum of the filtered values plus the lag of the filter, at least the filtered maximum
+  float get_compensated_max() const;
+};
@@ -0,0 +1,62 @@
+#include "profile_filter.h"
+
+BiquadBank &ProfileFilter::get_bank(FilterProfile profile) {
+  return banks[profile];
+}
+
+bool ProfileFilter::begin(float fs) {
+  bool ok = true;
+  for (int k = 0; k < FILTER_PROFILE_COUNT; k++) {
+    ok = banks[k].begin(fs) && ok;
+  }
+  lastOutput = 0;
+  lastFixed = 0;
+  return ok;
+}
+
+bool ProfileFilter::set_sample_rate(float fs) {
+  bool ok = true;
+  for (int k = 0; k < FILTER_PROFILE_COUNT; k++) {
+    ok = banks[k].set_sample_rate(fs) && ok;
+  }
+  return ok;
+}
+
+float ProfileFilter::get_sample_rate() const {
+  return banks[selected].get_sample_rate();
+}
+
+void ProfileFilter::select(FilterProfile profile) {
+  if (profile == selected || profile >= FILTER_PROFILE_COUNT)
+    return;
+  banks[profile].reset(lastOutput);
+  banks[profile].reset_fixed(lastFixed);
+  selected = profile;
+}
+
+FilterProfile ProfileFilter::get_selected() const {
+  return selected;
+}
+
+float ProfileFilter::filter(float x) {
+  lastOutput = banks[selected].filter(x);
+  return lastOutput;
+}
+
+void ProfileFilter::filter_block(float *x, int n) {
+  if (n <= 0)
+    return;
+  banks[selected].filter_block(x, n);
+  lastOutput = x[n - 1];
+}
+
+void ProfileFilter::filter_block(int32_t *x, int n) {
+  if (n <= 0)
+    return;
+  banks[selected].filter_block(x, n);
+  lastFixed = x[n - 1];
+}
+
+float ProfileFilter::get_group_delay() const {
+  return banks[selected].get_group_delay();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "biquad.h"
+
+enum FilterProfile : uint8_t {
+  FILTER_PROFILE_IDLE,  // strong smoothing for a steady display and calibration
+  FILTER_PROFILE_TEST,  // wide bandwidth, little lag on the peak and the break
+  FILTER_PROFILE_COUNT,
+};
+
+// One BiquadBank per profile, only the selected one runs.
+// Switching is bumpless: the newly selected bank starts in the steady state of the
+// last output, so the output continues without a step and then follows the new response.
+class ProfileFilter {
+ private:
+  BiquadBank banks[FILTER_PROFILE_COUNT];
+  FilterProfile selected = FILTER_PROFILE_IDLE;
+  float lastOutput = 0;
+  int32_t lastFixed = 0;  // last output of the fixed point form
+
+ public:
+  // configure the response of a profile, see BiquadBank; takes effect with begin()
+  BiquadBank &get_bank(FilterProfile profile);
+
+  // compute all profiles for the sample rate fs (Hz) and clear the state
+  // returns false if the sample rate is too low for one of them
+  bool begin(float fs);
+
+  // compute all profiles for another sample rate, the state is kept
+  bool set_sample_rate(float fs);
+
+  float get_sample_rate() const;
+
+  // switch to another profile without a step in the output
+  void select(FilterProfile profile);
+
+  FilterProfile get_selected() const;
+
+  float filter(float x);
+
+  // filter n samples in place with the selected profile
+  void filter_block(float *x, int n);
+
+  // the same in fixed point, see Biquad::signalBits
+  void filter_block(int32_t *x, int n);
+
+  // group delay of the selected profile at f = 0 in samples
+  float get_group_delay() const;
+};
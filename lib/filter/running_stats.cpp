@@ -0,0 +1,57 @@
+#include "running_stats.h"
+
+#include <math.h>
+
+void RunningStats::reset() {
+  count = 0;
+  mean = 0;
+  m2 = 0;
+  min = 0;
+  max = 0;
+}
+
+void RunningStats::push(float x) {
+  if (count == 0) {
+    min = max = x;
+  } else if (x < min) {
+    min = x;
+  } else if (x > max) {
+    max = x;
+  }
+  count++;
+  double delta = x - mean;
+  mean += delta / count;
+  m2 += delta * (x - mean);
+}
+
+void RunningStats::push_block(const float *x, int n) {
+  for (int i = 0; i < n; i++) {
+    push(x[i]);
+  }
+}
+
+uint32_t RunningStats::get_count() const {
+  return count;
+}
+
+float RunningStats::get_mean() const {
+  return mean;
+}
+
+float RunningStats::get_variance() const {
+  if (count == 0)
+    return 0;
+  return m2 / count;
+}
+
+float RunningStats::get_stddev() const {
+  return sqrtf(get_variance());
+}
+
+float RunningStats::get_min() const {
+  return min;
+}
+
+float RunningStats::get_max() const {
+  return max;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+// Statistics of all values since the last reset, O(1) per value and constant memory:
+// Welford update for the mean and the variance, running minimum and maximum.
+class RunningStats {
+ private:
+  uint32_t count = 0;
+  double mean = 0;
+  double m2 = 0;  // sum of the squared deviations from the mean
+  float min = 0;
+  float max = 0;
+
+ public:
+  // drop all values
+  void reset();
+
+  void push(float x);
+
+  // push n values in order
+  void push_block(const float *x, int n);
+
+  uint32_t get_count() const;
+
+  float get_mean() const;
+
+  // variance of the values (population variance)
+  float get_variance() const;
+
+  float get_stddev() const;
+
+  float get_min() const;
+
+  float get_max() const;
+};
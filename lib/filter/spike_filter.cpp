@@ -0,0 +1,107 @@
+#include "spike_filter.h"
+
+#include <math.h>
+
+// compare-exchange: a <= b afterwards
+static inline void sort2(float &a, float &b) {
+  if (a > b) {
+    float t = a;
+    a = b;
+    b = t;
+  }
+}
+#define SORT(i, j) sort2(v[i], v[j])
+
+float SpikeFilter::median(float *v, uint8_t n) {
+  // median selection networks after N. Devillard, "Fast median search"
+  switch (n) {
+    case 3:
+      SORT(0, 1); SORT(1, 2); SORT(0, 1);
+      return v[1];
+    case 5:
+      SORT(0, 1); SORT(3, 4); SORT(0, 3);
+      SORT(1, 4); SORT(1, 2); SORT(2, 3);
+      SORT(1, 2);
+      return v[2];
+    case 7:
+      SORT(0, 5); SORT(0, 3); SORT(1, 6);
+      SORT(2, 4); SORT(0, 1); SORT(3, 5);
+      SORT(2, 6); SORT(2, 3); SORT(3, 6);
+      SORT(4, 5); SORT(1, 4); SORT(1, 3);
+      SORT(3, 4);
+      return v[3];
+    case 9:
+      SORT(1, 2); SORT(4, 5); SORT(7, 8);
+      SORT(0, 1); SORT(3, 4); SORT(6, 7);
+      SORT(1, 2); SORT(4, 5); SORT(7, 8);
+      SORT(0, 3); SORT(5, 8); SORT(4, 7);
+      SORT(3, 6); SORT(1, 4); SORT(2, 5);
+      SORT(4, 7); SORT(4, 2); SORT(6, 4);
+      SORT(4, 2);
+      return v[4];
+  }
+  return v[0];
+}
+
+bool SpikeFilter::begin(uint8_t size, float k, float minDev) {
+  threshold = k;
+  minDeviation = minDev;
+  spikes = 0;
+  bool ok = size == 0 || size == 3 || size == 5 || size == 7 || size == 9;
+  window = ok ? size : 0;
+  reset();
+  return ok;
+}
+
+void SpikeFilter::reset() {
+  count = 0;
+  pos = 0;
+}
+
+float SpikeFilter::filter(float x) {
+  if (window == 0)
+    return x;
+
+  history[pos] = x;
+  pos = pos + 1 < window ? pos + 1 : 0;
+  if (count < window) {
+    count++;
+    return x;
+  }
+
+  float v[maxWindow];
+  for (uint8_t i = 0; i < window; i++) {
+    v[i] = history[i];
+  }
+  float m = median(v, window);
+
+  // median absolute deviation, 1.4826 * MAD estimates the standard deviation
+  for (uint8_t i = 0; i < window; i++) {
+    v[i] = fabsf(history[i] - m);
+  }
+  float limit = threshold * 1.4826f * median(v, window);
+  if (limit < minDeviation)
+    limit = minDeviation;
+
+  if (fabsf(x - m) > limit) {
+    spikes++;
+    return m;
+  }
+  return x;
+}
+
+void SpikeFilter::filter_block(float *x, int n) {
+  if (window == 0)
+    return;
+  for (int i = 0; i < n; i++) {
+    x[i] = filter(x[i]);
+  }
+}
+
+bool SpikeFilter::is_enabled() const {
+  return window > 0;
+}
+
+uint32_t SpikeFilter::get_spike_count() const {
+  return spikes;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+// Causal Hampel filter against single corrupted readings (e.g. an all-ones word).
+// Each new value is compared with the median of the last `window` values including
+// itself; if it is further away than threshold * MAD (scaled to a standard deviation),
+// the median is passed on instead. Regular values pass unchanged and without delay.
+// A real step is held back for (window - 1) / 2 values, as with any median.
+// The medians use sorting networks, so the time per value is bounded.
+class SpikeFilter {
+ private:
+  static const uint8_t maxWindow = 9;
+  float history[maxWindow];
+  uint8_t window = 0;  // 0: disabled
+  uint8_t count = 0;
+  uint8_t pos = 0;
+  float threshold = 3;
+  float minDeviation = 0;
+  uint32_t spikes = 0;
+
+  // median of the first n values, the values are reordered
+  static float median(float *v, uint8_t n);
+
+ public:
+  // window: 3, 5, 7 or 9 values, 0 disables the filter
+  // threshold: allowed deviation from the median in standard deviations (MAD based)
+  // minDeviation: deviation that is always allowed, for readings with very little noise
+  // returns false for an unsupported window, the filter is disabled then
+  bool begin(uint8_t window, float threshold = 3, float minDeviation = 0);
+
+  // drop the history
+  void reset();
+
+  float filter(float x);
+
+  // filter n values in place
+  void filter_block(float *x, int n);
+
+  bool is_enabled() const;
+
+  // number of replaced values since begin()
+  uint32_t get_spike_count() const;
+};
@@ -0,0 +1,124 @@
+#include "window_stats.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+WindowStats::~WindowStats() {
+  free(values);
+  free(minQueue);
+  free(maxQueue);
+}
+
+bool WindowStats::begin(uint16_t size) {
+  free(values);
+  free(minQueue);
+  free(maxQueue);
+  values = (float *)malloc(size * sizeof(float));
+  minQueue = (uint16_t *)malloc(size * sizeof(uint16_t));
+  maxQueue = (uint16_t *)malloc(size * sizeof(uint16_t));
+  window = size;
+  if (size == 0 || values == NULL || minQueue == NULL || maxQueue == NULL) {
+    window = 0;
+  }
+  reset();
+  return window > 0;
+}
+
+void WindowStats::reset() {
+  pos = 0;
+  count = 0;
+  minHead = minSize = 0;
+  maxHead = maxSize = 0;
+  sum = 0;
+  m2 = 0;
+}
+
+void WindowStats::push(float x) {
+  if (window == 0)
+    return;
+
+  if (count < window) {
+    // Welford: add a value
+    double mean = count > 0 ? sum / count : x;
+    count++;
+    sum += x;
+    m2 += (x - mean) * (x - sum / count);
+  } else {
+    // Welford: the oldest value at pos is replaced
+    float old = values[pos];
+    double mean = sum / count;
+    sum += x - old;
+    m2 += (x - old) * (x - sum / count + old - mean);
+    if (m2 < 0)
+      m2 = 0;
+
+    // if the oldest value is still in a queue, it is at the front
+    if (minSize > 0 && minQueue[minHead] == pos) {
+      minHead = minHead + 1 < window ? minHead + 1 : 0;
+      minSize--;
+    }
+    if (maxSize > 0 && maxQueue[maxHead] == pos) {
+      maxHead = maxHead + 1 < window ? maxHead + 1 : 0;
+      maxSize--;
+    }
+  }
+  values[pos] = x;
+
+  // drop the values that can never be the minimum (maximum) again
+  while (minSize > 0 && values[minQueue[(minHead + minSize - 1) % window]] >= x) {
+    minSize--;
+  }
+  minQueue[(minHead + minSize++) % window] = pos;
+  while (maxSize > 0 && values[maxQueue[(maxHead + maxSize - 1) % window]] <= x) {
+    maxSize--;
+  }
+  maxQueue[(maxHead + maxSize++) % window] = pos;
+
+  pos = pos + 1 < window ? pos + 1 : 0;
+}
+
+void WindowStats::push_block(const float *x, int n) {
+  for (int i = 0; i < n; i++) {
+    push(x[i]);
+  }
+}
+
+uint16_t WindowStats::get_count() const {
+  return count;
+}
+
+uint16_t WindowStats::get_window() const {
+  return window;
+}
+
+bool WindowStats::is_full() const {
+  return window > 0 && count == window;
+}
+
+float WindowStats::get_mean() const {
+  if (count == 0)
+    return 0;
+  return sum / count;
+}
+
+float WindowStats::get_variance() const {
+  if (count == 0)
+    return 0;
+  return m2 / count;
+}
+
+float WindowStats::get_stddev() const {
+  return sqrtf(get_variance());
+}
+
+float WindowStats::get_min() const {
+  if (minSize == 0)
+    return 0;
+  return values[minQueue[minHead]];
+}
+
+float WindowStats::get_max() const {
+  if (maxSize == 0)
+    return 0;
+  return values[maxQueue[maxHead]];
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Statistics over the last `window` values, O(1) per value and per query:
+// running sum for the mean, sliding Welford update for the variance and
+// monotonic deques for the minimum and maximum.
+// Before the window is full, everything covers the values pushed so far.
+class WindowStats {
+ private:
+  float *values = NULL;       // ring of the values in the window
+  uint16_t *minQueue = NULL;  // ring positions with ascending values
+  uint16_t *maxQueue = NULL;  // ring positions with descending values
+  uint16_t window = 0;
+  uint16_t pos = 0;    // ring position of the next value
+  uint16_t count = 0;  // values in the window
+  uint16_t minHead = 0, minSize = 0;
+  uint16_t maxHead = 0, maxSize = 0;
+  double sum = 0;
+  double m2 = 0;  // sum of the squared deviations from the mean
+
+ public:
+  ~WindowStats();
+
+  // allocate a window of the given number of values and clear it
+  // returns false if the memory is not available
+  bool begin(uint16_t window);
+
+  // drop all values
+  void reset();
+
+  void push(float x);
+
+  // push n values in order
+  void push_block(const float *x, int n);
+
+  // values in the window, up to get_window()
+  uint16_t get_count() const;
+
+  uint16_t get_window() const;
+
+  bool is_full() const;
+
+  float get_mean() const;
+
+  // variance of the values in the window (population variance)
+  float get_variance() const;
+
+  float get_stddev() const;
+
+  float get_min() const;
+
+  float get_max() const;
+};
@@ -0,0 +1,160 @@
+#include "zero_phase.h"
+
+#include <math.h>
+
+static const int maxPad = 64;
+
+static void reverse(float *x, int n) {
+  for (int i = 0, j = n - 1; i < j; i++, j--) {
+    float t = x[i];
+    x[i] = x[j];
+    x[j] = t;
+  }
+}
+
+void filtfilt(BiquadBank &bank, float *x, int n) {
+  if (n < 2 || bank.get_section_count() == 0)
+    return;
+
+  // extension of 3 times the filter order, like scipy's filtfilt, but at least long
+  // enough for the start-up transient of a ramp to decay, 8 times the group delay
+  int pad = 3 * (2 * bank.get_section_count() + 1);
+  int settle = (int)ceilf(8 * bank.get_group_delay());
+  if (pad < settle)
+    pad = settle;
+  if (pad > maxPad)
+    pad = maxPad;
+  if (pad > n - 1)
+    pad = n - 1;
+
+  float tail[maxPad];
+  for (int k = 0; k < pad; k++) {
+    tail[k] = 2 * x[n - 1] - x[n - 2 - k];
+  }
+
+  // forward over the head extension, the values and the tail extension
+  bank.reset(2 * x[0] - x[pad]);
+  for (int k = pad; k > 0; k--) {
+    bank.filter(2 * x[0] - x[k]);
+  }
+  bank.filter_block(x, n);
+  bank.filter_block(tail, pad);
+
+  // backward, starting at the end of the tail
+  reverse(tail, pad);
+  reverse(x, n);
+  bank.reset(tail[0]);
+  bank.filter_block(tail, pad);
+  bank.filter_block(x, n);
+  reverse(x, n);
+}
+
+float find_peak(const float *x, int n, float *index) {
+  if (n <= 0) {
+    *index = 0;
+    return 0;
+  }
+  int m = 0;
+  for (int i = 1; i < n; i++) {
+    if (x[i] > x[m])
+      m = i;
+  }
+  *index = m;
+  if (m == 0 || m == n - 1)
+    return x[m];
+
+  // vertex of the parabola through x[m - 1], x[m], x[m + 1]
+  float curvature = x[m - 1] - 2 * x[m] + x[m + 1];
+  if (curvature >= 0)
+    return x[m];
+  float delta = 0.5f * (x[m - 1] - x[m + 1]) / curvature;
+  *index = m + delta;
+  return x[m] - 0.25f * (x[m - 1] - x[m + 1]) * delta;
+}
+
+// Last index before a drop after the maximum of the filtered values y: the first value
+// after the largest one within width of it that falls below half way between the
+// maximum and the lowest value within 2 * width after it. The drop has to stand out of
+// the noise around the filtered values, or the record has no drop and n - 1 is returned.
+static int find_drop(const float *x, const float *y, int n, int width) {
+  float index;
+  float peak = find_peak(y, n, &index);
+  int top = (int)(index + 0.5f);
+
+  double noise = 0;
+  for (int i = 0; i <= top; i++) {
+    noise += (double)(x[i] - y[i]) * (x[i] - y[i]);
+  }
+  noise = sqrt(noise / (top + 1));
+
+  int last = top + 2 * width < n ? top + 2 * width : n - 1;
+  float low = x[top];
+  for (int i = top; i <= last; i++) {
+    if (x[i] < low)
+      low = x[i];
+  }
+  if (peak - low < 10 * noise)
+    return n - 1;
+
+  // on a short ramp the values width before the filtered maximum are still low
+  int start = top - width > 2 ? top - width : 2;
+  int end = top + width < n ? top + width : n - 1;
+  for (int i = start + 1; i <= end; i++) {
+    if (x[i] > x[start])
+      start = i;
+  }
+  float threshold = (peak + low) / 2;
+  for (int i = start; i < n; i++) {
+    if (x[i] < threshold)
+      return i - 1;
+  }
+  return n - 1;
+}
+
+float find_break_peak(BiquadBank &bank, const float *x, int n, int width, float *y, float *index) {
+  if (width < 1)
+    width = 1;
+  if (n < 3) {
+    for (int i = 0; i < n; i++) {
+      y[i] = x[i];
+    }
+    return find_peak(y, n, index);
+  }
+
+  // first pass over everything: where the values drop
+  for (int i = 0; i < n; i++) {
+    y[i] = x[i];
+  }
+  filtfilt(bank, y, n);
+  int end = find_drop(x, y, n, width);
+
+  // least squares line through the last values before the drop, t centered at mean
+  int first = end + 1 - width > 0 ? end + 1 - width : 0;
+  int count = end + 1 - first;
+  double center = (first + end) / 2.0;
+  double sum = 0, sumT = 0, sumTT = 0;
+  for (int i = first; i <= end; i++) {
+    sum += x[i];
+  }
+  double mean = sum / count;
+  for (int i = first; i <= end; i++) {
+    sumT += (i - center) * (x[i] - mean);
+    sumTT += (i - center) * (i - center);
+  }
+  double slope = sumTT > 0 ? sumT / sumTT : 0;
+
+  // second pass up to the drop, continued along the line
+  for (int i = 0; i <= end; i++) {
+    y[i] = x[i];
+  }
+  for (int k = 1; k <= 2 * width; k++) {
+    y[end + k] = (float)(mean + slope * (end + k - center));
+  }
+  filtfilt(bank, y, end + 1 + 2 * width);
+  float peak = find_peak(y, end + 1, index);
+  if (end < n - 1 && *index >= end) {
+    peak += 0.5f * (y[end] - y[end - 1]);
+    *index = end + 0.5f;
+  }
+  return peak;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "biquad.h"
+
+// Offline helpers for a complete record, e.g. the samples of a test after it ended.
+
+// Forward-backward filtering of n values in place: no phase shift and no lag, the
+// magnitude response of the bank squared. Both ends are extended by the point reflection
+// of the first and last values, so a ramp stays a ramp up to the edges.
+void filtfilt(BiquadBank &bank, float *x, int n);
+
+// Maximum of n values; an interior maximum is refined by a parabola through its
+// neighbours. index gets the position of the maximum in samples, with a fraction.
+float find_peak(const float *x, int n, float *index);
+
+// Peak of a record that ends with a sudden drop (a break), without lag: the record is
+// cut before the drop, extended past it by the least squares line through its last
+// width values and filtered forward and backward, so the filter does not end on the
+// single noisy value before the drop. An interior maximum is refined by a parabola; a
+// maximum at the cut is taken half a sample later, where the drop happened on average.
+// Without a drop the whole record is used. width is about the impulse response of the
+// bank in samples, y needs room for n + 2 * width values.
+float find_break_peak(BiquadBank &bank, const float *x, int n, int width, float *y, float *index);
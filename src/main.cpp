@@ -4,6 +4,7 @@
 // #define LV_CONF_INCLUDE_SIMPLE
 
 // #define RTT_Calculation
+// #define SAMPLE_STATS // show sequence, missed conversions and sampling jitter
 
 #include <LovyanGFX.hpp> // main library
 #include <lvgl.h>
@@ -26,34 +27,99 @@ static lv_obj_t *scr_measurement_end;
 
 // Variables for loadcell
 #include <Preferences.h>
-#include <hx711_zp.h>
-
+#include <acquisition.h>
+#include <algorithm>
+#include <fft.h>
+#include <noise_test.h>
+#include <tare_job.h>
+#include <zero_phase.h>
+
+// #define LOADCELL_ADS1220 // ADS1220 on VSPI instead of the HX711
+
+#ifdef LOADCELL_ADS1220
+#include <ads1220.h>
+#define ADS1220_cs 5
+#define ADS1220_drdy 4
+#define ADS1220_sps 1000
+#define LOADCELL_NOTCH_HZ 50 // mains pickup
+#define LOADCELL_FILTER_CUTOFF_TEST 20 // Hz
+#else
+#include <hx711_fast.h>
 #define HX711_dout 4
 #define HX711_sck 2
+#define HX711_sps HX711_RATE_10SPS // has to match the RATE pin of the module
+#define LOADCELL_NOTCH_HZ 0 // off, a notch needs more than twice its frequency as sample rate
+#define LOADCELL_FILTER_CUTOFF_TEST 4 // Hz, below half the sample rate
+#endif
+// filter of the readings, FILTER_BESSEL has less overshoot at the peak force
+#define LOADCELL_FILTER FILTER_BUTTERWORTH
+#define LOADCELL_FILTER_ORDER 2
+#define LOADCELL_FILTER_CUTOFF_IDLE 2 // Hz, strong smoothing while idle and calibrating
+#define LOADCELL_AVG_WINDOW_MS 2000 // calibration averages the readings of that time
+// spike rejection before the filter: window (0 = off), threshold in standard deviations
+// and the deviation in raw counts that always passes
+#define LOADCELL_SPIKE_WINDOW 5
+#define LOADCELL_SPIKE_THRESHOLD 5
+#define LOADCELL_SPIKE_MIN_COUNTS 500
 #define MSG_NEW_FORCE_MEASURED 1
 #define MSG_TIME_IN_TEST 2
 
 /*** Loadcell ***/
-HX711 loadcell;
+#ifdef LOADCELL_ADS1220
+ADS1220 loadcell; // owned by the acquisition task after setup()
+#else
+HX711Fast<HX711_dout, HX711_sck> loadcell; // owned by the acquisition task after setup()
+#endif
+Acquisition acquisition;  // reads the loadcell and detects the break on the other core
+ForceSample currentForce; // last sample published by the acquisition task
 float cal_value = 1;
 Preferences preferences; // https://randomnerdtutorials.com/esp32-save-data-permanently-preferences/
 #define PREF_SCALE "scale"
 #define PREF_ZERO "zero"
+#define PREF_TABLE "caltable" // points of the multi-point calibration
+static lv_obj_t *calTable_label;
+CalibrationCommand calibrationSaving = CALIBRATION_NONE; // change on its way to the acquisition task
+// the zero point waits for the readings to settle
+#define ZERO_WINDOW_MS 1000 // readings of that time have to be steady
+#define ZERO_MAX_STDDEV_N 0.5 // N, standard deviation of the steady readings
+#define ZERO_TIMEOUT_MS 10000 // still moving after that time: no zero point
+TareJob zeroJob;
+static lv_obj_t *zero_label;
+// the zero point follows a slow drift while the machine is idle and unloaded
+#define ZERO_TRACK_WINDOW_MS 2000 // readings of that time have to be steady
+#define ZERO_TRACK_MAX_STDDEV_N 0.5 // N
+#define ZERO_TRACK_BAND_N 2 // N, a larger reading is a load and not tracked
+#define ZERO_TRACK_MAX_CORRECTION_N 20 // N from the calibrated zero point
+#define ZERO_TRACK_RATE_N 0.05 // N/s
 
 /*** Measurement Data ***/
 float mes_set_minForce = 1000;
 float mes_set_maxForce = 2500;
 float mes_set_maxtime = 60;
-float mes_maxForce = 0;
-uint32_t mes_timeAtStart = 0;
+float mes_maxForce = 0;         // peak with the lag of the filter compensated
+float mes_maxForceFiltered = 0; // peak of the filtered force
+bool mes_analyzed = false;      // the recorded test was analyzed, see analyzeTest()
+float mes_peakForce = 0;        // peak of the zero-phase filtered test
+float mes_timeToPeak = 0;       // s from the start of the test
+int64_t mes_timeAtStart = 0; // timestamp of the first sample of the test in us
 float mes_timeSinceStart = 0;
 #define METER_REDBAR_SIZE_MIN 0.8
 // break detection
 #define FORCE_DROP_FOR_BREAK 0.8
 #define MIN_FORCE_FOR_BREAK_DETECTION 100
-bool hasMinForceReached = false;
-#define BREAK_DETECTION_MIN_POINTS 5
-byte breakDetectionCount = 0;
+#define BREAK_DETECTION_MIN_TIME_MS 400 // same as the former 5 readings at 10 SPS
+#define BREAK_DETECTION_RATE 0 // N/s, a faster drop is a break at once, 0 = off
+// Kalman estimate of the force and the loading rate
+#define KALMAN_ACCEL_NOISE 500 // N/s^2 per sqrt(Hz), how fast the loading rate may change
+#define KALMAN_MEASUREMENT_NOISE 2 // N, noise of a single unfiltered reading
+// samples kept around the break, sent to Serial as CSV after the test
+#define BREAK_CAPTURE_PRE_MS 2000 // has to cover BREAK_DETECTION_MIN_TIME_MS
+#define BREAK_CAPTURE_POST_MS 500
+#define BREAK_CAPTURE_LINES_PER_LOOP 20 // keeps the UI responsive while sending
+// the unfiltered force of the test is refiltered without lag after it (PSRAM at high rates)
+#define TEST_RECORD_MAX_S 120
+size_t breakCaptureLine = 0; // next line of the frozen capture to send
+bool breakCaptureSent = false;
 
 /*** Additional Fonts***/
 LV_FONT_DECLARE(UbuntuMono_16);
@@ -61,6 +127,22 @@ LV_FONT_DECLARE(UbuntuMono_36);
 LV_FONT_DECLARE(UbuntuMono_72);
 LV_FONT_DECLARE(UbuntuMono_200);
 
+/*** Noise spectrum for filter tuning ***/
+#define SPECTRUM_SIZE 1024 // raw readings per spectrum, a power of two
+#define SPECTRUM_POINTS 64 // points of the chart
+FFT spectrumFFT;
+float *spectrumRe = NULL; // raw readings, then the spectrum
+float *spectrumIm = NULL;
+bool spectrumPending = false; // recording in the acquisition task
+static lv_obj_t *spectrum_chart;
+static lv_chart_series_t *spectrum_series;
+static lv_obj_t *spectrum_label;
+
+/*** Noise floor self-test ***/
+#define NOISE_TEST_S 10 // s of raw readings
+NoiseTest noiseTest;
+static lv_obj_t *noise_label;
+
 /*** round-time measurement ***/
 #ifdef RTT_Calculation
 #define RTT_TIMES_AVG 10
@@ -85,6 +167,9 @@ enum motor_states
 };
 uint8_t motor_state;
 uint8_t last_motor_state = MOTOR_NONE;
+// the sensor fault that stopped the motor outputs, set by sensorFault() until the next
+// motor state; the health itself may already be back to OK when loop() looks
+std::atomic<LoadCellHealth> motorFault(LOADCELL_HEALTH_OK);
 #define MOTOR_1 33
 #define MOTOR_2 32
 #define STARTPOS_SWITCH 12
@@ -115,6 +200,12 @@ void create_screen_calibration();
 void create_screen_measurement();
 void create_screen_measurement_live();
 void create_screen_measurement_end(); // will be build on purpose with values
+void stopMotorOutputs();
+void sensorFault(LoadCellHealth health);
+void updateZeroJob();
+void updateCalibration();
+void saveCalibrationTable();
+void updateNoiseTest();
 
 void setup(void)
 {
@@ -148,7 +239,17 @@ void setup(void)
 
   /*** Initial
   // loadcell.set_scale(preferences.getFloat("sfactor", 2.0F));ize loadcell***/
-  loadcell.begin(HX711_dout, HX711_sck);
+#ifdef LOADCELL_ADS1220
+  loadcell.begin(ADS1220_cs, ADS1220_drdy, 128, ADS1220_sps);
+#else
+  loadcell.begin();
+  loadcell.set_rate(HX711_sps);
+#endif
+  loadcell.set_filter(FILTER_PROFILE_IDLE, LOADCELL_FILTER, LOADCELL_FILTER_ORDER, LOADCELL_FILTER_CUTOFF_IDLE, LOADCELL_NOTCH_HZ);
+  loadcell.set_filter(FILTER_PROFILE_TEST, LOADCELL_FILTER, LOADCELL_FILTER_ORDER, LOADCELL_FILTER_CUTOFF_TEST, LOADCELL_NOTCH_HZ);
+  loadcell.set_kalman_noise(KALMAN_ACCEL_NOISE, KALMAN_MEASUREMENT_NOISE);
+  loadcell.set_spike_filter(LOADCELL_SPIKE_WINDOW, LOADCELL_SPIKE_THRESHOLD, LOADCELL_SPIKE_MIN_COUNTS);
+  loadcell.set_average_window((uint32_t)LOADCELL_AVG_WINDOW_MS * loadcell.get_rate() / 1000);
   // loadcell.set_zeropoint_offset(preferences.getLong("zeropoint", 1));
   loadcell.set_scale(2.0F);
   loadcell.set_zeropoint_offset(1);
@@ -170,6 +271,25 @@ void setup(void)
   preferences.begin("srm-app", false);
   loadcell.set_scale(preferences.getFloat(PREF_SCALE, 1.0F));
   loadcell.set_zeropoint_offset(preferences.getFloat(PREF_ZERO, 0));
+  if (preferences.isKey(PREF_TABLE))
+  {
+    CalibrationTable::Point calPoints[CalibrationTable::maxPoints];
+    size_t calBytes = preferences.getBytes(PREF_TABLE, calPoints, sizeof(calPoints));
+    loadcell.set_calibration_table(calPoints, calBytes / sizeof(CalibrationTable::Point));
+  }
+
+  /*** Acquisition ***/
+  acquisition.set_break_detection(MIN_FORCE_FOR_BREAK_DETECTION, FORCE_DROP_FOR_BREAK, BREAK_DETECTION_MIN_TIME_MS);
+  acquisition.set_break_rate(BREAK_DETECTION_RATE);
+  acquisition.on_break(stopMotorOutputs);
+  acquisition.on_fault(sensorFault);
+  acquisition.set_break_capture((uint32_t)BREAK_CAPTURE_PRE_MS * loadcell.get_rate() / 1000,
+                                (uint32_t)BREAK_CAPTURE_POST_MS * loadcell.get_rate() / 1000);
+  acquisition.set_test_record((uint32_t)TEST_RECORD_MAX_S * loadcell.get_rate());
+  acquisition.set_zero_tracking((uint32_t)ZERO_TRACK_WINDOW_MS * loadcell.get_rate() / 1000,
+                                ZERO_TRACK_MAX_STDDEV_N, ZERO_TRACK_BAND_N, ZERO_TRACK_MAX_CORRECTION_N,
+                                ZERO_TRACK_RATE_N);
+  acquisition.begin(&loadcell);
 
   /*** Screens***/
   create_screen_start();
@@ -180,8 +300,40 @@ void setup(void)
   motor_state = MOTOR_COAST;
 }
 
+// the motor may only pull with a working loadcell
+bool needsLoadcell(uint8_t state)
+{
+  return state == MOTOR_TESTING || state == MOTOR_PULL;
+}
+
+// the loadcell failed while the motor needs it
+bool hasSensorFault()
+{
+  return needsLoadcell(motor_state) &&
+         (motorFault != LOADCELL_HEALTH_OK || acquisition.get_health() != LOADCELL_HEALTH_OK);
+}
+
+// the acquisition task stopped the motor outputs, see stopMotorOutputs()
+bool isStoppedByAcquisition()
+{
+  return (motor_state == MOTOR_TESTING && acquisition.is_break_detected()) || hasSensorFault();
+}
+
+void stopRampup()
+{
+  isRampingUp1 = false;
+  isRampingUp2 = false;
+  rampup_time_start1 = 0;
+  rampup_time_start2 = 0;
+}
+
 void rampup_pwm()
 {
+  // a break or a sensor fault stopped the motor in between, the ramp must not start
+  // it again before controlMotor() sees the new state
+  if (isStoppedByAcquisition())
+    stopRampup();
+
   if (isRampingUp1)
   {
     if (rampup_time_start1 == 0)
@@ -233,13 +385,32 @@ void rampup_pwm()
   }
 }
 
+// called by the acquisition task, must not touch LVGL
+void stopMotorOutputs()
+{
+  ledcWrite(pwm_channel_motor1, 0);
+  ledcWrite(pwm_channel_motor2, 0);
+}
+
+// called by the acquisition task, must not touch LVGL
+void sensorFault(LoadCellHealth health)
+{
+  if (needsLoadcell(motor_state))
+  {
+    stopMotorOutputs();
+    motorFault = health;
+  }
+}
+
 void controlMotor()
 {
   if (last_motor_state != motor_state)
   {
     last_motor_state = motor_state;
-    isRampingUp1 = false;
-    isRampingUp2 = false;
+    motorFault = LOADCELL_HEALTH_OK;
+    stopRampup();
+    acquisition.set_testing(motor_state == MOTOR_TESTING);
+    acquisition.enable_zero_tracking(motor_state == MOTOR_COAST || motor_state == MOTOR_STARTPOSITION);
 
     switch (motor_state)
     {
@@ -319,15 +490,140 @@ byte nextIndex(byte index, byte limit)
 void resetTest()
 {
   mes_maxForce = 0;
-  hasMinForceReached = false;
+  mes_maxForceFiltered = 0;
+  acquisition.reset_test();
   mes_timeSinceStart = 0;
   mes_timeAtStart = 0;
   motor_state = MOTOR_COAST;
 }
 
+// send some lines of the frozen break capture per call
+void sendBreakCapture()
+{
+  const BreakCapture &capture = acquisition.get_break_capture();
+  if (!capture.is_frozen())
+  {
+    // rearmed for the next test
+    breakCaptureLine = 0;
+    breakCaptureSent = false;
+    return;
+  }
+  if (breakCaptureSent)
+    return;
+
+  int64_t triggerTime = capture.get(capture.get_trigger_index()).timestamp;
+  if (breakCaptureLine == 0)
+    Serial.println("seq,t_ms,raw,reading,force");
+  for (int i = 0; i < BREAK_CAPTURE_LINES_PER_LOOP && breakCaptureLine < capture.get_count(); i++, breakCaptureLine++)
+  {
+    const ForceSample &sample = capture.get(breakCaptureLine);
+    Serial.printf("%u,%.3f,%ld,%.1f,%.2f\n", sample.seq, (sample.timestamp - triggerTime) / 1000.0,
+                  sample.raw, sample.reading, sample.force);
+  }
+  if (breakCaptureLine >= capture.get_count())
+    breakCaptureSent = true;
+}
+
+// Lowest frequency where the spectrum rises clearly above its noise floor (motor or
+// mains pickup); a cutoff at half of it keeps it out. Without such a peak the noise
+// is white and a quarter of the sample rate is suggested.
+float suggestCutoff(const float *asd, uint16_t bins, float binWidth, float *scratch)
+{
+  // noise floor: median without DC and its leakage into the next bins
+  const uint16_t first = 3;
+  uint16_t count = bins - first;
+  std::copy(asd + first, asd + bins, scratch);
+  std::nth_element(scratch, scratch + count / 2, scratch + count);
+  float noiseFloor = scratch[count / 2];
+
+  for (uint16_t k = first; k < bins; k++)
+  {
+    if (asd[k] > 4 * noiseFloor) // 12 dB above the floor
+      return k * binWidth / 2;
+  }
+  return (bins - 1) * binWidth / 2;
+}
+
+// noise spectrum of the recorded raw readings, shown on the settings screen
+void showSpectrum()
+{
+  const uint16_t n = SPECTRUM_SIZE;
+  float fs = loadcell.get_sample_rate();
+
+  // the offset and a drift would leak into the lowest bins
+  FFT::detrend(spectrumRe, n);
+  for (uint16_t i = 0; i < n; i++)
+    spectrumIm[i] = 0;
+
+  uint32_t cycles = ESP.getCycleCount();
+  FFT::hann(spectrumRe, n);
+  spectrumFFT.transform(spectrumRe, spectrumIm);
+  cycles = ESP.getCycleCount() - cycles;
+  FFT::density(spectrumRe, spectrumIm, n, fs, FFT::hann_power(n));
+  float cutoff = suggestCutoff(spectrumRe, n / 2 + 1, fs / n, spectrumIm);
+
+  // chart in dB (raw counts/sqrt(Hz)), each point shows the maximum of its bins
+  const uint16_t binsPerPoint = n / 2 / SPECTRUM_POINTS;
+  lv_coord_t low = 1000, high = -1000;
+  for (uint16_t p = 0; p < SPECTRUM_POINTS; p++)
+  {
+    float peak = 0;
+    for (uint16_t k = 1 + p * binsPerPoint; k <= (p + 1) * binsPerPoint; k++)
+      peak = std::max(peak, spectrumRe[k]);
+    lv_coord_t db = (lv_coord_t)lroundf(20 * log10f(peak + 1e-3f));
+    low = std::min(low, db);
+    high = std::max(high, db);
+    lv_chart_set_value_by_id(spectrum_chart, spectrum_series, p, db);
+  }
+  lv_chart_set_range(spectrum_chart, LV_CHART_AXIS_PRIMARY_Y, low - 5, high + 5);
+  lv_chart_refresh(spectrum_chart);
+
+  lv_label_set_text_fmt(spectrum_label, "0 - %.1f Hz: %d - %d dB\nGrenzfrequenz: %.1f Hz\nFFT: %lu us",
+                        fs / 2, low, high, cutoff, (unsigned long)(cycles / getCpuFrequencyMhz()));
+}
+
+// Refilter the recorded test forward and backward with the test filter: no lag, so
+// the peak and its time come out right, see find_break_peak().
+void analyzeTest()
+{
+  mes_analyzed = false;
+  const TestRecorder &record = acquisition.get_test_record();
+  int n = record.get_count();
+  if (n < 3)
+    return;
+
+  float fs = loadcell.get_sample_rate();
+  BiquadBank bank;
+  bank.set_lowpass(LOADCELL_FILTER, LOADCELL_FILTER_ORDER, LOADCELL_FILTER_CUTOFF_TEST);
+  bank.set_notch(LOADCELL_NOTCH_HZ);
+  bank.begin(fs);
+  // smearing of the filter in samples
+  int width = (int)(fs / LOADCELL_FILTER_CUTOFF_TEST) + 1;
+
+  float *x = (float *)ps_malloc(n * sizeof(float));
+  if (x == NULL)
+    x = (float *)malloc(n * sizeof(float));
+  // the zero-phase filtered values with the extension past the drop
+  float *y = (float *)ps_malloc((n + 2 * width) * sizeof(float));
+  if (y == NULL)
+    y = (float *)malloc((n + 2 * width) * sizeof(float));
+  if (x != NULL && y != NULL)
+  {
+    for (int i = 0; i < n; i++)
+      x[i] = record.get(i);
+    float index;
+    mes_peakForce = find_break_peak(bank, x, n, width, y, &index);
+    mes_timeToPeak = index / fs;
+    mes_analyzed = true;
+  }
+  free(x);
+  free(y);
+}
+
 void endTest()
 {
   motor_state = MOTOR_ENDOFTEST;
+  analyzeTest();
   create_screen_measurement_end();
   lv_scr_load(scr_measurement_end);
 }
@@ -337,49 +633,58 @@ void loop()
 
   // lvgl & message handling
   lv_timer_handler(); /* let the GUI do its work */
-  loadcell.read();    // get the current data from the loadcell
-  if (mes_maxForce < loadcell.get_cal_force())
-    mes_maxForce = loadcell.get_cal_force();
-  lv_msg_send(MSG_NEW_FORCE_MEASURED, NULL);
 
-  /** Detect break **/
+  // fetch the samples of the acquisition task, never waits for the loadcell
+  bool newReading = false;
+  while (acquisition.pop(currentForce))
+  {
+    newReading = true;
+    zeroJob.push(currentForce.reading, currentForce.timestamp);
+    noiseTest.push(currentForce.raw);
+  }
+  if (newReading)
+  {
+    updateZeroJob();
+    updateNoiseTest();
+    mes_maxForce = acquisition.get_compensated_max_force();
+    mes_maxForceFiltered = acquisition.get_max_force();
+    lv_msg_send(MSG_NEW_FORCE_MEASURED, NULL);
+  }
+  updateCalibration();
+
+  /** Loadcell failed: the acquisition task already stopped the motor **/
+  if (hasSensorFault())
+  {
+    motor_state = MOTOR_BREAK;
+    lv_scr_load(scr_measurement);
+  }
+
+  /** Break detected by the acquisition task **/
+  if (motor_state == MOTOR_TESTING && acquisition.is_break_detected())
+  {
+    // end of test
+    endTest();
+  }
+
   if (motor_state == MOTOR_TESTING)
   {
-    // start of testing
-    if (mes_timeAtStart == 0)
+    // the test time runs on the sample timestamps, not on the loop
+    if (newReading)
     {
-      mes_timeAtStart = millis();
+      // start of testing
+      if (mes_timeAtStart == 0)
+      {
+        mes_timeAtStart = currentForce.timestamp;
+      }
+
+      mes_timeSinceStart = (currentForce.timestamp - mes_timeAtStart) / 1.0e6;
+      lv_msg_send(MSG_TIME_IN_TEST, NULL);
     }
-
-    mes_timeSinceStart = (millis() - mes_timeAtStart) / 1000.0;
-    lv_msg_send(MSG_TIME_IN_TEST, NULL);
     if (mes_timeSinceStart > mes_set_maxtime)
     {
       // time overdue --> abort
       endTest();
     }
-
-    // overcome minimum force to rule out noise
-    if (loadcell.get_cal_force() > MIN_FORCE_FOR_BREAK_DETECTION)
-    {
-      hasMinForceReached = true;
-    }
-    // low force triggers break detection
-    if (hasMinForceReached && loadcell.get_cal_force() < mes_maxForce * (1 - FORCE_DROP_FOR_BREAK))
-    {
-      breakDetectionCount++;
-    }
-    else
-    { // break detection is reset, when a higher force is measured
-      breakDetectionCount = 0;
-    }
-
-    // end the test, if the break detection is saturated
-    if (breakDetectionCount >= BREAK_DETECTION_MIN_POINTS)
-    {
-      // end of test
-      endTest();
-    }
   }
   else
   {
@@ -395,8 +700,17 @@ void loop()
     lcd.printf("RTT: %04d", roundTripTime_sum / RTT_TIMES_AVG);
 #endif
 
+#ifdef SAMPLE_STATS
+    // missed conversions, lost samples (capture/UI queue) and intervals in ms
+    const SampleStats &stats = loadcell.get_sample_stats();
+    lcd.setCursor(10, screenHeight - 20);
+    lcd.printf("Seq: %7u Miss: %4u Drop: %4u/%4u Int: %6.2f/%6.2f/%6.2f p99: %6.2f",
+               currentForce.seq, stats.get_missed(), acquisition.get_capture_dropped(), acquisition.get_dropped(),
+               stats.get_min() / 1000, stats.get_mean() / 1000, stats.get_max() / 1000, stats.get_percentile(99) / 1000);
+#endif
+
     lcd.setCursor(10, screenHeight - 10);
-    lcd.printf("Force: %7.2f", loadcell.get_cal_force());
+    lcd.printf("Force: %7.2f", currentForce.force);
 
     lcd.setCursor(350, screenHeight - 10);
     lcd.printf("Heap: %07d", ESP.getFreeHeap());
@@ -404,10 +718,21 @@ void loop()
 
   controlMotor();
   rampup_pwm();
+  sendBreakCapture();
+
+  if (spectrumPending && acquisition.is_record_done())
+  {
+    spectrumPending = false;
+    showSpectrum();
+  }
 
   // print motor status
   lcd.setCursor(120, screenHeight - 10);
   lcd.printf("Motor: %s", motor_state_str().c_str());
+
+  // print loadcell status
+  lcd.setCursor(240, screenHeight - 10);
+  lcd.printf("Sensor: %-7s", LoadCellHealthMonitor::name(acquisition.get_health()));
 }
 
 /*** Display callback to flush the buffer to screen ***/
@@ -571,19 +896,20 @@ void create_screen_start(void)
 void label_forceRaw_change_event(lv_event_t *e)
 {
   lv_obj_t *label = lv_event_get_target(e);
-  lv_label_set_text_fmt(label, "%06.0f", loadcell.get_last_reading());
+  lv_label_set_text_fmt(label, "%06.0f", currentForce.reading);
 }
 
 void label_forceRawZero_change_event(lv_event_t *e)
 {
   lv_obj_t *label = lv_event_get_target(e);
-  lv_label_set_text_fmt(label, "%06.0f", loadcell.get_last_reading_zeroed());
+  lv_label_set_text_fmt(label, "%06.0f",
+                        currentForce.reading - loadcell.get_zeropoint_offset() - acquisition.get_zero_correction());
 }
 
 void label_forceCal_change_event(lv_event_t *e)
 {
   lv_obj_t *label = lv_event_get_target(e);
-  lv_label_set_text_fmt(label, "%06.0f N", loadcell.get_cal_force());
+  lv_label_set_text_fmt(label, "%06.0f N", currentForce.force);
 }
 
 void calibrate_zero_event(lv_event_t *e)
@@ -591,8 +917,39 @@ void calibrate_zero_event(lv_event_t *e)
   lv_event_code_t code = lv_event_get_code(e);
   if (code != LV_EVENT_CLICKED)
     return;
-  loadcell.set_zeropoint_offset_current();
-  preferences.putFloat(PREF_ZERO, loadcell.get_zeropoint_offset());
+  // the readings are in counts, the limit in N with the active calibration
+  uint16_t window = (uint32_t)ZERO_WINDOW_MS * loadcell.get_rate() / 1000;
+  if (zeroJob.begin(window, ZERO_MAX_STDDEV_N * fabsf(loadcell.get_sensitivity()), ZERO_TIMEOUT_MS))
+    lv_label_set_text(zero_label, "Nullpunkt: warten ...");
+  else
+    lv_label_set_text(zero_label, "Kein Speicher");
+}
+
+// progress and result of the zero point job, once per loop with new readings
+void updateZeroJob()
+{
+  switch (zeroJob.get_state())
+  {
+  case TARE_RUNNING:
+    lv_label_set_text_fmt(zero_label, "Nullpunkt: %3.0f%%", zeroJob.get_progress() * 100);
+    break;
+  case TARE_DONE:
+    // applied by the acquisition task, saved by updateCalibration(); retried while
+    // another change is pending
+    if (acquisition.calibrate(CALIBRATION_ZERO, zeroJob.get_result()))
+    {
+      calibrationSaving = CALIBRATION_ZERO;
+      lv_label_set_text(zero_label, "Nullpunkt gesetzt");
+      zeroJob.cancel();
+    }
+    break;
+  case TARE_MOVING:
+    lv_label_set_text_fmt(zero_label, "Nicht ruhig (%.1f N)", zeroJob.get_stddev() / fabsf(loadcell.get_sensitivity()));
+    zeroJob.cancel();
+    break;
+  default:
+    break;
+  }
 }
 
 void calibrate_force_event(lv_event_t *e)
@@ -600,8 +957,73 @@ void calibrate_force_event(lv_event_t *e)
   lv_event_code_t code = lv_event_get_code(e);
   if (code != LV_EVENT_CLICKED)
     return;
-  loadcell.set_scale_current(cal_value);
-  preferences.putFloat(PREF_SCALE, loadcell.get_scale());
+  if (acquisition.calibrate(CALIBRATION_SCALE_CURRENT, cal_value))
+    calibrationSaving = CALIBRATION_SCALE_CURRENT;
+}
+
+// save the calibration once the acquisition task applied the change
+void updateCalibration()
+{
+  if (calibrationSaving == CALIBRATION_NONE || acquisition.is_calibration_pending())
+    return;
+  CalibrationCommand command = calibrationSaving;
+  calibrationSaving = CALIBRATION_NONE;
+  bool result = acquisition.get_calibration_result();
+  switch (command)
+  {
+  case CALIBRATION_ADD_POINT:
+  case CALIBRATION_CLEAR_TABLE:
+    if (result)
+      saveCalibrationTable();
+    else if (loadcell.get_calibration_table().get_count() == CalibrationTable::maxPoints)
+      lv_label_set_text(calTable_label, "Tabelle voll");
+    else
+      lv_label_set_text(calTable_label, "Keine Last");
+    break;
+  default:
+    if (result)
+    {
+      preferences.putFloat(PREF_SCALE, loadcell.get_scale());
+      preferences.putFloat(PREF_ZERO, loadcell.get_zeropoint_offset());
+    }
+    break;
+  }
+}
+
+// the table is stable while no calibration change is pending, see updateCalibration()
+void saveCalibrationTable()
+{
+  const CalibrationTable &table = loadcell.get_calibration_table();
+  lv_label_set_text_fmt(calTable_label, "Punkt %d/%d", table.get_count(), CalibrationTable::maxPoints);
+  if (table.get_count() == 0)
+  {
+    preferences.remove(PREF_TABLE);
+    return;
+  }
+  CalibrationTable::Point calPoints[CalibrationTable::maxPoints];
+  for (uint8_t i = 0; i < table.get_count(); i++)
+    calPoints[i] = table.get(i);
+  preferences.putBytes(PREF_TABLE, calPoints, table.get_count() * sizeof(CalibrationTable::Point));
+}
+
+// one more point of the multi-point calibration at the entered force
+void calibrate_point_event(lv_event_t *e)
+{
+  lv_event_code_t code = lv_event_get_code(e);
+  if (code != LV_EVENT_CLICKED)
+    return;
+  // applied by the acquisition task, saved or rejected in updateCalibration()
+  if (acquisition.calibrate(CALIBRATION_ADD_POINT, cal_value))
+    calibrationSaving = CALIBRATION_ADD_POINT;
+}
+
+void calibrate_clear_table_event(lv_event_t *e)
+{
+  lv_event_code_t code = lv_event_get_code(e);
+  if (code != LV_EVENT_CLICKED)
+    return;
+  if (acquisition.calibrate(CALIBRATION_CLEAR_TABLE))
+    calibrationSaving = CALIBRATION_CLEAR_TABLE;
 }
 
 void calValue_changed_event(lv_event_t *e)
@@ -638,6 +1060,10 @@ void create_screen_calibration()
   lv_label_set_long_mode(label, LV_LABEL_LONG_WRAP);
   lv_obj_align(label, LV_ALIGN_TOP_LEFT, 230, 40);
 
+  zero_label = lv_label_create(scr_calibration);
+  lv_label_set_text(zero_label, "");
+  lv_obj_align(zero_label, LV_ALIGN_TOP_LEFT, 230, 100);
+
   btn = lv_btn_create(scr_calibration);
   lv_obj_add_event_cb(btn, calibrate_force_event, LV_EVENT_ALL, NULL);
   lv_obj_set_size(btn, 100, 60);
@@ -664,6 +1090,24 @@ void create_screen_calibration()
   lv_label_set_text(label, "N");
   lv_obj_align(label, LV_ALIGN_TOP_LEFT, 415, 145);
 
+  // multi-point calibration, replaces the single force once it has a point
+  btn = lv_btn_create(scr_calibration);
+  lv_obj_add_event_cb(btn, calibrate_point_event, LV_EVENT_ALL, NULL);
+  lv_obj_set_size(btn, 120, 35);
+  lv_obj_align(btn, LV_ALIGN_TOP_RIGHT, -150, 195);
+  calTable_label = lv_label_create(btn);
+  lv_label_set_text_fmt(calTable_label, "Punkt %d/%d", loadcell.get_calibration_table().get_count(),
+                        CalibrationTable::maxPoints);
+  lv_obj_center(calTable_label);
+
+  btn = lv_btn_create(scr_calibration);
+  lv_obj_add_event_cb(btn, calibrate_clear_table_event, LV_EVENT_ALL, NULL);
+  lv_obj_set_size(btn, 120, 35);
+  lv_obj_align(btn, LV_ALIGN_TOP_RIGHT, -20, 195);
+  label = lv_label_create(btn);
+  lv_label_set_text(label, "Tabelle leeren");
+  lv_obj_center(label);
+
   // Messwert roh
   label = lv_label_create(scr_calibration);
   lv_label_set_text(label, "Rohwert:");
@@ -957,7 +1401,7 @@ void label_testTime_change_event(lv_event_t *e)
 void label_forceMeasurement_change_event(lv_event_t *e)
 {
   lv_obj_t *label = lv_event_get_target(e);
-  lv_label_set_text_fmt(label, "%4.0fN", loadcell.get_cal_force());
+  lv_label_set_text_fmt(label, "%4.0fN", currentForce.force);
 }
 
 void label_maxForceMeasurement_change_event(lv_event_t *e)
@@ -966,11 +1410,17 @@ void label_maxForceMeasurement_change_event(lv_event_t *e)
   lv_label_set_text_fmt(label, "%4.0fN", mes_maxForce);
 }
 
+void label_rateMeasurement_change_event(lv_event_t *e)
+{
+  lv_obj_t *label = lv_event_get_target(e);
+  lv_label_set_text_fmt(label, "%5.0f N/s", currentForce.rate);
+}
+
 void meter_forceMeasurement_change_event(lv_event_t *e)
 {
   lv_obj_t *meter = lv_event_get_target(e);
   lv_meter_indicator_t *indic = (lv_meter_indicator_t *)lv_event_get_user_data(e);
-  lv_meter_set_indicator_value(meter, indic, loadcell.get_cal_force());
+  lv_meter_set_indicator_value(meter, indic, currentForce.force);
 }
 
 void create_screen_measurement_live()
@@ -1058,6 +1508,13 @@ void create_screen_measurement_live()
   /*Subscribe to Force Change event*/
   lv_msg_subscribe_obj(MSG_NEW_FORCE_MEASURED, meter, NULL);
   lv_obj_add_event_cb(meter, meter_forceMeasurement_change_event, LV_EVENT_MSG_RECEIVED, indic);
+
+  // Label for showing the loading rate, in the gap at the bottom of the meter
+  label = lv_label_create(scr_measurement_live);
+  lv_obj_set_style_text_font(label, &UbuntuMono_16, LV_STATE_DEFAULT);
+  lv_obj_align_to(label, meter, LV_ALIGN_BOTTOM_MID, 0, -10);
+  lv_obj_add_event_cb(label, label_rateMeasurement_change_event, LV_EVENT_MSG_RECEIVED, NULL);
+  lv_msg_subscribe_obj(MSG_NEW_FORCE_MEASURED, label, NULL);
 }
 
 void finish_btn_event(lv_event_t *e)
@@ -1093,6 +1550,16 @@ void create_screen_measurement_end()
   lv_label_set_text_fmt(label, "%.0fN", mes_maxForce);
   lv_obj_align(label, LV_ALIGN_CENTER, 0, -60);
 
+  label = lv_label_create(scr_measurement_end);
+  lv_obj_set_style_text_font(label, &UbuntuMono_16, LV_STATE_DEFAULT);
+  lv_obj_set_style_text_color(label, lv_color_black(), LV_STATE_DEFAULT);
+  if (mes_analyzed)
+    lv_label_set_text_fmt(label, "gefiltert: %.0f N  Analyse: %.0f N nach %.2f s", mes_maxForceFiltered,
+                          mes_peakForce, mes_timeToPeak);
+  else
+    lv_label_set_text_fmt(label, "gefiltert: %.0f N", mes_maxForceFiltered);
+  lv_obj_align(label, LV_ALIGN_CENTER, 0, 80);
+
   label = lv_label_create(scr_measurement_end);
   lv_obj_set_style_text_font(label, &lv_font_montserrat_36, LV_STATE_DEFAULT);
   lv_obj_set_style_text_color(label, lv_color_black(), LV_STATE_DEFAULT);
@@ -1109,6 +1576,64 @@ void create_screen_measurement_end()
   lv_obj_center(label);
 }
 
+void spectrum_start_event(lv_event_t *e)
+{
+  lv_event_code_t code = lv_event_get_code(e);
+  if (code != LV_EVENT_CLICKED || spectrumPending)
+    return;
+
+  if (spectrumRe == NULL)
+  {
+    spectrumRe = (float *)malloc(SPECTRUM_SIZE * sizeof(float));
+    spectrumIm = (float *)malloc(SPECTRUM_SIZE * sizeof(float));
+    spectrumFFT.begin(SPECTRUM_SIZE);
+  }
+  if (spectrumRe == NULL || spectrumIm == NULL || spectrumFFT.get_size() != SPECTRUM_SIZE)
+  {
+    // give back what was allocated, the next start tries again
+    free(spectrumRe);
+    free(spectrumIm);
+    spectrumRe = spectrumIm = NULL;
+    lv_label_set_text(spectrum_label, "Kein Speicher");
+    return;
+  }
+
+  // the motor should be off or running unloaded
+  if (acquisition.record_raw(spectrumRe, SPECTRUM_SIZE))
+  {
+    spectrumPending = true;
+    lv_label_set_text_fmt(spectrum_label, "Aufnahme %.0f s ...", SPECTRUM_SIZE / loadcell.get_sample_rate());
+  }
+}
+
+void noise_start_event(lv_event_t *e)
+{
+  lv_event_code_t code = lv_event_get_code(e);
+  if (code != LV_EVENT_CLICKED || noiseTest.is_running())
+    return;
+  // the motor should be off or running unloaded
+  noiseTest.begin((uint32_t)NOISE_TEST_S * loadcell.get_rate());
+  lv_label_set_text(noise_label, "Rauschtest: 0%");
+}
+
+// progress and result of the noise self-test, once per loop with new readings
+void updateNoiseTest()
+{
+  if (noiseTest.is_running())
+  {
+    lv_label_set_text_fmt(noise_label, "Rauschtest: %3.0f%%", noiseTest.get_progress() * 100);
+  }
+  else if (noiseTest.is_done())
+  {
+    float countsPerN = fabsf(loadcell.get_sensitivity());
+    // the noise-free resolution is the peak-to-peak noise
+    lv_label_set_text_fmt(noise_label, "RMS: %.3f N\nAufloesung (Spitze-Spitze): %.3f N\nENOB: %.1f bit, rauschfrei: %.1f bit",
+                          noiseTest.get_rms() / countsPerN, noiseTest.get_peak_to_peak() / countsPerN,
+                          noiseTest.get_effective_bits(), noiseTest.get_noise_free_bits());
+    noiseTest.cancel();
+  }
+}
+
 void create_screen_settings()
 {
   scr_settings = lv_obj_create(NULL);
@@ -1116,11 +1641,44 @@ void create_screen_settings()
   lv_obj_set_style_bg_color(scr_settings, lv_color_black(), LV_STATE_DEFAULT);
 
   lv_obj_t *label;
+  lv_obj_t *btn;
 
-  label = lv_label_create(scr_settings);
-  lv_label_set_text(label, "ToDo ...");
+  // Noise spectrum of the raw readings
+  spectrum_chart = lv_chart_create(scr_settings);
+  lv_obj_set_size(spectrum_chart, 400, 105);
+  lv_obj_align(spectrum_chart, LV_ALIGN_TOP_MID, 0, 50);
+  lv_chart_set_type(spectrum_chart, LV_CHART_TYPE_LINE);
+  lv_chart_set_point_count(spectrum_chart, SPECTRUM_POINTS);
+  lv_obj_set_style_size(spectrum_chart, 0, LV_PART_INDICATOR);
+  spectrum_series = lv_chart_add_series(spectrum_chart, lv_palette_main(LV_PALETTE_BLUE), LV_CHART_AXIS_PRIMARY_Y);
+
+  btn = lv_btn_create(scr_settings);
+  lv_obj_add_event_cb(btn, spectrum_start_event, LV_EVENT_ALL, NULL);
+  lv_obj_set_size(btn, 150, 50);
+  lv_obj_align(btn, LV_ALIGN_BOTTOM_LEFT, 10, -25);
+  label = lv_label_create(btn);
+  lv_label_set_text(label, "Spektrum");
   lv_obj_center(label);
 
+  spectrum_label = lv_label_create(scr_settings);
+  lv_obj_set_style_text_color(spectrum_label, lv_color_white(), LV_STATE_DEFAULT);
+  lv_obj_align(spectrum_label, LV_ALIGN_BOTTOM_LEFT, 180, -25);
+  lv_label_set_text(spectrum_label, "Rauschen bei Stillstand oder im Leerlauf");
+
+  // Noise floor and resolution of the raw readings
+  btn = lv_btn_create(scr_settings);
+  lv_obj_add_event_cb(btn, noise_start_event, LV_EVENT_ALL, NULL);
+  lv_obj_set_size(btn, 150, 50);
+  lv_obj_align(btn, LV_ALIGN_TOP_LEFT, 10, 165);
+  label = lv_label_create(btn);
+  lv_label_set_text(label, "Rauschtest");
+  lv_obj_center(label);
+
+  noise_label = lv_label_create(scr_settings);
+  lv_obj_set_style_text_color(noise_label, lv_color_white(), LV_STATE_DEFAULT);
+  lv_obj_align(noise_label, LV_ALIGN_TOP_LEFT, 180, 162);
+  lv_label_set_text_fmt(noise_label, "%d s Rohwerte ohne Last", NOISE_TEST_S);
+
   createStandardButtons(scr_settings);
 }
 
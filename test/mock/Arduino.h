@@ -0,0 +1,101 @@
+#pragma once
+
+// The part of the Arduino-ESP32 core the libraries use, on top of the simulated
+// hardware in mock_hw.h.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "mock_hw.h"
+
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define IRAM_ATTR
+#define ARDUINO_RUNNING_CORE 1
+
+#ifndef BIT
+#define BIT(n) (1UL << (n))
+#endif
+
+#define digitalPinToInterrupt(pin) (pin)
+
+inline void pinMode(uint8_t pin, uint8_t mode)
+{
+  mock::hw().mode[pin] = mode;
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t level)
+{
+  mock::write_pin(pin, level);
+}
+
+inline int digitalRead(uint8_t pin)
+{
+  return mock::read_pin(pin);
+}
+
+inline unsigned long micros()
+{
+  return (unsigned long)mock::now();
+}
+
+inline unsigned long millis()
+{
+  return (unsigned long)(mock::now() / 1000);
+}
+
+inline void delayMicroseconds(uint32_t us)
+{
+  mock::advance(us);
+}
+
+inline void delay(uint32_t ms)
+{
+  vTaskDelay(ms);
+}
+
+inline void noInterrupts()
+{
+  mock::set_interrupts(false);
+}
+
+inline void interrupts()
+{
+  mock::set_interrupts(true);
+}
+
+inline void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode)
+{
+  mock::attach_interrupt(pin, handler, arg, mode);
+}
+
+inline void detachInterrupt(uint8_t pin)
+{
+  mock::detach_interrupt(pin);
+}
+
+inline uint32_t getCpuFrequencyMhz()
+{
+  return mock::hw().cpuMhz;
+}
+
+// PSRAM allocation, the host has only one heap
+inline void *ps_malloc(size_t size)
+{
+  return malloc(size);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// Arduino SPIClass that logs every byte with the chip select level and answers from a
+// script, for the drivers on the SPI bus (ADS1220).
+
+#include <deque>
+#include <vector>
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x01
+#define SPI_MODE2 0x02
+#define SPI_MODE3 0x03
+
+class SPISettings
+{
+public:
+  uint32_t clock;
+  uint8_t bitOrder;
+  uint8_t dataMode;
+
+  SPISettings(uint32_t clockHz = 1000000, uint8_t order = MSBFIRST, uint8_t mode = SPI_MODE0)
+      : clock(clockHz), bitOrder(order), dataMode(mode)
+  {
+  }
+};
+
+class SPIClass
+{
+public:
+  struct Transfer
+  {
+    uint8_t out;
+    uint8_t in;
+    bool selected;      // chip select low
+    bool inTransaction; // between beginTransaction() and endTransaction()
+    SPISettings settings;
+  };
+
+  std::vector<Transfer> log;
+  std::deque<uint8_t> replies; // answers of the next transfers, 0 once empty
+  int8_t csPin = -1;           // pin whose level is logged as chip select
+  bool began = false;
+  bool inTransaction = false;
+  int transactions = 0;
+  SPISettings settings;
+
+  SPIClass(uint8_t bus = 0) { (void)bus; }
+
+  void begin() { began = true; }
+
+  void end() { began = false; }
+
+  void beginTransaction(SPISettings s)
+  {
+    settings = s;
+    inTransaction = true;
+    transactions++;
+  }
+
+  void endTransaction() { inTransaction = false; }
+
+  uint8_t transfer(uint8_t out)
+  {
+    uint8_t in = 0;
+    if (!replies.empty())
+    {
+      in = replies.front();
+      replies.pop_front();
+    }
+    bool selected = csPin >= 0 && mock::read_pin(csPin) == LOW;
+    log.push_back({out, in, selected, inTransaction, settings});
+    return in;
+  }
+
+  void clear()
+  {
+    log.clear();
+    replies.clear();
+    transactions = 0;
+  }
+};
+
+inline SPIClass SPI;
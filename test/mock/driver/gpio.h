@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "mock_hw.h"
+
+typedef int gpio_num_t;
+typedef int esp_err_t;
+
+#define ESP_OK 0
+
+inline esp_err_t gpio_intr_enable(gpio_num_t pin)
+{
+  mock::enable_interrupt(pin, true);
+  return ESP_OK;
+}
+
+inline esp_err_t gpio_intr_disable(gpio_num_t pin)
+{
+  mock::enable_interrupt(pin, false);
+  return ESP_OK;
+}
+
+inline esp_err_t gpio_pullup_en(gpio_num_t pin)
+{
+  (void)pin;
+  return ESP_OK;
+}
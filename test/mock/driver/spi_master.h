@@ -0,0 +1,143 @@
+#pragma once
+
+// ESP-IDF SPI master driver that clocks the simulated pins: every bit is a rising and a
+// falling edge on SCLK and MISO is sampled at the falling edge (mode 1, as the HX711
+// shifts its bits out on the rising edge).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "driver/gpio.h"
+#include "esp_rom_gpio.h"
+#include "mock_hw.h"
+#include "soc/spi_periph.h"
+
+typedef int spi_host_device_t;
+
+#define SPI1_HOST 0
+#define SPI2_HOST 1
+#define SPI3_HOST 2
+
+#define SPI_DMA_DISABLED 0
+#define SPI_DEVICE_HALFDUPLEX (1 << 4)
+#define SPI_TRANS_USE_RXDATA (1 << 2)
+#define SPI_TRANS_USE_TXDATA (1 << 3)
+#define ESP_ERR_INVALID_STATE 0x103
+
+struct spi_bus_config_t
+{
+  int mosi_io_num;
+  int miso_io_num;
+  int sclk_io_num;
+  int quadwp_io_num;
+  int quadhd_io_num;
+  int max_transfer_sz;
+  uint32_t flags;
+};
+
+struct spi_device_interface_config_t
+{
+  uint8_t command_bits;
+  uint8_t address_bits;
+  uint8_t dummy_bits;
+  uint8_t mode;
+  int clock_speed_hz;
+  int spics_io_num;
+  uint32_t flags;
+  int queue_size;
+};
+
+struct spi_transaction_t
+{
+  uint32_t flags;
+  size_t length;   // bits to send
+  size_t rxlength; // bits to receive
+  uint8_t tx_data[4];
+  uint8_t rx_data[4];
+};
+
+namespace mock
+{
+
+struct SpiBus
+{
+  bool initialized = false;
+  spi_bus_config_t config = {};
+};
+
+struct SpiDevice
+{
+  spi_host_device_t host;
+  spi_device_interface_config_t config;
+  uint32_t transactions = 0;
+  uint32_t clocks = 0; // SCLK pulses of all transactions
+};
+
+inline SpiBus *spi_buses()
+{
+  static SpiBus buses[3];
+  return buses;
+}
+
+inline void reset_spi()
+{
+  for (int i = 0; i < 3; i++)
+    spi_buses()[i] = SpiBus();
+}
+
+} // namespace mock
+
+typedef mock::SpiDevice *spi_device_handle_t;
+
+inline esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *config, int dma)
+{
+  (void)dma;
+  mock::SpiBus &bus = mock::spi_buses()[host];
+  if (bus.initialized)
+    return ESP_ERR_INVALID_STATE;
+  bus.initialized = true;
+  bus.config = *config;
+  mock::out_signals()[config->sclk_io_num] = spi_periph_signal[host].spiclk_out;
+  return ESP_OK;
+}
+
+inline esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config,
+                                    spi_device_handle_t *handle)
+{
+  if (!mock::spi_buses()[host].initialized)
+    return ESP_ERR_INVALID_STATE;
+  *handle = new mock::SpiDevice{host, *config};
+  return ESP_OK;
+}
+
+inline esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+  delete handle;
+  return ESP_OK;
+}
+
+inline esp_err_t spi_bus_free(spi_host_device_t host)
+{
+  mock::spi_buses()[host] = mock::SpiBus();
+  return ESP_OK;
+}
+
+// receive only, MSB first into rx_data
+inline esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *t)
+{
+  const spi_bus_config_t &bus = mock::spi_buses()[handle->host].config;
+  // the clock only reaches the pin while the SPI peripheral drives it
+  bool connected = mock::out_signals()[bus.sclk_io_num] == spi_periph_signal[handle->host].spiclk_out;
+  memset(t->rx_data, 0, sizeof(t->rx_data));
+  for (size_t i = 0; i < t->rxlength && connected; i++)
+  {
+    mock::write_pin(bus.sclk_io_num, 1);
+    mock::write_pin(bus.sclk_io_num, 0);
+    if (i < 32 && mock::read_pin(bus.miso_io_num))
+      t->rx_data[i / 8] |= 0x80 >> (i % 8);
+    handle->clocks++;
+  }
+  handle->transactions++;
+  return ESP_OK;
+}
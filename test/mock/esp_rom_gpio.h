@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "mock_hw.h"
+
+namespace mock
+{
+
+// output signal routed to each pin by esp_rom_gpio_connect_out_signal()
+inline uint32_t *out_signals()
+{
+  static uint32_t signals[pinCount] = {};
+  return signals;
+}
+
+} // namespace mock
+
+inline void esp_rom_gpio_connect_out_signal(uint32_t pin, uint32_t signal, bool invert, bool invertEnable)
+{
+  (void)invert;
+  (void)invertEnable;
+  mock::out_signals()[pin] = signal;
+}
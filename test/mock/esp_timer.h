@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "mock_hw.h"
+
+// time since boot in us, simulated unless mock::use_real_time()
+inline int64_t esp_timer_get_time()
+{
+  return mock::now();
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+// FreeRTOS tasks on std::thread for the native tests. A task runs until
+// mock::stop_tasks(), which ends it at its next ulTaskNotifyTake() or vTaskDelay().
+// Task notifications are a counting semaphore per task. mock::pause_tasks() holds the
+// tasks in ulTaskNotifyTake() until mock::resume_tasks().
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "mock_hw.h"
+
+namespace mock
+{
+
+struct Task
+{
+  std::mutex lock;
+  std::condition_variable wake;
+  uint32_t notified = 0;
+  bool stop = false;
+  bool paused = false;
+  bool waiting = false; // in ulTaskNotifyTake()
+  std::thread thread;
+};
+
+// thrown into a task to end it
+struct TaskStopped
+{
+};
+
+inline Task *&current_task()
+{
+  static thread_local Task *task = nullptr;
+  return task;
+}
+
+inline std::vector<Task *> &tasks()
+{
+  static std::vector<Task *> list;
+  return list;
+}
+
+inline void check_stop()
+{
+  Task *task = current_task();
+  if (task != nullptr && task->stop)
+    throw TaskStopped();
+}
+
+// end all tasks and wait for them
+inline void stop_tasks()
+{
+  for (Task *task : tasks())
+  {
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->stop = true;
+    task->wake.notify_all();
+  }
+  for (Task *task : tasks())
+  {
+    task->thread.join();
+    delete task;
+  }
+  tasks().clear();
+}
+
+// Wait until all tasks are in ulTaskNotifyTake() and keep them there, even when they are
+// notified or time out; e.g. to queue several samples for one wake-up.
+inline void pause_tasks()
+{
+  for (Task *task : tasks())
+  {
+    std::unique_lock<std::mutex> guard(task->lock);
+    task->paused = true;
+    task->wake.wait(guard, [task]() { return task->waiting || task->stop; });
+  }
+}
+
+inline void resume_tasks()
+{
+  for (Task *task : tasks())
+  {
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->paused = false;
+    task->wake.notify_all();
+  }
+}
+
+} // namespace mock
+
+typedef mock::Task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stack, void *arg,
+                                          UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+  (void)name;
+  (void)stack;
+  (void)priority;
+  (void)core;
+  mock::Task *task = new mock::Task;
+  if (handle != nullptr)
+    *handle = task;
+  mock::tasks().push_back(task);
+  task->thread = std::thread([task, code, arg]() {
+    mock::current_task() = task;
+    try
+    {
+      code(arg);
+    }
+    catch (const mock::TaskStopped &)
+    {
+    }
+  });
+  return pdPASS;
+}
+
+// the main thread of the test is a task too
+inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+  static mock::Task mainTask;
+  if (mock::current_task() == nullptr)
+    mock::current_task() = &mainTask;
+  return mock::current_task();
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+  mock::Task *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> guard(task->lock);
+  task->waiting = true;
+  task->wake.notify_all();
+  auto running = [task]() { return !task->paused || task->stop; };
+  task->wake.wait(guard, running);
+  auto woken = [task]() { return (task->notified > 0 && !task->paused) || task->stop; };
+  if (ticks == portMAX_DELAY)
+    task->wake.wait(guard, woken);
+  else
+    task->wake.wait_for(guard, std::chrono::milliseconds(ticks), woken);
+  // a timeout while paused
+  task->wake.wait(guard, running);
+  task->waiting = false;
+  if (task->stop)
+    throw mock::TaskStopped();
+  uint32_t count = task->notified;
+  if (clear)
+    task->notified = 0;
+  else if (task->notified > 0)
+    task->notified--;
+  return count;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t task)
+{
+  std::lock_guard<std::mutex> guard(task->lock);
+  task->notified++;
+  task->wake.notify_all();
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+  xTaskNotifyGive(task);
+  if (woken != nullptr)
+    *woken = pdFALSE;
+}
+
+// advances the simulated clock by the ticks (ms), with the real clock it sleeps
+inline void vTaskDelay(TickType_t ticks)
+{
+  mock::check_stop();
+  mock::advance((int64_t)ticks * 1000);
+  std::this_thread::yield();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+// HX711 on two simulated pins: a conversion pulls DOUT low, every rising PD_SCK edge
+// shifts the next data bit out (MSB first), the 25th pulse pulls DOUT high again and
+// the pulses after the 24th select the gain of the next conversion (1: A/128,
+// 2: B/32, 3: A/64). PD_SCK held high for more than 60 us powers the chip down.
+// Several chips may share one PD_SCK pin.
+
+#include <stdint.h>
+
+#include "mock_hw.h"
+
+class HX711Sim : public mock::Device
+{
+private:
+  uint8_t dout;
+  uint8_t sck;
+  uint32_t data = 0;      // 24-bit two's complement word of the conversion
+  bool ready = false;     // a conversion waits for the readout
+  uint8_t pulses = 0;     // PD_SCK pulses since the conversion
+  uint8_t gainPulses = 1; // selection of the last readout
+  int64_t highSince = 0;  // time of the last rising PD_SCK edge
+  bool sckHigh = false;
+
+public:
+  uint32_t readouts = 0;    // conversions read out completely
+  uint32_t overwritten = 0; // conversions replaced before they were read out
+  uint32_t risingEdges = 0;
+
+  HX711Sim(uint8_t doutPin, uint8_t sckPin) : dout(doutPin), sck(sckPin)
+  {
+    mock::attach(this);
+    mock::drive_pin(dout, 1);
+  }
+
+  ~HX711Sim() { mock::detach(this); }
+
+  // a new conversion result; it is clipped to the 24-bit range like the chip output
+  // returns false while the chip is powered down
+  bool convert(long value)
+  {
+    if (is_powered_down())
+      return false;
+    if (value > 0x7FFFFF)
+      value = 0x7FFFFF;
+    if (value < -0x800000)
+      value = -0x800000;
+    if (ready)
+    {
+      overwritten++;
+      // the chip raises DOUT briefly before the next result, which is a new edge
+      mock::drive_pin(dout, 1);
+    }
+    if (pulses >= 24)
+      gainPulses = pulses - 24;
+    data = (uint32_t)value & 0xFFFFFF;
+    pulses = 0;
+    ready = true;
+    mock::drive_pin(dout, 0);
+    return true;
+  }
+
+  bool is_ready() const { return ready; }
+
+  // pulses after the 24 data bits of the last readout that ended before the latest
+  // conversion, or of the current one if it is complete
+  uint8_t get_gain_pulses() const { return pulses >= 24 ? pulses - 24 : gainPulses; }
+
+  bool is_powered_down() const { return sckHigh && mock::now() - highSince > 60; }
+
+  void on_write(uint8_t pin, uint8_t level) override
+  {
+    if (pin != sck || (level != 0) == sckHigh)
+      return;
+    sckHigh = level != 0;
+    if (!sckHigh)
+      return;
+
+    highSince = mock::now();
+    risingEdges++;
+    if (pulses < 255)
+      pulses++;
+    if (!ready)
+      return;
+    if (pulses <= 24)
+    {
+      mock::drive_pin(dout, (data >> (24 - pulses)) & 1);
+    }
+    else if (pulses == 25)
+    {
+      ready = false;
+      readouts++;
+      mock::drive_pin(dout, 1);
+    }
+  }
+};
@@ -0,0 +1,254 @@
+#pragma once
+
+// Simulated ESP32 hardware for the native tests: GPIO levels, edge interrupts with the
+// latching of the GPIO status register, the esp_timer clock and the CPU cycle counter.
+// Header-only, PlatformIO builds every library under test as its own archive.
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// interrupt modes of attachInterruptArg()
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+namespace mock
+{
+
+const int pinCount = 40;
+
+// A simulated chip: it sees every level the driver writes to an output pin and
+// answers with drive_pin() on its own outputs.
+struct Device
+{
+  virtual ~Device() {}
+  virtual void on_write(uint8_t pin, uint8_t level) = 0;
+};
+
+struct Interrupt
+{
+  void (*handler)(void *) = nullptr;
+  void *arg = nullptr;
+  int mode = 0;
+  bool enabled = false; // gpio_intr_enable()
+  bool latched = false; // edge seen, GPIO status bit set
+};
+
+struct Hardware
+{
+  uint8_t level[pinCount] = {};
+  uint8_t mode[pinCount] = {};
+  Interrupt irq[pinCount];
+  bool masked = false; // between noInterrupts() and interrupts()
+  bool inIsr = false;
+  std::vector<Device *> devices;
+
+  // esp_timer time in us: simulated unless realTime
+  std::atomic<int64_t> time{0};
+  bool realTime = false;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // CPU cycle counter, every read advances it by ccountStep
+  uint32_t ccount = 0;
+  uint32_t ccountStep = 4;
+  uint32_t cpuMhz = 240;
+};
+
+inline Hardware &hw()
+{
+  static Hardware hardware;
+  return hardware;
+}
+
+// Clear all pins, interrupts and devices and restart the simulated clock at 1 s.
+inline void reset()
+{
+  Hardware &h = hw();
+  for (int i = 0; i < pinCount; i++)
+  {
+    h.level[i] = 0;
+    h.mode[i] = 0;
+    h.irq[i] = Interrupt();
+  }
+  h.masked = false;
+  h.inIsr = false;
+  h.devices.clear();
+  h.time = 1000000;
+  h.realTime = false;
+  h.ccount = 0;
+  h.ccountStep = 4;
+  h.cpuMhz = 240;
+}
+
+inline int64_t now()
+{
+  Hardware &h = hw();
+  if (h.realTime)
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - h.start).count();
+  return h.time;
+}
+
+inline void set_time(int64_t us)
+{
+  hw().time = us;
+}
+
+// advance the simulated clock; with the real clock it waits, busy below 1 ms like
+// delayMicroseconds() on the chip
+inline void advance(int64_t us)
+{
+  Hardware &h = hw();
+  if (!h.realTime)
+  {
+    h.time += us;
+    return;
+  }
+  if (us >= 1000)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+    return;
+  }
+  auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+  while (std::chrono::steady_clock::now() < end)
+  {
+  }
+}
+
+inline void use_real_time(bool enable)
+{
+  Hardware &h = hw();
+  h.realTime = enable;
+  h.start = std::chrono::steady_clock::now();
+}
+
+inline uint32_t ccount()
+{
+  Hardware &h = hw();
+  h.ccount += h.ccountStep;
+  return h.ccount;
+}
+
+inline void attach(Device *device)
+{
+  hw().devices.push_back(device);
+}
+
+inline void detach(Device *device)
+{
+  std::vector<Device *> &d = hw().devices;
+  d.erase(std::remove(d.begin(), d.end(), device), d.end());
+}
+
+// run the handler and every edge it latched itself while it was enabled again
+inline void fire(uint8_t pin)
+{
+  Hardware &h = hw();
+  Interrupt &irq = h.irq[pin];
+  while (irq.handler != nullptr && irq.latched && irq.enabled && !h.masked && !h.inIsr)
+  {
+    irq.latched = false;
+    h.inIsr = true;
+    irq.handler(irq.arg);
+    h.inIsr = false;
+  }
+}
+
+inline void fire_pending()
+{
+  for (int i = 0; i < pinCount; i++)
+    fire(i);
+}
+
+// a device sets the level of one of its outputs
+inline void drive_pin(uint8_t pin, uint8_t level)
+{
+  Hardware &h = hw();
+  uint8_t old = h.level[pin];
+  h.level[pin] = level ? 1 : 0;
+  Interrupt &irq = h.irq[pin];
+  if (irq.handler == nullptr || old == h.level[pin])
+    return;
+  bool edge = h.level[pin] ? (irq.mode & RISING) != 0 : (irq.mode & FALLING) != 0;
+  if (!edge)
+    return;
+  irq.latched = true;
+  fire(pin);
+}
+
+// the driver sets the level of an output pin
+inline void write_pin(uint8_t pin, uint8_t level)
+{
+  Hardware &h = hw();
+  h.level[pin] = level ? 1 : 0;
+  std::vector<Device *> devices = h.devices;
+  for (Device *device : devices)
+    device->on_write(pin, h.level[pin]);
+}
+
+inline uint8_t read_pin(uint8_t pin)
+{
+  return hw().level[pin];
+}
+
+// input register of the pins 0..31 (bank 0) or 32..39 (bank 1)
+inline uint32_t read_bank(int bank)
+{
+  uint32_t value = 0;
+  for (int b = 0; b < 32 && bank * 32 + b < pinCount; b++)
+    value |= (uint32_t)hw().level[bank * 32 + b] << b;
+  return value;
+}
+
+inline void write_bank(int bank, uint32_t bits, uint8_t level)
+{
+  for (int b = 0; b < 32 && bank * 32 + b < pinCount; b++)
+  {
+    if (bits & (1UL << b))
+      write_pin(bank * 32 + b, level);
+  }
+}
+
+inline void clear_status(int bank, uint32_t bits)
+{
+  for (int b = 0; b < 32 && bank * 32 + b < pinCount; b++)
+  {
+    if (bits & (1UL << b))
+      hw().irq[bank * 32 + b].latched = false;
+  }
+}
+
+inline void set_interrupts(bool enable)
+{
+  hw().masked = !enable;
+  if (enable)
+    fire_pending();
+}
+
+inline void attach_interrupt(uint8_t pin, void (*handler)(void *), void *arg, int mode)
+{
+  Interrupt &irq = hw().irq[pin];
+  irq.handler = handler;
+  irq.arg = arg;
+  irq.mode = mode;
+  irq.enabled = true;
+  irq.latched = false;
+}
+
+inline void detach_interrupt(uint8_t pin)
+{
+  hw().irq[pin] = Interrupt();
+}
+
+inline void enable_interrupt(uint8_t pin, bool enable)
+{
+  hw().irq[pin].enabled = enable;
+  if (enable)
+    fire(pin);
+}
+
+} // namespace mock
@@ -0,0 +1,70 @@
+#pragma once
+
+// The GPIO registers the drivers access directly. Writing the set/clear registers
+// writes the pins like digitalWrite(), the input registers read the pin levels and
+// writing the status clear registers drops latched edges.
+
+#include <stdint.h>
+
+#include "mock_hw.h"
+
+struct MockGpioSet
+{
+  int bank;
+  MockGpioSet &operator=(uint32_t bits)
+  {
+    mock::write_bank(bank, bits, 1);
+    return *this;
+  }
+};
+
+struct MockGpioClear
+{
+  int bank;
+  MockGpioClear &operator=(uint32_t bits)
+  {
+    mock::write_bank(bank, bits, 0);
+    return *this;
+  }
+};
+
+struct MockGpioIn
+{
+  int bank;
+  operator uint32_t() const { return mock::read_bank(bank); }
+};
+
+struct MockGpioStatusClear
+{
+  int bank;
+  MockGpioStatusClear &operator=(uint32_t bits)
+  {
+    mock::clear_status(bank, bits);
+    return *this;
+  }
+};
+
+// the registers of the upper pins are unions with a val member
+template <typename T>
+struct MockGpioUnion
+{
+  T val;
+};
+
+struct gpio_dev_t
+{
+  MockGpioSet out_w1ts{0};
+  MockGpioClear out_w1tc{0};
+  MockGpioIn in{0};
+  MockGpioStatusClear status_w1tc{0};
+  MockGpioUnion<MockGpioSet> out1_w1ts{{1}};
+  MockGpioUnion<MockGpioClear> out1_w1tc{{1}};
+  MockGpioUnion<MockGpioIn> in1{{1}};
+  MockGpioUnion<MockGpioStatusClear> status1_w1tc{{1}};
+};
+
+inline gpio_dev_t GPIO;
+
+#ifndef BIT
+#define BIT(n) (1UL << (n))
+#endif
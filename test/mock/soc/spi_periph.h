@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+struct spi_signal_conn_t
+{
+  uint32_t spiclk_out;
+};
+
+// clock output signals of SPI1, SPI2 (HSPI) and SPI3 (VSPI)
+inline const spi_signal_conn_t spi_periph_signal[3] = {{0}, {8}, {63}};
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "mock_hw.h"
+
+// every read advances the simulated cycle counter, see mock::Hardware::ccountStep
+inline uint32_t xthal_get_ccount()
+{
+  return mock::ccount();
+}
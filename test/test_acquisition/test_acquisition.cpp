@@ -0,0 +1,276 @@
+// Acquisition task on a host thread: the test thread plays the HX711 and its DOUT
+// interrupt, the task processes the samples and publishes them to the test thread,
+// which takes the role of loop().
+
+#include <unity.h>
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "acquisition.h"
+#include "esp_timer.h"
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+
+#define DOUT_PIN 4
+#define SCK_PIN 2
+#define INTERVAL_US 12500 // 80 SPS
+#define WAIT_MS 2000      // longest wait for the task
+
+static HX711 *loadcell;
+static HX711Sim *chip;
+static Acquisition *acquisition;
+static std::atomic<int> breakCount{0};
+
+static void onBreak()
+{
+  breakCount++;
+}
+
+// poll until the condition holds, false after WAIT_MS
+template <typename F>
+static bool waitFor(F condition)
+{
+  auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(WAIT_MS);
+  while (!condition())
+  {
+    if (std::chrono::steady_clock::now() > end)
+      return false;
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+static void startTask()
+{
+  TEST_ASSERT_TRUE(acquisition->begin(loadcell));
+  // the task attaches the DOUT interrupt itself
+  TEST_ASSERT_TRUE(waitFor([]() { return mock::hw().irq[DOUT_PIN].handler != nullptr; }));
+}
+
+// one conversion through the task to the UI side
+static bool convertAndPop(long value, ForceSample &sample)
+{
+  mock::advance(INTERVAL_US);
+  chip->convert(value);
+  return waitFor([&sample]() { return acquisition->pop(sample); });
+}
+
+void setUp()
+{
+  mock::reset();
+  breakCount = 0;
+  chip = new HX711Sim(DOUT_PIN, SCK_PIN);
+  loadcell = new HX711();
+  loadcell->begin(DOUT_PIN, SCK_PIN);
+  loadcell->set_rate(HX711_RATE_80SPS);
+  acquisition = new Acquisition();
+}
+
+void tearDown()
+{
+  mock::stop_tasks();
+  delete acquisition;
+  delete loadcell;
+  delete chip;
+}
+
+static void test_samples_reach_the_ui_in_order()
+{
+  startTask();
+  for (int i = 0; i < 200; i++)
+  {
+    ForceSample sample;
+    TEST_ASSERT_TRUE(convertAndPop(i * 10, sample));
+    TEST_ASSERT_EQUAL_INT32(i * 10, sample.raw);
+    TEST_ASSERT_EQUAL_UINT32(i, sample.seq);
+  }
+  TEST_ASSERT_EQUAL_UINT32(200, acquisition->get_sample_count());
+  TEST_ASSERT_EQUAL_UINT32(0, acquisition->get_dropped());
+  TEST_ASSERT_EQUAL_UINT32(0, acquisition->get_capture_dropped());
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, acquisition->get_health());
+}
+
+static void test_calibration_is_applied_by_the_task()
+{
+  startTask();
+  ForceSample sample;
+  for (int i = 0; i < 100; i++)
+    TEST_ASSERT_TRUE(convertAndPop(101000, sample));
+
+  TEST_ASSERT_TRUE(acquisition->calibrate(CALIBRATION_ZERO, 1000));
+  TEST_ASSERT_TRUE(waitFor([]() { return !acquisition->is_calibration_pending(); }));
+  TEST_ASSERT_TRUE(acquisition->get_calibration_result());
+  TEST_ASSERT_EQUAL_FLOAT(1000, loadcell->get_zeropoint_offset());
+
+  TEST_ASSERT_TRUE(acquisition->calibrate(CALIBRATION_SCALE_CURRENT, 100));
+  TEST_ASSERT_TRUE(waitFor([]() { return !acquisition->is_calibration_pending(); }));
+  TEST_ASSERT_TRUE(acquisition->get_calibration_result());
+  TEST_ASSERT_FLOAT_WITHIN(1, 1000, loadcell->get_scale());
+
+  // the next samples carry the new calibration
+  TEST_ASSERT_TRUE(convertAndPop(101000, sample));
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 100, sample.force);
+
+  // a scale at a force of 0 is rejected
+  TEST_ASSERT_TRUE(acquisition->calibrate(CALIBRATION_SCALE_CURRENT, 0));
+  TEST_ASSERT_TRUE(waitFor([]() { return !acquisition->is_calibration_pending(); }));
+  TEST_ASSERT_FALSE(acquisition->get_calibration_result());
+}
+
+static void test_break_is_detected_by_the_task()
+{
+  loadcell->set_scale(1000); // counts per N
+  // the simulated readings are free of noise
+  loadcell->set_kalman_noise(20, 0.1f);
+  acquisition->set_break_detection(10, 0.5f, 400);
+  acquisition->on_break(onBreak);
+  startTask();
+  acquisition->set_testing(true);
+
+  ForceSample sample;
+  // 2 s ramp to 100 N, then the rope breaks
+  for (int i = 0; i <= 160; i++)
+    TEST_ASSERT_TRUE(convertAndPop(i * 625, sample));
+  TEST_ASSERT_FALSE(acquisition->is_break_detected());
+  int i = 0;
+  while (!acquisition->is_break_detected() && i++ < 160)
+    TEST_ASSERT_TRUE(convertAndPop(0, sample));
+
+  TEST_ASSERT_TRUE(acquisition->is_break_detected());
+  TEST_ASSERT_EQUAL_INT(1, breakCount.load());
+  // the filtered maximum lags behind the ramp, the compensated one does not
+  TEST_ASSERT_LESS_THAN_FLOAT(99, acquisition->get_max_force());
+  TEST_ASSERT_FLOAT_WITHIN(2, 100, acquisition->get_compensated_max_force());
+  // the drop has to last 400 ms, plus the lag of the filter
+  TEST_ASSERT_GREATER_OR_EQUAL(32, i);
+  TEST_ASSERT_LESS_THAN(64, i);
+}
+
+static void test_testing_switches_the_filter_profile()
+{
+  loadcell->set_scale(1000); // counts per N
+  TEST_ASSERT_TRUE(loadcell->set_filter(FILTER_PROFILE_TEST, FILTER_BESSEL, 4, 10));
+  startTask();
+
+  ForceSample sample;
+  for (int i = 0; i < 200; i++)
+    TEST_ASSERT_TRUE(convertAndPop(50000, sample));
+  TEST_ASSERT_EQUAL_INT(FILTER_PROFILE_IDLE, loadcell->get_filter_profile());
+
+  // the task switches with the next state period, without a step in the force
+  acquisition->set_testing(true);
+  for (int i = 0; i < 20; i++)
+  {
+    TEST_ASSERT_TRUE(convertAndPop(50000, sample));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 50, sample.force);
+  }
+  TEST_ASSERT_EQUAL_INT(FILTER_PROFILE_TEST, loadcell->get_filter_profile());
+
+  acquisition->set_testing(false);
+  for (int i = 0; i < 20; i++)
+  {
+    TEST_ASSERT_TRUE(convertAndPop(50000, sample));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 50, sample.force);
+  }
+  TEST_ASSERT_EQUAL_INT(FILTER_PROFILE_IDLE, loadcell->get_filter_profile());
+}
+
+static void test_zero_tracking_is_frozen_while_testing()
+{
+  loadcell->set_scale(1000); // counts per N
+  // 1 s window, 0.5 N, band of 2 N, up to 20 N at 5 N/s
+  TEST_ASSERT_TRUE(acquisition->set_zero_tracking(80, 0.5f, 2, 20, 5));
+  acquisition->enable_zero_tracking(true);
+  startTask();
+
+  // the zero point drifts by 0.5 N while idle: tracked away
+  ForceSample sample;
+  for (int i = 0; i < 400; i++)
+    TEST_ASSERT_TRUE(convertAndPop(500, sample));
+  TEST_ASSERT_FLOAT_WITHIN(1, 500, acquisition->get_zero_correction());
+  TEST_ASSERT_FLOAT_WITHIN(0.002f, 0, sample.force);
+
+  // while testing a change within the band is a load and stays
+  acquisition->set_testing(true);
+  for (int i = 0; i < 400; i++)
+    TEST_ASSERT_TRUE(convertAndPop(1500, sample));
+  TEST_ASSERT_FLOAT_WITHIN(1, 500, acquisition->get_zero_correction());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 1, sample.force);
+
+  // the same once the motor leaves the idle states
+  acquisition->set_testing(false);
+  acquisition->enable_zero_tracking(false);
+  for (int i = 0; i < 400; i++)
+    TEST_ASSERT_TRUE(convertAndPop(1500, sample));
+  TEST_ASSERT_FLOAT_WITHIN(1, 500, acquisition->get_zero_correction());
+
+  // idle again: it follows
+  acquisition->enable_zero_tracking(true);
+  for (int i = 0; i < 400; i++)
+    TEST_ASSERT_TRUE(convertAndPop(1500, sample));
+  TEST_ASSERT_FLOAT_WITHIN(1, 1500, acquisition->get_zero_correction());
+  TEST_ASSERT_FLOAT_WITHIN(0.002f, 0, sample.force);
+}
+
+static void test_benchmark_latency_and_throughput()
+{
+  mock::use_real_time(true);
+  startTask();
+
+  // latency from the DOUT edge to the UI task, one sample at a time
+  const int n = 2000;
+  int64_t sum = 0;
+  int64_t worst = 0;
+  for (int i = 0; i < n; i++)
+  {
+    ForceSample sample;
+    chip->convert(i);
+    TEST_ASSERT_TRUE(waitFor([&sample]() { return acquisition->pop(sample); }));
+    int64_t latency = esp_timer_get_time() - sample.timestamp;
+    sum += latency;
+    if (latency > worst)
+      worst = latency;
+  }
+  printf("edge to UI latency: mean %.1f us, max %lld us (readout included)\n", (double)sum / n,
+         (long long)worst);
+
+  // throughput with up to 16 samples in flight, within both rings
+  const int total = 20000;
+  int sent = 0;
+  int received = 0;
+  int64_t start = esp_timer_get_time();
+  while (received < total)
+  {
+    if (sent < total && sent - received < 16)
+    {
+      chip->convert(sent & 0xFFFF);
+      sent++;
+    }
+    ForceSample sample;
+    while (acquisition->pop(sample))
+    {
+      TEST_ASSERT_EQUAL_INT32(received & 0xFFFF, sample.raw);
+      received++;
+    }
+  }
+  double seconds = (esp_timer_get_time() - start) / 1.0e6;
+  printf("throughput: %.0f samples/s\n", total / seconds);
+  TEST_ASSERT_EQUAL_UINT32(0, acquisition->get_dropped());
+  TEST_ASSERT_EQUAL_UINT32(0, acquisition->get_capture_dropped());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_samples_reach_the_ui_in_order);
+  RUN_TEST(test_calibration_is_applied_by_the_task);
+  RUN_TEST(test_break_is_detected_by_the_task);
+  RUN_TEST(test_testing_switches_the_filter_profile);
+  RUN_TEST(test_zero_tracking_is_frozen_while_testing);
+  RUN_TEST(test_benchmark_latency_and_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,221 @@
+// ADS1220 on the logging SPI mock: the command and register bytes, the readout in the
+// continuous conversion mode and the LoadCellADC interface shared with the HX711.
+
+#include <unity.h>
+
+#include "ads1220.h"
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+
+#define CS_PIN 5
+#define DRDY_PIN 21
+
+static ADS1220 *adc;
+
+// a new conversion: the next three bytes on MISO, DRDY pulses low
+static void convert(long value)
+{
+  uint32_t word = (uint32_t)value & 0xFFFFFF;
+  SPI.replies.push_back(word >> 16);
+  SPI.replies.push_back(word >> 8);
+  SPI.replies.push_back(word);
+  mock::drive_pin(DRDY_PIN, 1);
+  mock::drive_pin(DRDY_PIN, 0);
+}
+
+// the four configuration registers of the last register write
+static void lastConfig(uint8_t *config)
+{
+  for (size_t i = SPI.log.size(); i-- > 0;)
+  {
+    if (SPI.log[i].out == (0x40 | 3))
+    {
+      TEST_ASSERT_TRUE(i + 4 < SPI.log.size());
+      for (int r = 0; r < 4; r++)
+        config[r] = SPI.log[i + 1 + r].out;
+      return;
+    }
+  }
+  TEST_FAIL_MESSAGE("no register write");
+}
+
+void setUp()
+{
+  mock::reset();
+  SPI.clear();
+  SPI.csPin = CS_PIN;
+  mock::drive_pin(DRDY_PIN, 1);
+  adc = new ADS1220();
+}
+
+void tearDown()
+{
+  adc->end_capture();
+  delete adc;
+}
+
+static void test_begin_configures_the_chip()
+{
+  adc->begin(CS_PIN, DRDY_PIN);
+  TEST_ASSERT_TRUE(SPI.began);
+  TEST_ASSERT_EQUAL_UINT8(0x06, SPI.log.front().out); // RESET
+  TEST_ASSERT_EQUAL_UINT8(0x08, SPI.log.back().out);  // START
+
+  uint8_t config[4];
+  lastConfig(config);
+  TEST_ASSERT_EQUAL_HEX8(0x0E, config[0]); // AIN0/AIN1, gain 128
+  TEST_ASSERT_EQUAL_HEX8(0xC4, config[1]); // 1000 SPS normal mode, continuous
+  TEST_ASSERT_EQUAL_HEX8(0x40, config[2]); // REFP0/REFN0
+  TEST_ASSERT_EQUAL_HEX8(0x00, config[3]);
+  TEST_ASSERT_EQUAL_UINT16(1000, adc->get_rate());
+
+  // every byte with chip select low, in a transaction of mode 1
+  for (const SPIClass::Transfer &t : SPI.log)
+  {
+    TEST_ASSERT_TRUE(t.selected);
+    TEST_ASSERT_TRUE(t.inTransaction);
+    TEST_ASSERT_EQUAL_UINT8(SPI_MODE1, t.settings.dataMode);
+    TEST_ASSERT_EQUAL_UINT8(MSBFIRST, t.settings.bitOrder);
+    TEST_ASSERT_EQUAL_UINT32(ADS1220_SPI_CLOCK_HZ, t.settings.clock);
+  }
+  TEST_ASSERT_EQUAL_UINT8(HIGH, mock::read_pin(CS_PIN));
+}
+
+static void test_rate_selection()
+{
+  adc->begin(CS_PIN, DRDY_PIN);
+  const struct
+  {
+    uint16_t sps;
+    uint16_t rate;
+    uint8_t config1;
+  } rates[] = {
+      {0, 20, 0x04},     {20, 20, 0x04},     {90, 90, 0x44},     {100, 90, 0x44},
+      {1000, 1000, 0xC4}, {1200, 1200, 0xB4}, {2000, 2000, 0xD4}, {5000, 2000, 0xD4},
+  };
+  for (auto &r : rates)
+  {
+    adc->set_rate(r.sps);
+    TEST_ASSERT_EQUAL_UINT16(r.rate, adc->get_rate());
+    uint8_t config[4];
+    lastConfig(config);
+    TEST_ASSERT_EQUAL_HEX8(r.config1, config[1]);
+  }
+}
+
+static void test_gain_rounds_down()
+{
+  adc->begin(CS_PIN, DRDY_PIN, 1);
+  const uint8_t gains[] = {0, 1, 3, 64, 100, 128, 255};
+  const uint8_t config0[] = {0x00, 0x00, 0x02, 0x0C, 0x0C, 0x0E, 0x0E};
+  for (int i = 0; i < 7; i++)
+  {
+    adc->set_gain(gains[i]);
+    uint8_t config[4];
+    lastConfig(config);
+    TEST_ASSERT_EQUAL_HEX8(config0[i], config[0]);
+  }
+}
+
+static void test_readout()
+{
+  adc->begin(CS_PIN, DRDY_PIN);
+  const long values[] = {0, 1, -1, 0x7FFFFF, -0x800000, 0x123456, -0x123456};
+  for (long value : values)
+  {
+    SPI.log.clear();
+    convert(value);
+    TEST_ASSERT_TRUE(adc->try_read(0));
+    TEST_ASSERT_EQUAL_INT32(value, adc->get_raw_reading());
+    // three NOPs shift the result out, no RDATA in continuous mode
+    TEST_ASSERT_EQUAL_UINT32(3, SPI.log.size());
+    for (const SPIClass::Transfer &t : SPI.log)
+    {
+      TEST_ASSERT_EQUAL_HEX8(0xFF, t.out);
+      TEST_ASSERT_TRUE(t.selected);
+    }
+    mock::drive_pin(DRDY_PIN, 1);
+  }
+}
+
+static void test_capture_at_2000_sps()
+{
+  adc->begin(CS_PIN, DRDY_PIN, 128, 2000);
+  adc->begin_capture();
+  LoadCellBlock block;
+  for (int i = 0; i < 100; i++)
+  {
+    mock::advance(500);
+    convert(i * 1000 - 50000);
+    // DRDY only flags the conversion, SPI is not touched in the interrupt
+    TEST_ASSERT_EQUAL_UINT32(3, SPI.replies.size());
+    TEST_ASSERT_EQUAL_UINT32(1, adc->poll_block(block));
+    TEST_ASSERT_EQUAL_INT32(i * 1000 - 50000, block.raw[0]);
+    TEST_ASSERT_TRUE(block.timestamp[0] == mock::now());
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, adc->poll_block(block));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, adc->get_health());
+  TEST_ASSERT_FLOAT_WITHIN(1, 2000, adc->get_sample_rate());
+}
+
+static void test_power_commands()
+{
+  adc->begin(CS_PIN, DRDY_PIN);
+  SPI.log.clear();
+  adc->power_down();
+  adc->power_up();
+  TEST_ASSERT_EQUAL_UINT32(2, SPI.log.size());
+  TEST_ASSERT_EQUAL_HEX8(0x02, SPI.log[0].out); // POWERDOWN
+  TEST_ASSERT_EQUAL_HEX8(0x08, SPI.log[1].out); // START
+}
+
+static HX711Sim *hxChip;
+
+static void convertHx(long value)
+{
+  hxChip->convert(value);
+}
+
+// the calibration and filter behind the interface do not depend on the driver or its
+// rate: 2 s of the same reading settle at the same force
+static float settledForce(LoadCellADC &cell, void (*convertNext)(long))
+{
+  cell.set_zeropoint_offset(1000);
+  cell.set_scale(100);
+  for (int i = 0; i < 2 * cell.get_rate(); i++)
+  {
+    mock::advance(1000000 / cell.get_rate());
+    convertNext(11000);
+    TEST_ASSERT_TRUE(cell.try_read(0));
+  }
+  TEST_ASSERT_EQUAL_INT32(11000, cell.get_raw_reading());
+  return cell.get_cal_force();
+}
+
+static void test_interface_is_rate_agnostic()
+{
+  adc->begin(CS_PIN, DRDY_PIN);
+  float adsForce = settledForce(*adc, convert);
+
+  HX711Sim chip(4, 2);
+  hxChip = &chip;
+  HX711 hx711;
+  hx711.begin(4, 2);
+  float hxForce = settledForce(hx711, convertHx);
+
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100, adsForce);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100, hxForce);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_configures_the_chip);
+  RUN_TEST(test_rate_selection);
+  RUN_TEST(test_gain_rounds_down);
+  RUN_TEST(test_readout);
+  RUN_TEST(test_capture_at_2000_sps);
+  RUN_TEST(test_power_commands);
+  RUN_TEST(test_interface_is_rate_agnostic);
+  return UNITY_END();
+}
@@ -0,0 +1,223 @@
+// BiquadBank responses: gain at f = 0 and at the cutoff, pass band, step overshoot and
+// group delay of the Butterworth and Bessel low passes of order 2, 4 and 6, and the notch.
+// The frequency response is evaluated exactly from the impulse response.
+
+#include <unity.h>
+
+#include <complex>
+#include <vector>
+
+#include "biquad.h"
+
+#define IMPULSE_LENGTH 20000
+
+static std::vector<float> impulse(BiquadBank &bank)
+{
+  std::vector<float> h(IMPULSE_LENGTH);
+  for (int n = 0; n < IMPULSE_LENGTH; n++)
+    h[n] = bank.filter(n == 0 ? 1.0f : 0.0f);
+  return h;
+}
+
+// frequency response at f (Hz) for the sample rate fs
+static std::complex<double> response(const std::vector<float> &h, double f, double fs)
+{
+  std::complex<double> sum = 0;
+  double w = 2 * M_PI * f / fs;
+  for (size_t n = 0; n < h.size(); n++)
+    sum += (double)h[n] * std::polar(1.0, -w * n);
+  return sum;
+}
+
+// group delay at f in samples: Re(sum(n h[n] e^-jwn) / sum(h[n] e^-jwn))
+static double groupDelay(const std::vector<float> &h, double f, double fs)
+{
+  std::complex<double> sum = 0;
+  std::complex<double> weighted = 0;
+  double w = 2 * M_PI * f / fs;
+  for (size_t n = 0; n < h.size(); n++)
+  {
+    std::complex<double> e = (double)h[n] * std::polar(1.0, -w * n);
+    sum += e;
+    weighted += (double)n * e;
+  }
+  return (weighted / sum).real();
+}
+
+// largest value of the step response
+static float stepPeak(BiquadBank &bank)
+{
+  bank.reset();
+  float peak = 0;
+  for (int n = 0; n < IMPULSE_LENGTH; n++)
+  {
+    float y = bank.filter(1);
+    if (y > peak)
+      peak = y;
+  }
+  return peak;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_lowpass_gain()
+{
+  const float fs = 80;
+  const float cutoff = 2;
+  for (FilterResponse type : {FILTER_BUTTERWORTH, FILTER_BESSEL})
+  {
+    for (uint8_t order : {2, 4, 6})
+    {
+      BiquadBank bank;
+      bank.set_lowpass(type, order, cutoff);
+      TEST_ASSERT_TRUE(bank.begin(fs));
+      TEST_ASSERT_EQUAL_INT(order / 2, bank.get_section_count());
+      std::vector<float> h = impulse(bank);
+
+      TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1, std::abs(response(h, 0, fs)));
+      // -3 dB at the cutoff for both responses
+      TEST_ASSERT_FLOAT_WITHIN(0.01f, 1 / sqrtf(2), std::abs(response(h, cutoff, fs)));
+      // falling above the cutoff, steeper with the order
+      float stop = std::abs(response(h, 4 * cutoff, fs));
+      TEST_ASSERT_LESS_THAN_FLOAT(type == FILTER_BUTTERWORTH ? powf(4, -order) * 1.01f : 0.3f, stop);
+
+      if (type == FILTER_BUTTERWORTH)
+      {
+        // maximally flat: 1 / sqrt(1 + r^2n) with the prewarped frequency ratio
+        for (float f : {0.5f, 1.0f, 1.5f, 3.0f})
+        {
+          float r = tanf((float)M_PI * f / fs) / tanf((float)M_PI * cutoff / fs);
+          TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1 / sqrtf(1 + powf(r, 2 * order)), std::abs(response(h, f, fs)));
+        }
+      }
+    }
+  }
+}
+
+static void test_group_delay()
+{
+  const float fs = 80;
+  const float cutoff = 2;
+  for (FilterResponse type : {FILTER_BUTTERWORTH, FILTER_BESSEL})
+  {
+    for (uint8_t order : {2, 4, 6})
+    {
+      BiquadBank bank;
+      bank.set_lowpass(type, order, cutoff);
+      bank.begin(fs);
+      std::vector<float> h = impulse(bank);
+      double delay = groupDelay(h, 0, fs);
+      TEST_ASSERT_FLOAT_WITHIN(0.01f, delay, bank.get_group_delay());
+
+      // Bessel: flat group delay through the pass band, from the 4th order on up to near
+      // the cutoff; Butterworth: a peak of the delay near the cutoff
+      double halfCutoff = groupDelay(h, 0.5 * cutoff, fs);
+      double nearCutoff = groupDelay(h, 0.8 * cutoff, fs);
+      if (type == FILTER_BESSEL)
+      {
+        TEST_ASSERT_FLOAT_WITHIN(0.03f * delay, delay, halfCutoff);
+        if (order >= 4)
+          TEST_ASSERT_FLOAT_WITHIN(0.01f * delay, delay, nearCutoff);
+      }
+      else if (order >= 4)
+      {
+        TEST_ASSERT_GREATER_THAN_FLOAT(1.4f * delay, nearCutoff);
+      }
+    }
+  }
+}
+
+static void test_step_overshoot()
+{
+  // Bessel hardly overshoots, which keeps the peak force honest; 4th order Butterworth
+  // overshoots by about 11 %
+  BiquadBank bessel;
+  bessel.set_lowpass(FILTER_BESSEL, 4, 2);
+  bessel.begin(80);
+  TEST_ASSERT_LESS_THAN_FLOAT(1.01f, stepPeak(bessel));
+
+  BiquadBank butterworth;
+  butterworth.set_lowpass(FILTER_BUTTERWORTH, 4, 2);
+  butterworth.begin(80);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.108f, stepPeak(butterworth));
+}
+
+static void test_notch()
+{
+  const float fs = 1000;
+  BiquadBank bank;
+  bank.set_lowpass(FILTER_BUTTERWORTH, 2, 100);
+  bank.set_notch(50, 30);
+  TEST_ASSERT_TRUE(bank.begin(fs));
+  TEST_ASSERT_EQUAL_INT(2, bank.get_section_count());
+  std::vector<float> h = impulse(bank);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1, std::abs(response(h, 0, fs)));
+  TEST_ASSERT_LESS_THAN_FLOAT(1e-3f, std::abs(response(h, 50, fs)));
+  // the notch is narrow: bandwidth 50 Hz / Q
+  TEST_ASSERT_GREATER_THAN_FLOAT(0.95f, std::abs(response(h, 40, fs)));
+  TEST_ASSERT_GREATER_THAN_FLOAT(0.9f, std::abs(response(h, 60, fs)));
+}
+
+static void test_frequency_above_nyquist()
+{
+  BiquadBank bank;
+  bank.set_lowpass(FILTER_BUTTERWORTH, 2, 50);
+  TEST_ASSERT_FALSE(bank.begin(80));
+  TEST_ASSERT_EQUAL_INT(0, bank.get_section_count());
+  // the signal passes unfiltered
+  TEST_ASSERT_EQUAL_FLOAT(123.5f, bank.filter(123.5f));
+
+  bank.set_lowpass(FILTER_BUTTERWORTH, 2, 2);
+  bank.set_notch(50);
+  TEST_ASSERT_FALSE(bank.begin(80));
+  bank.set_lowpass(FILTER_BUTTERWORTH, 3, 2);
+  bank.set_notch(0);
+  TEST_ASSERT_FALSE(bank.begin(80));
+}
+
+static void test_fixed_point_settles_exactly()
+{
+  // the gain at f = 0 is exactly 1, even for a low cutoff at a high rate
+  for (float fs : {10.0f, 80.0f, 1000.0f, 2000.0f})
+  {
+    for (FilterResponse type : {FILTER_BUTTERWORTH, FILTER_BESSEL})
+    {
+      BiquadBank bank;
+      bank.set_lowpass(type, 6, 1);
+      bank.set_notch(fs > 200 ? 50 : 0);
+      TEST_ASSERT_TRUE(bank.begin(fs));
+      const int32_t x = 123457 * (1 << Biquad::signalBits) + 17;
+      int32_t y = 0;
+      for (int n = 0; n < 40 * fs; n++)
+      {
+        y = x;
+        bank.filter_block(&y, 1);
+      }
+      TEST_ASSERT_EQUAL_INT32(x, y);
+
+      // and it starts there after reset_fixed()
+      bank.reset_fixed(-x);
+      y = -x;
+      bank.filter_block(&y, 1);
+      TEST_ASSERT_EQUAL_INT32(-x, y);
+    }
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_lowpass_gain);
+  RUN_TEST(test_group_delay);
+  RUN_TEST(test_step_overshoot);
+  RUN_TEST(test_notch);
+  RUN_TEST(test_frequency_above_nyquist);
+  RUN_TEST(test_fixed_point_settles_exactly);
+  return UNITY_END();
+}
@@ -0,0 +1,323 @@
+// LoadCellADC::poll_block(): the same conversions processed one at a time and in blocks
+// of any size give bit-identical results in every stage (decode, spike filter, low pass
+// with rate changes, calibration, Kalman estimate, statistics). The same for the
+// Acquisition task on top, with a filter profile switch, zero tracking and a break. And
+// a throughput benchmark of the block processing.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "acquisition.h"
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+
+#define DOUT_PIN 4
+#define SCK_PIN 2
+#define SAMPLES 2000
+
+// one processed sample with everything the stages produce
+struct Result
+{
+  uint32_t seq;
+  long raw;
+  int64_t timestamp;
+  float reading, force, unfiltered, rate, rateVariance;
+  int32_t forceMilli;
+};
+
+// A noisy ramp with a glitch now and then; the interval changes from 80 to 40 SPS in
+// the middle, which recomputes the low pass inside a block.
+static long value(int i)
+{
+  long glitch = i % 211 == 100 ? 0x7FFFFF : 0;
+  return glitch ? glitch : 100000 + 50 * i + (rand() % 201 - 100);
+}
+
+static int64_t timestamp(int i)
+{
+  int64_t t = 1000000 + (int64_t)i * 12500;
+  if (i > SAMPLES / 2)
+    t += (int64_t)(i - SAMPLES / 2) * 12500;
+  return t + rand() % 200;
+}
+
+// Play the conversions to a capturing loadcell, blockSize at a time, and drain it with
+// poll_block() (at most LOADCELL_BLOCK_SIZE per call); the statistics after each batch
+// are appended to stats.
+static std::vector<Result> replay(size_t blockSize, std::vector<float> &stats)
+{
+  mock::reset();
+  srand(13);
+  HX711Sim chip(DOUT_PIN, SCK_PIN);
+  HX711 loadcell;
+  loadcell.begin(DOUT_PIN, SCK_PIN);
+  loadcell.set_rate(HX711_RATE_80SPS);
+  loadcell.set_scale(1000);
+  loadcell.set_zeropoint_offset(20000);
+  loadcell.set_spike_filter(5, 5, 500);
+  loadcell.set_filter(FILTER_PROFILE_IDLE, FILTER_BESSEL, 4, 5);
+  loadcell.begin_capture();
+
+  std::vector<Result> results;
+  int i = 0;
+  while (i < SAMPLES)
+  {
+    for (size_t k = 0; k < blockSize && i < SAMPLES; k++, i++)
+    {
+      long v = value(i);
+      mock::set_time(timestamp(i));
+      chip.convert(v);
+    }
+    LoadCellBlock block;
+    size_t n;
+    while ((n = loadcell.poll_block(block, blockSize)) > 0)
+    {
+      for (size_t k = 0; k < n; k++)
+      {
+        Result r;
+        memset(&r, 0, sizeof(r)); // the padding takes part in the comparison
+        r.seq = block.seq[k];
+        r.raw = block.raw[k];
+        r.timestamp = block.timestamp[k];
+        r.reading = block.reading[k];
+        r.force = block.force[k];
+        r.unfiltered = block.unfiltered[k];
+        r.rate = block.rate[k];
+        r.rateVariance = block.rateVariance[k];
+        r.forceMilli = block.forceMilli[k];
+        results.push_back(r);
+      }
+    }
+    stats.push_back(loadcell.get_lastreadings_avg());
+    stats.push_back(loadcell.get_lastreadings_stddev());
+    stats.push_back(loadcell.get_sample_rate());
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, loadcell.get_capture_dropped());
+  loadcell.end_capture();
+  return results;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_blocks_are_bit_identical()
+{
+  std::vector<float> reference;
+  std::vector<Result> single = replay(1, reference);
+  TEST_ASSERT_EQUAL_UINT32(SAMPLES, single.size());
+  // the glitches are replaced, the ramp arrives
+  TEST_ASSERT_LESS_THAN_FLOAT(100 + 50 * SAMPLES / 1000.0f, single.back().force);
+  TEST_ASSERT_GREATER_THAN_FLOAT(50 * SAMPLES / 1000.0f, single.back().force);
+
+  for (size_t blockSize : {2, 3, 7, 16, 24})
+  {
+    std::vector<float> stats;
+    std::vector<Result> blocks = replay(blockSize, stats);
+    TEST_ASSERT_EQUAL_UINT32(SAMPLES, blocks.size());
+    TEST_ASSERT_EQUAL_MEMORY(single.data(), blocks.data(), SAMPLES * sizeof(Result));
+    // the getters after a block are those of its last sample
+    for (size_t b = 0; b < stats.size() / 3; b++)
+    {
+      size_t last = (b + 1) * blockSize - 1;
+      if (last >= SAMPLES)
+        last = SAMPLES - 1;
+      TEST_ASSERT_EQUAL_MEMORY(&reference[3 * last], &stats[3 * b], 3 * sizeof(float));
+    }
+  }
+}
+
+// poll until the condition holds, false after 2 s
+template <typename F>
+static bool waitFor(F condition)
+{
+  auto end = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (!condition())
+  {
+    if (std::chrono::steady_clock::now() > end)
+      return false;
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+// everything the acquisition task publishes
+struct Published
+{
+  std::vector<Result> samples;
+  std::vector<float> capture; // force and sequence of the samples around the break
+  size_t triggerIndex;
+  std::vector<float> record; // unfiltered force of the test
+  float maxForce, compensatedMaxForce, zeroCorrection;
+};
+
+// An idle machine whose zero point drifts, then a test: a ramp to 100 N and the break,
+// then idle again. The conversions reach the task blockSize at a time; set_testing() and
+// enable_zero_tracking() change between two of them, as controlMotor() does.
+static Published replayAcquisition(uint8_t statePeriod, size_t blockSize)
+{
+  const int testStart = 601, breakAt = 1000, testEnd = 1150, samples = 1300;
+  mock::reset();
+  srand(14);
+  HX711Sim chip(DOUT_PIN, SCK_PIN);
+  HX711 loadcell;
+  loadcell.begin(DOUT_PIN, SCK_PIN);
+  loadcell.set_rate(HX711_RATE_80SPS);
+  loadcell.set_scale(1000); // counts per N
+  loadcell.set_kalman_noise(20, 0.1f);
+  TEST_ASSERT_TRUE(loadcell.set_filter(FILTER_PROFILE_TEST, FILTER_BESSEL, 4, 10));
+  Acquisition acquisition;
+  acquisition.set_state_period(statePeriod);
+  acquisition.set_break_detection(10, 0.5f, 400);
+  TEST_ASSERT_TRUE(acquisition.set_break_capture(40, 40));
+  TEST_ASSERT_TRUE(acquisition.set_test_record(samples));
+  // 1 s window, 0.5 N, band of 2 N, up to 20 N at 5 N/s
+  TEST_ASSERT_TRUE(acquisition.set_zero_tracking(80, 0.5f, 2, 20, 5));
+  acquisition.enable_zero_tracking(true);
+  TEST_ASSERT_TRUE(acquisition.begin(&loadcell));
+  TEST_ASSERT_TRUE(waitFor([]() { return mock::hw().irq[DOUT_PIN].handler != nullptr; }));
+
+  Published published;
+  int i = 0;
+  while (i < samples)
+  {
+    if (i == testStart || i == testEnd)
+    {
+      acquisition.set_testing(i == testStart);
+      acquisition.enable_zero_tracking(i == testEnd);
+    }
+    int next = i + (int)blockSize;
+    for (int event : {testStart, testEnd, samples})
+    {
+      if (i < event && next > event)
+        next = event;
+    }
+    mock::pause_tasks();
+    for (; i < next; i++)
+    {
+      // a drift of 0.3 N over the idle time, noise of 0.1 N
+      long value = 300 * i / testStart + rand() % 201 - 100;
+      if (i >= testStart && i < breakAt)
+        value += 100000L * (i - testStart) / (breakAt - testStart);
+      mock::advance(12500);
+      chip.convert(value);
+    }
+    mock::resume_tasks();
+    TEST_ASSERT_TRUE(waitFor([&]() { return acquisition.get_sample_count() == (uint32_t)i; }));
+    ForceSample sample;
+    while (acquisition.pop(sample))
+    {
+      // the fields a ForceSample carries
+      Result r;
+      memset(&r, 0, sizeof(r));
+      r.seq = sample.seq;
+      r.raw = sample.raw;
+      r.timestamp = sample.timestamp;
+      r.reading = sample.reading;
+      r.force = sample.force;
+      r.rate = sample.rate;
+      published.samples.push_back(r);
+    }
+  }
+  mock::stop_tasks();
+  TEST_ASSERT_EQUAL_UINT32(0, acquisition.get_dropped());
+  TEST_ASSERT_EQUAL_UINT32(0, acquisition.get_capture_dropped());
+
+  TEST_ASSERT_TRUE(acquisition.is_break_detected());
+  const BreakCapture &capture = acquisition.get_break_capture();
+  TEST_ASSERT_TRUE(capture.is_frozen());
+  for (size_t k = 0; k < capture.get_count(); k++)
+  {
+    published.capture.push_back(capture.get(k).force);
+    published.capture.push_back(capture.get(k).seq);
+  }
+  published.triggerIndex = capture.get_trigger_index();
+  const TestRecorder &record = acquisition.get_test_record();
+  for (size_t k = 0; k < record.get_count(); k++)
+    published.record.push_back(record.get(k));
+  published.maxForce = acquisition.get_max_force();
+  published.compensatedMaxForce = acquisition.get_compensated_max_force();
+  published.zeroCorrection = acquisition.get_zero_correction();
+  return published;
+}
+
+static void test_acquisition_blocks_are_bit_identical()
+{
+  for (uint8_t statePeriod : {5, 16})
+  {
+    Published single = replayAcquisition(statePeriod, 1);
+    TEST_ASSERT_EQUAL_UINT32(1300, single.samples.size());
+    // the drift was tracked before the test, and the ramp arrived
+    TEST_ASSERT_GREATER_THAN_FLOAT(100, single.zeroCorrection);
+    TEST_ASSERT_FLOAT_WITHIN(2, 100, single.compensatedMaxForce);
+    TEST_ASSERT_EQUAL_UINT32(80, single.capture.size() / 2);
+
+    for (size_t blockSize : {2, 7, 16, 23, 31})
+    {
+      Published blocks = replayAcquisition(statePeriod, blockSize);
+      TEST_ASSERT_EQUAL_UINT32(single.samples.size(), blocks.samples.size());
+      TEST_ASSERT_EQUAL_MEMORY(single.samples.data(), blocks.samples.data(), single.samples.size() * sizeof(Result));
+      TEST_ASSERT_EQUAL_UINT32(single.capture.size(), blocks.capture.size());
+      TEST_ASSERT_EQUAL_FLOAT_ARRAY(single.capture.data(), blocks.capture.data(), single.capture.size());
+      TEST_ASSERT_EQUAL_UINT32(single.triggerIndex, blocks.triggerIndex);
+      TEST_ASSERT_EQUAL_UINT32(single.record.size(), blocks.record.size());
+      TEST_ASSERT_EQUAL_MEMORY(single.record.data(), blocks.record.data(), single.record.size() * sizeof(float));
+      TEST_ASSERT_EQUAL_FLOAT(single.maxForce, blocks.maxForce);
+      TEST_ASSERT_EQUAL_FLOAT(single.compensatedMaxForce, blocks.compensatedMaxForce);
+      TEST_ASSERT_EQUAL_FLOAT(single.zeroCorrection, blocks.zeroCorrection);
+    }
+  }
+}
+
+static void test_benchmark()
+{
+  // samples per second through all stages, the capture and the chip simulation excluded
+  const int n = 200000;
+  for (size_t blockSize : {1, 4, 16})
+  {
+    mock::reset();
+    HX711Sim chip(DOUT_PIN, SCK_PIN);
+    HX711 loadcell;
+    loadcell.begin(DOUT_PIN, SCK_PIN);
+    loadcell.set_rate(HX711_RATE_80SPS);
+    loadcell.set_spike_filter(5, 5, 500);
+    loadcell.begin_capture();
+    double seconds = 0;
+    int processed = 0;
+    while (processed < n)
+    {
+      for (size_t k = 0; k < blockSize; k++)
+      {
+        mock::advance(12500);
+        chip.convert(100000 + (processed + k) % 97);
+      }
+      auto start = std::chrono::steady_clock::now();
+      LoadCellBlock block;
+      processed += loadcell.poll_block(block, blockSize);
+      seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    loadcell.end_capture();
+    printf("pipeline, blocks of %u: %.0f samples/s\n", (unsigned)blockSize, processed / seconds);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_blocks_are_bit_identical);
+  RUN_TEST(test_acquisition_blocks_are_bit_identical);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
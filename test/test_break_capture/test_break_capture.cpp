@@ -0,0 +1,167 @@
+// BreakCapture: the ring of the pre-trigger history and the window that freezes after
+// the post-trigger samples.
+
+#include <unity.h>
+
+#include "break_capture.h"
+
+static BreakCapture *capture;
+
+static ForceSample sample(uint32_t seq)
+{
+  ForceSample s = {};
+  s.seq = seq;
+  s.raw = (long)seq * 10;
+  s.force = seq * 0.5f;
+  return s;
+}
+
+// push the samples first ... last - 1
+static void pushRange(uint32_t first, uint32_t last)
+{
+  for (uint32_t seq = first; seq < last; seq++)
+    capture->push(sample(seq));
+}
+
+// the frozen window holds the consecutive samples from first on
+static void checkWindow(uint32_t first, size_t count)
+{
+  TEST_ASSERT_EQUAL_UINT32(count, capture->get_count());
+  for (size_t i = 0; i < count; i++)
+  {
+    TEST_ASSERT_EQUAL_UINT32(first + i, capture->get(i).seq);
+    TEST_ASSERT_EQUAL_INT32((first + i) * 10, capture->get(i).raw);
+  }
+}
+
+void setUp()
+{
+  capture = new BreakCapture();
+}
+
+void tearDown()
+{
+  delete capture;
+}
+
+static void test_off_without_buffer()
+{
+  TEST_ASSERT_EQUAL_INT(CAPTURE_OFF, capture->get_state());
+  capture->push(sample(1));
+  capture->trigger();
+  capture->arm();
+  TEST_ASSERT_EQUAL_INT(CAPTURE_OFF, capture->get_state());
+  TEST_ASSERT_FALSE(capture->begin(0, 0));
+  TEST_ASSERT_EQUAL_INT(CAPTURE_OFF, capture->get_state());
+}
+
+static void test_window_around_the_trigger()
+{
+  TEST_ASSERT_TRUE(capture->begin(5, 3));
+  TEST_ASSERT_EQUAL_INT(CAPTURE_ARMED, capture->get_state());
+  pushRange(0, 100);
+  capture->trigger(); // at sample 99
+  TEST_ASSERT_EQUAL_INT(CAPTURE_TRIGGERED, capture->get_state());
+  pushRange(100, 102);
+  TEST_ASSERT_FALSE(capture->is_frozen());
+  pushRange(102, 103);
+  TEST_ASSERT_TRUE(capture->is_frozen());
+
+  // 5 samples up to and including the trigger, 3 after it
+  checkWindow(95, 8);
+  TEST_ASSERT_EQUAL_UINT32(4, capture->get_trigger_index());
+  TEST_ASSERT_EQUAL_UINT32(99, capture->get(capture->get_trigger_index()).seq);
+
+  // nothing is written once frozen, a second trigger does not count
+  pushRange(103, 120);
+  capture->trigger();
+  TEST_ASSERT_TRUE(capture->is_frozen());
+  checkWindow(95, 8);
+}
+
+static void test_early_trigger()
+{
+  TEST_ASSERT_TRUE(capture->begin(5, 3));
+  // a trigger before any sample is ignored
+  capture->trigger();
+  TEST_ASSERT_EQUAL_INT(CAPTURE_ARMED, capture->get_state());
+
+  pushRange(0, 2);
+  capture->trigger();
+  pushRange(2, 5);
+  TEST_ASSERT_TRUE(capture->is_frozen());
+  // the short history and the whole post-trigger window
+  checkWindow(0, 5);
+  TEST_ASSERT_EQUAL_UINT32(1, capture->get_trigger_index());
+}
+
+static void test_trigger_while_the_ring_fills()
+{
+  // 7 of 8 slots filled: the post-trigger window pushes the oldest samples out
+  TEST_ASSERT_TRUE(capture->begin(5, 3));
+  pushRange(0, 7);
+  capture->trigger();
+  pushRange(7, 10);
+  TEST_ASSERT_TRUE(capture->is_frozen());
+  checkWindow(2, 8);
+  TEST_ASSERT_EQUAL_UINT32(4, capture->get_trigger_index());
+  TEST_ASSERT_EQUAL_UINT32(6, capture->get(4).seq);
+}
+
+static void test_trigger_repeated_while_recording()
+{
+  TEST_ASSERT_TRUE(capture->begin(4, 4));
+  pushRange(0, 20);
+  capture->trigger();
+  pushRange(20, 22);
+  // only the first trigger counts
+  capture->trigger();
+  pushRange(22, 24);
+  TEST_ASSERT_TRUE(capture->is_frozen());
+  checkWindow(16, 8);
+  TEST_ASSERT_EQUAL_UINT32(19, capture->get(capture->get_trigger_index()).seq);
+}
+
+static void test_without_post_window()
+{
+  TEST_ASSERT_TRUE(capture->begin(6, 0));
+  pushRange(0, 30);
+  capture->trigger();
+  TEST_ASSERT_TRUE(capture->is_frozen());
+  checkWindow(24, 6);
+  TEST_ASSERT_EQUAL_UINT32(5, capture->get_trigger_index());
+}
+
+static void test_arm_again()
+{
+  TEST_ASSERT_TRUE(capture->begin(3, 2));
+  pushRange(0, 10);
+  capture->trigger();
+  pushRange(10, 12);
+  TEST_ASSERT_TRUE(capture->is_frozen());
+
+  capture->arm();
+  TEST_ASSERT_EQUAL_INT(CAPTURE_ARMED, capture->get_state());
+  TEST_ASSERT_EQUAL_UINT32(0, capture->get_count());
+  pushRange(100, 110);
+  capture->trigger();
+  pushRange(110, 112);
+  checkWindow(107, 5);
+  TEST_ASSERT_EQUAL_UINT32(109, capture->get(capture->get_trigger_index()).seq);
+
+  capture->end();
+  TEST_ASSERT_EQUAL_INT(CAPTURE_OFF, capture->get_state());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_off_without_buffer);
+  RUN_TEST(test_window_around_the_trigger);
+  RUN_TEST(test_early_trigger);
+  RUN_TEST(test_trigger_while_the_ring_fills);
+  RUN_TEST(test_trigger_repeated_while_recording);
+  RUN_TEST(test_without_post_window);
+  RUN_TEST(test_arm_again);
+  return UNITY_END();
+}
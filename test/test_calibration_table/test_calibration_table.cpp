@@ -0,0 +1,217 @@
+// CalibrationTable: the sorted points, the fixed point interpolation against a double
+// reference for small and large sensitivities, a non-linear load cell calibrated through
+// the HX711, and a benchmark of the evaluation against the linear scale.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "biquad.h"
+#include "calibration_table.h"
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+
+#define DOUT_PIN 4
+#define SCK_PIN 2
+#define ONE (1 << Biquad::signalBits)
+
+// piecewise linear through (0, 0) and the points, the outer segments continued
+static double interpolate(const CalibrationTable &table, double reading)
+{
+  std::vector<CalibrationTable::Point> nodes;
+  for (uint8_t i = 0; i < table.get_count(); i++)
+    nodes.push_back(table.get(i));
+  nodes.push_back({0, 0});
+  std::sort(nodes.begin(), nodes.end(), [](const CalibrationTable::Point &a, const CalibrationTable::Point &b) {
+    return a.reading < b.reading;
+  });
+  size_t k = 0;
+  while (k + 2 < nodes.size() && nodes[k + 1].reading <= reading)
+    k++;
+  const CalibrationTable::Point &a = nodes[k];
+  const CalibrationTable::Point &b = nodes[k + 1];
+  return a.force + (reading - a.reading) * (b.force - a.force) / (b.reading - a.reading);
+}
+
+// a load cell 0.5% short at full scale, with a slight S shape: counts for a force
+static double cellReading(double force, double sensitivity, double fullScale)
+{
+  double x = force / fullScale;
+  return sensitivity * force * (1 - 0.005 * x * fabs(x) + 0.001 * sin(3 * x));
+}
+
+void setUp()
+{
+  srand(17);
+}
+
+void tearDown()
+{
+}
+
+static void test_points()
+{
+  CalibrationTable table;
+  TEST_ASSERT_FALSE(table.is_active());
+  TEST_ASSERT_EQUAL_INT32(0, table.evaluate(1000));
+  TEST_ASSERT_EQUAL_FLOAT(0, table.get_sensitivity());
+
+  // sorted in, the zero point is implicit and rejected
+  TEST_ASSERT_TRUE(table.add(5000, 50));
+  TEST_ASSERT_TRUE(table.add(-2000, -20));
+  TEST_ASSERT_TRUE(table.add(1000, 10));
+  TEST_ASSERT_FALSE(table.add(0.5f, 1));
+  TEST_ASSERT_TRUE(table.is_active());
+  TEST_ASSERT_EQUAL_UINT8(3, table.get_count());
+  TEST_ASSERT_EQUAL_FLOAT(-2000, table.get(0).reading);
+  TEST_ASSERT_EQUAL_FLOAT(1000, table.get(1).reading);
+  TEST_ASSERT_EQUAL_FLOAT(5000, table.get(2).reading);
+  TEST_ASSERT_EQUAL_FLOAT(100, table.get_sensitivity());
+
+  // a point within one count replaces the force
+  TEST_ASSERT_TRUE(table.add(5000.5f, 49));
+  TEST_ASSERT_EQUAL_UINT8(3, table.get_count());
+  TEST_ASSERT_EQUAL_FLOAT(49, table.get(2).force);
+
+  // up to maxPoints
+  table.clear();
+  TEST_ASSERT_FALSE(table.is_active());
+  for (int i = 1; i <= CalibrationTable::maxPoints; i++)
+    TEST_ASSERT_TRUE(table.add(i * 100.0f, i));
+  TEST_ASSERT_FALSE(table.add(-100, -1));
+  CalibrationTable::Point points[CalibrationTable::maxPoints + 1];
+  for (int i = 0; i <= CalibrationTable::maxPoints; i++)
+    points[i] = {-100.0f * (i + 1), -1.0f * (i + 1)};
+  TEST_ASSERT_FALSE(table.set_points(points, CalibrationTable::maxPoints + 1));
+  TEST_ASSERT_TRUE(table.set_points(points, 4));
+  TEST_ASSERT_EQUAL_UINT8(4, table.get_count());
+  TEST_ASSERT_EQUAL_FLOAT(-400, table.get(0).reading);
+}
+
+static void test_interpolation_against_double()
+{
+  // from under 1 to thousands of counts per force unit, over the whole 24-bit range
+  for (double sensitivity : {4.2, 12.5, 1000.0, 21345.6})
+  {
+    double fullScale = 8000000 / sensitivity;
+    CalibrationTable table;
+    for (int i = -3; i <= 10; i++)
+    {
+      if (i == 0)
+        continue;
+      double force = fullScale * i / 10;
+      TEST_ASSERT_TRUE(table.add((float)cellReading(force, sensitivity, fullScale), (float)force));
+    }
+    float first = table.get(0).reading;
+    float last = table.get(table.get_count() - 1).reading;
+    for (int i = 0; i < 20000; i++)
+    {
+      int32_t reading = (rand() % 18000000 - 9000000) * ONE + rand() % ONE;
+      double expected = 1000 * interpolate(table, reading / (double)ONE);
+      if (fabs(expected) > INT32_MAX)
+      {
+        TEST_ASSERT_EQUAL_INT32(expected > 0 ? INT32_MAX : INT32_MIN, table.evaluate(reading));
+        continue;
+      }
+      // The nodes are rounded to mN and to a fixed point step, the result to mN. Beyond
+      // the outermost points the outer segments continue, and so does the rounding error.
+      double tolerance = 1 + 500 / (sensitivity * ONE);
+      if (reading < first * ONE || reading > last * ONE)
+        tolerance *= 10;
+      TEST_ASSERT_TRUE(fabs(table.evaluate(reading) - expected) <= tolerance);
+    }
+  }
+}
+
+static void test_nonlinear_cell_through_the_hx711()
+{
+  // a 500 N cell calibrated in 5 steps: the linear scale misses the curve by up to
+  // 0.5%, the table only between its points
+  const double sensitivity = 1000; // counts per N
+  const double fullScale = 500;
+  const long zero = 31000;
+  mock::reset();
+  HX711Sim chip(DOUT_PIN, SCK_PIN);
+  HX711 loadcell;
+  loadcell.begin(DOUT_PIN, SCK_PIN);
+  loadcell.set_rate(HX711_RATE_80SPS);
+  loadcell.set_zeropoint_offset(zero);
+  auto settle = [&](double force) {
+    for (int n = 0; n < 240; n++)
+    {
+      mock::advance(12500);
+      chip.convert(zero + lround(cellReading(force, sensitivity, fullScale)));
+      TEST_ASSERT_TRUE(loadcell.try_read(0));
+    }
+  };
+
+  settle(100);
+  loadcell.set_scale_current(100);
+  for (double force : {100.0, 200.0, 300.0, 400.0, 500.0})
+  {
+    settle(force);
+    TEST_ASSERT_TRUE(loadcell.add_calibration_point(force));
+  }
+  TEST_ASSERT_EQUAL_UINT8(5, loadcell.get_calibration_table().get_count());
+
+  double tableError = 0;
+  for (double force = 0; force <= 500; force += 12.5)
+  {
+    settle(force);
+    tableError = fmax(tableError, fabs(loadcell.get_cal_force() - force));
+  }
+  // the curve bends by less than 0.1 N over a step of 100 N
+  TEST_ASSERT_LESS_THAN_FLOAT(0.1f, (float)tableError);
+
+  // the scale from 100 N misses 500 N by the curve
+  loadcell.clear_calibration_table();
+  settle(500);
+  double linear = 100 * cellReading(500, sensitivity, fullScale) / cellReading(100, sensitivity, fullScale);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, linear, loadcell.get_cal_force());
+  TEST_ASSERT_GREATER_THAN_FLOAT(10 * tableError, 500 - loadcell.get_cal_force());
+}
+
+static void test_benchmark()
+{
+  // evaluation per sample against the linear scale it replaces
+  const int n = 4000000;
+  static int32_t readings[1024];
+  for (int i = 0; i < 1024; i++)
+    readings[i] = (rand() % 16000000 - 8000000) * ONE;
+  volatile int32_t sink = 0;
+
+  const int32_t scaleInv = (int32_t)lround(ldexp(1000.0 / (21.3 * ONE), 29));
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++)
+    sink = sink + (int32_t)(((int64_t)readings[i & 1023] * scaleInv + (1 << 28)) >> 29);
+  double linearNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+  printf("linear scale: %.2f ns\n", linearNs);
+
+  for (int points : {1, 4, (int)CalibrationTable::maxPoints})
+  {
+    CalibrationTable table;
+    for (int i = 1; i <= points; i++)
+      table.add(8000000.0f * i / points, 375000.0f * i / points * (1 - 0.001f * i));
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+      sink = sink + table.evaluate(readings[i & 1023]);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+    printf("table of %d points: %.2f ns\n", points, ns);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_points);
+  RUN_TEST(test_interpolation_against_double);
+  RUN_TEST(test_nonlinear_cell_through_the_hx711);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
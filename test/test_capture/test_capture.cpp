@@ -0,0 +1,179 @@
+// Interrupt driven capture: the DOUT edge of a simulated HX711 runs the ISR, which reads
+// the conversion out and queues it with its timestamp in the SampleRing.
+
+#include <unity.h>
+
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+#include "sample_ring.h"
+
+#define DOUT_PIN 4
+#define SCK_PIN 2
+#define INTERVAL_US 100000 // 10 SPS
+
+static HX711 *loadcell;
+static HX711Sim *chip;
+
+void setUp()
+{
+  mock::reset();
+  chip = new HX711Sim(DOUT_PIN, SCK_PIN);
+  loadcell = new HX711();
+  loadcell->begin(DOUT_PIN, SCK_PIN);
+}
+
+void tearDown()
+{
+  loadcell->end_capture();
+  delete loadcell;
+  delete chip;
+}
+
+static void test_ring_push_pop_in_order()
+{
+  SampleRing<int, 8> ring;
+  TEST_ASSERT_TRUE(ring.empty());
+  for (int i = 0; i < 5; i++)
+    TEST_ASSERT_TRUE(ring.push(i));
+  TEST_ASSERT_EQUAL_UINT32(5, ring.available());
+  for (int i = 0; i < 5; i++)
+  {
+    int value = -1;
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL_INT(i, value);
+  }
+  int value;
+  TEST_ASSERT_FALSE(ring.pop(value));
+}
+
+static void test_ring_full_drops_newest()
+{
+  SampleRing<int, 8> ring;
+  for (int i = 0; i < 10; i++)
+    ring.push(i);
+  TEST_ASSERT_EQUAL_UINT32(7, ring.capacity());
+  TEST_ASSERT_EQUAL_UINT32(7, ring.available());
+  TEST_ASSERT_EQUAL_UINT32(3, ring.get_dropped());
+  int value;
+  ring.pop(value);
+  TEST_ASSERT_EQUAL_INT(0, value);
+}
+
+static void test_ring_pop_block_wraps_around()
+{
+  SampleRing<int, 8> ring;
+  int next = 0;
+  int expected = 0;
+  for (int round = 0; round < 10; round++)
+  {
+    for (int i = 0; i < 5; i++)
+      ring.push(next++);
+    int block[8];
+    size_t n = ring.pop_block(block, 3);
+    TEST_ASSERT_EQUAL_UINT32(3, n);
+    n += ring.pop_block(&block[3], 8);
+    TEST_ASSERT_EQUAL_UINT32(5, n);
+    for (size_t i = 0; i < n; i++)
+      TEST_ASSERT_EQUAL_INT(expected++, block[i]);
+  }
+}
+
+static void test_edge_queues_reading_and_timestamp()
+{
+  loadcell->begin_capture();
+  const long values[] = {0, 1, -1, 123456, -123456, 0x7FFFFF, -0x800000, 0x555555, -0x2AAAAB};
+  const int n = sizeof(values) / sizeof(values[0]);
+  for (int i = 0; i < n; i++)
+  {
+    mock::set_time(2000000 + (int64_t)i * INTERVAL_US);
+    chip->convert(values[i]);
+    // the ISR read the conversion out, DOUT is high again
+    TEST_ASSERT_FALSE(chip->is_ready());
+  }
+
+  LoadCellBlock block;
+  size_t count = loadcell->poll_block(block);
+  TEST_ASSERT_EQUAL_UINT32(n, count);
+  for (int i = 0; i < n; i++)
+  {
+    TEST_ASSERT_EQUAL_INT32(values[i], block.raw[i]);
+    TEST_ASSERT_TRUE(block.timestamp[i] == 2000000 + (int64_t)i * INTERVAL_US);
+  }
+  TEST_ASSERT_EQUAL_UINT32(n, chip->readouts);
+  TEST_ASSERT_EQUAL_UINT32(0, loadcell->get_capture_dropped());
+}
+
+static void test_data_bits_do_not_retrigger()
+{
+  // alternating bits toggle DOUT during the readout; those edges are latched while the
+  // interrupt is masked and must not be taken for new conversions
+  loadcell->begin_capture();
+  for (int i = 0; i < 4; i++)
+  {
+    mock::advance(INTERVAL_US);
+    chip->convert(0x2AAAAA);
+  }
+  LoadCellBlock block;
+  TEST_ASSERT_EQUAL_UINT32(4, loadcell->poll_block(block));
+  TEST_ASSERT_EQUAL_UINT32(4, chip->readouts);
+  TEST_ASSERT_EQUAL_UINT32(0, loadcell->poll_block(block));
+}
+
+static void test_conversion_before_capture_is_fetched()
+{
+  // no edge is left for a conversion that was ready before the interrupt was attached
+  chip->convert(4242);
+  loadcell->begin_capture();
+  TEST_ASSERT_FALSE(chip->is_ready());
+  LoadCellBlock block;
+  TEST_ASSERT_EQUAL_UINT32(1, loadcell->poll_block(block));
+  TEST_ASSERT_EQUAL_INT32(4242, block.raw[0]);
+}
+
+static void test_full_ring_counts_dropped_samples()
+{
+  loadcell->begin_capture();
+  const int n = 40;
+  for (int i = 0; i < n; i++)
+  {
+    mock::advance(INTERVAL_US);
+    chip->convert(i);
+  }
+  // every conversion was read out, the ones beyond the capacity are counted
+  TEST_ASSERT_EQUAL_UINT32(n, chip->readouts);
+  TEST_ASSERT_EQUAL_UINT32(n - 31, loadcell->get_capture_dropped());
+
+  int expected = 0;
+  LoadCellBlock block;
+  size_t count;
+  while ((count = loadcell->poll_block(block)) > 0)
+  {
+    for (size_t i = 0; i < count; i++)
+      TEST_ASSERT_EQUAL_INT32(expected++, block.raw[i]);
+  }
+  TEST_ASSERT_EQUAL_INT(31, expected);
+}
+
+static void test_end_capture_detaches()
+{
+  loadcell->begin_capture();
+  loadcell->end_capture();
+  chip->convert(7);
+  TEST_ASSERT_TRUE(chip->is_ready());
+  LoadCellBlock block;
+  TEST_ASSERT_EQUAL_UINT32(0, loadcell->poll_block(block));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_ring_push_pop_in_order);
+  RUN_TEST(test_ring_full_drops_newest);
+  RUN_TEST(test_ring_pop_block_wraps_around);
+  RUN_TEST(test_edge_queues_reading_and_timestamp);
+  RUN_TEST(test_data_bits_do_not_retrigger);
+  RUN_TEST(test_conversion_before_capture_is_fetched);
+  RUN_TEST(test_full_ring_counts_dropped_samples);
+  RUN_TEST(test_end_capture_detaches);
+  return UNITY_END();
+}
@@ -0,0 +1,268 @@
+// FFT: the transform against a direct DFT, the detrending, the Hann window and the
+// amplitude spectral density of white noise, the largest size, and a benchmark of the
+// transform.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <complex>
+#include <vector>
+
+#include "fft.h"
+
+// uniform in -1 ... 1
+static float uniform()
+{
+  return 2.0f * rand() / RAND_MAX - 1;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_begin()
+{
+  FFT fft;
+  TEST_ASSERT_EQUAL_UINT16(0, fft.get_size());
+  for (uint16_t n : {0, 1, 3, 6, 1000, 1023})
+  {
+    TEST_ASSERT_FALSE(fft.begin(n));
+    TEST_ASSERT_EQUAL_UINT16(0, fft.get_size());
+  }
+  for (uint16_t n : {2, 4, 64, 1024, 32768})
+  {
+    TEST_ASSERT_TRUE(fft.begin(n));
+    TEST_ASSERT_EQUAL_UINT16(n, fft.get_size());
+  }
+}
+
+static void test_transform_against_dft()
+{
+  srand(9);
+  for (uint16_t n = 2; n <= 1024; n <<= 1)
+  {
+    FFT fft;
+    TEST_ASSERT_TRUE(fft.begin(n));
+    std::vector<float> re(n), im(n);
+    for (uint16_t i = 0; i < n; i++)
+    {
+      re[i] = uniform();
+      im[i] = uniform();
+    }
+    std::vector<std::complex<double>> expected(n);
+    for (uint16_t k = 0; k < n; k++)
+    {
+      for (uint16_t i = 0; i < n; i++)
+        expected[k] += std::complex<double>(re[i], im[i]) * std::polar(1.0, -2 * M_PI * ((uint32_t)i * k % n) / n);
+    }
+    fft.transform(re.data(), im.data());
+    // float rounding grows with log2(n); the values grow with sqrt(n)
+    float tolerance = 1e-6f * sqrtf(n) * log2f(n) * 4;
+    for (uint16_t k = 0; k < n; k++)
+    {
+      TEST_ASSERT_FLOAT_WITHIN(tolerance, expected[k].real(), re[k]);
+      TEST_ASSERT_FLOAT_WITHIN(tolerance, expected[k].imag(), im[k]);
+    }
+  }
+}
+
+static void test_sine_and_round_trip()
+{
+  const uint16_t n = 256;
+  FFT fft;
+  TEST_ASSERT_TRUE(fft.begin(n));
+  float re[n], im[n], x[n];
+  for (uint16_t i = 0; i < n; i++)
+  {
+    x[i] = re[i] = 3 * cosf(2 * (float)M_PI * 10 * i / n) + 0.5f;
+    im[i] = 0;
+  }
+  fft.transform(re, im);
+  // a real cosine of amplitude A in bin 10 gives A n / 2 at +-10, the offset n / 2 at 0
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.5f * n, re[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1.5f * n, re[10]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1.5f * n, re[n - 10]);
+  for (uint16_t k = 0; k < n; k++)
+  {
+    if (k != 0 && k != 10 && k != n - 10)
+      TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0, hypotf(re[k], im[k]));
+  }
+
+  // the inverse with the conjugates gives back n x
+  for (uint16_t k = 0; k < n; k++)
+    im[k] = -im[k];
+  fft.transform(re, im);
+  for (uint16_t i = 0; i < n; i++)
+  {
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, x[i], re[i] / n);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0, im[i] / n);
+  }
+}
+
+static void test_largest_size()
+{
+  // 32768 points, the largest that begin() accepts: the butterfly loop runs to the end
+  // of the 16-bit range
+  const uint16_t n = 32768;
+  FFT fft;
+  TEST_ASSERT_TRUE(fft.begin(n));
+  std::vector<float> re(n), im(n, 0.0f), x(n);
+  // the phase in double, so the float rounding of the argument does not leak
+  for (uint16_t i = 0; i < n; i++)
+    x[i] = re[i] = (float)(3 * cos(2 * M_PI * (1000u * i % n) / n) + 0.5);
+  fft.transform(re.data(), im.data());
+  // as against the DFT, for values up to 3.5
+  float tolerance = 1e-6f * sqrtf(n) * log2f(n) * 4 * 3.5f;
+  TEST_ASSERT_FLOAT_WITHIN(tolerance, 0.5f * n, re[0]);
+  TEST_ASSERT_FLOAT_WITHIN(tolerance, 1.5f * n, re[1000]);
+  TEST_ASSERT_FLOAT_WITHIN(tolerance, 1.5f * n, re[n - 1000]);
+  for (uint16_t k = 0; k < n; k++)
+  {
+    if (k != 0 && k != 1000 && k != n - 1000)
+      TEST_ASSERT_FLOAT_WITHIN(tolerance, 0, hypotf(re[k], im[k]));
+  }
+
+  for (uint16_t k = 0; k < n; k++)
+    im[k] = -im[k];
+  fft.transform(re.data(), im.data());
+  for (uint16_t i = 0; i < n; i++)
+  {
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, x[i], re[i] / n);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0, im[i] / n);
+  }
+}
+
+static void test_detrend()
+{
+  const uint16_t n = 100;
+  float x[n];
+  srand(10);
+  float noise[n];
+  for (uint16_t i = 0; i < n; i++)
+  {
+    noise[i] = uniform();
+    x[i] = 12345 + 2.5f * i + noise[i];
+  }
+  FFT::detrend(x, n);
+  // no mean and no slope left; the noise remains
+  double sum = 0, sumT = 0;
+  for (uint16_t i = 0; i < n; i++)
+  {
+    sum += x[i];
+    sumT += (i - (n - 1) / 2.0) * x[i];
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, noise[i], x[i]);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-2f, 0, sum);
+  TEST_ASSERT_FLOAT_WITHIN(1, 0, sumT);
+
+  // a single value is its own mean
+  float one = 7;
+  FFT::detrend(&one, 1);
+  TEST_ASSERT_EQUAL_FLOAT(0, one);
+}
+
+static void test_hann()
+{
+  const uint16_t n = 64;
+  float w[n];
+  for (uint16_t i = 0; i < n; i++)
+    w[i] = 1;
+  FFT::hann(w, n);
+  // periodic: 0 at the start, 1 in the middle, symmetric around it
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0, w[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1, w[n / 2]);
+  float power = 0;
+  for (uint16_t i = 1; i < n; i++)
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, w[i], w[n - i]);
+  for (uint16_t i = 0; i < n; i++)
+    power += w[i] * w[i];
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, FFT::hann_power(n), power);
+}
+
+static void test_density_of_white_noise()
+{
+  // uniform noise of variance 1/3 at 80 SPS: flat density sqrt(2 var / fs), and the
+  // integral of the density squared over 0 ... fs / 2 gives back the variance
+  const uint16_t n = 1024;
+  const float fs = 80;
+  FFT fft;
+  TEST_ASSERT_TRUE(fft.begin(n));
+  std::vector<double> mean(n / 2 + 1);
+  srand(11);
+  const int records = 200;
+  for (int r = 0; r < records; r++)
+  {
+    float re[n], im[n];
+    for (uint16_t i = 0; i < n; i++)
+    {
+      re[i] = 1000 + uniform();
+      im[i] = 0;
+    }
+    FFT::detrend(re, n);
+    FFT::hann(re, n);
+    fft.transform(re, im);
+    FFT::density(re, im, n, fs, FFT::hann_power(n));
+    for (uint16_t k = 0; k <= n / 2; k++)
+      mean[k] += (double)re[k] * re[k] / records;
+  }
+
+  const float variance = 1 / 3.0f;
+  double integral = 0;
+  for (uint16_t k = 1; k < n / 2; k++)
+  {
+    integral += mean[k] * fs / n;
+    // the detrending takes a little of the lowest bins
+    if (k < 3)
+      continue;
+    TEST_ASSERT_FLOAT_WITHIN(0.4f * 2 * variance / fs, 2 * variance / fs, mean[k]);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.03f * variance, variance, integral);
+}
+
+static void test_benchmark()
+{
+  // time per transform around SPECTRUM_SIZE; a transform takes n / 2 log2(n) butterflies
+  srand(12);
+  for (uint16_t n : {256, 1024, 4096})
+  {
+    FFT fft;
+    TEST_ASSERT_TRUE(fft.begin(n));
+    std::vector<float> re(n), im(n), x(n);
+    for (uint16_t i = 0; i < n; i++)
+      x[i] = uniform();
+    const int repeat = 4000000 / n;
+    double ns = 0;
+    for (int r = 0; r < repeat; r++)
+    {
+      std::copy(x.begin(), x.end(), re.begin());
+      std::fill(im.begin(), im.end(), 0.0f);
+      auto start = std::chrono::steady_clock::now();
+      fft.transform(re.data(), im.data());
+      ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+    ns /= repeat;
+    printf("FFT %u points: %.0f ns, %.2f ns per butterfly\n", n, ns, ns / (n / 2 * log2(n)));
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_begin);
+  RUN_TEST(test_transform_against_dft);
+  RUN_TEST(test_sine_and_round_trip);
+  RUN_TEST(test_largest_size);
+  RUN_TEST(test_detrend);
+  RUN_TEST(test_hann);
+  RUN_TEST(test_density_of_white_noise);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
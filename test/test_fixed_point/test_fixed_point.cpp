@@ -0,0 +1,263 @@
+// Integer force pipeline: the fixed point low pass and the calibration to mN against a
+// double precision reference of the same filter, next to the float path it replaced,
+// the rounding of the reciprocal scale, and a benchmark of both paths.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+#include "biquad.h"
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+
+#define DOUT_PIN 4
+#define SCK_PIN 2
+// Error bound in counts against the ideal filter: the float coefficients the fixed point
+// ones are quantized from limit it to about 1e-6 of the 24-bit range.
+#define MAX_ERROR (1e-6f * (1 << 23))
+
+// A section of the low pass or the notch in double, designed like BiquadBank does.
+struct ReferenceSection
+{
+  double b0, b1, b2, a1, a2;
+  double z1 = 0, z2 = 0;
+
+  ReferenceSection(double f0, double q, double fs, bool isNotch)
+  {
+    double w0 = 2 * M_PI * f0 / fs;
+    double alpha = sin(w0) / (2 * q);
+    double a0 = 1 + alpha;
+    if (isNotch)
+    {
+      b0 = b2 = 1 / a0;
+      b1 = -2 * cos(w0) / a0;
+    }
+    else
+    {
+      b0 = b2 = (1 - cos(w0)) / 2 / a0;
+      b1 = (1 - cos(w0)) / a0;
+    }
+    a1 = -2 * cos(w0) / a0;
+    a2 = (1 - alpha) / a0;
+  }
+
+  double filter(double x)
+  {
+    double y = b0 * x + z1;
+    z1 = b1 * x - a1 * y + z2;
+    z2 = b2 * x - a2 * y;
+    return y;
+  }
+};
+
+// 2nd order Butterworth low pass at cutoff, an optional notch, in double
+struct Reference
+{
+  std::vector<ReferenceSection> sections;
+
+  Reference(double cutoff, double notch, double fs)
+  {
+    sections.emplace_back(cutoff, 1 / sqrt(2), fs, false);
+    if (notch > 0)
+      sections.emplace_back(notch, 30, fs, true);
+  }
+
+  double filter(double x)
+  {
+    for (ReferenceSection &s : sections)
+      x = s.filter(x);
+    return x;
+  }
+};
+
+// normally distributed noise with the standard deviation sigma (Box-Muller)
+static float gauss(float sigma)
+{
+  float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+  float u2 = (float)rand() / RAND_MAX;
+  return sigma * sqrtf(-2 * logf(u1)) * cosf(2 * (float)M_PI * u2);
+}
+
+// Readings near the upper end of the 24-bit range, where float has a resolution of half
+// a count: loading ramps and holds with noise.
+static long reading(int i, float fs)
+{
+  float t = i / fs;
+  float load = 2000000 * fabsf(sinf(0.5f * t)) + 50000 * sinf(13 * t);
+  return 5000000 + lroundf(load + gauss(300));
+}
+
+void setUp()
+{
+  srand(16);
+}
+
+void tearDown()
+{
+}
+
+static void test_calibration_to_milli()
+{
+  // the reciprocal scale rounds like the division, for scales far below and above 1
+  mock::reset();
+  HX711Sim chip(DOUT_PIN, SCK_PIN);
+  HX711 loadcell;
+  loadcell.begin(DOUT_PIN, SCK_PIN);
+  loadcell.set_rate(HX711_RATE_80SPS);
+  for (float scale : {0.5f, 1.5f, 7.3f, 420.0f, 1000.0f, 21345.6f, -812.5f})
+  {
+    for (long raw : {-8388608L, -123457L, -1L, 0L, 1L, 999L, 654321L, 8388607L})
+    {
+      loadcell.set_scale(scale);
+      loadcell.set_zeropoint_offset(-3217);
+      // the fixed point low pass settles on the exact count
+      for (int n = 0; n < 400; n++)
+      {
+        mock::advance(12500);
+        chip.convert(raw);
+        TEST_ASSERT_TRUE(loadcell.try_read(0));
+      }
+      double expected = (raw + 3217.0) / scale * 1000;
+      if (fabs(expected) > INT32_MAX)
+      {
+        // beyond the int32 range of mN the force saturates
+        TEST_ASSERT_EQUAL_INT32(expected > 0 ? INT32_MAX : INT32_MIN, loadcell.get_cal_force_milli());
+        continue;
+      }
+      TEST_ASSERT_TRUE(fabs(expected - loadcell.get_cal_force_milli()) <= 0.5 + fabs(expected) * 2e-9);
+      TEST_ASSERT_FLOAT_WITHIN(0.0011f + fabsf(expected) * 1e-9f, expected / 1000, loadcell.get_cal_force());
+    }
+  }
+}
+
+static void test_error_against_the_float_path()
+{
+  // The HX711 at 80 SPS with a 2 Hz low pass, end to end: the force in mN against the
+  // double reference, next to the float filter and division that it replaced.
+  const float fs = 80;
+  const float scale = 10.7f; // counts per N
+  const float zero = 4321;
+  mock::reset();
+  HX711Sim chip(DOUT_PIN, SCK_PIN);
+  HX711 loadcell;
+  loadcell.begin(DOUT_PIN, SCK_PIN);
+  loadcell.set_rate(HX711_RATE_80SPS);
+  loadcell.set_scale(scale);
+  loadcell.set_zeropoint_offset(zero);
+  TEST_ASSERT_TRUE(loadcell.set_filter(FILTER_PROFILE_IDLE, FILTER_BUTTERWORTH, 2, 2));
+
+  Reference reference(2, 0, fs);
+  BiquadBank floatBank;
+  floatBank.set_lowpass(FILTER_BUTTERWORTH, 2, 2);
+  floatBank.set_notch(0);
+  TEST_ASSERT_TRUE(floatBank.begin(fs));
+
+  double fixedError = 0, floatError = 0;
+  for (int i = 0; i < 60 * fs; i++)
+  {
+    long raw = reading(i, fs);
+    mock::advance(12500);
+    chip.convert(raw);
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+    double expected = (reference.filter(raw) - zero) / scale * 1000;
+    float floatForce = (floatBank.filter((float)raw) - zero) / scale * 1000;
+    fixedError = fmax(fixedError, fabs(loadcell.get_cal_force_milli() - expected));
+    floatError = fmax(floatError, fabs(floatForce - expected));
+  }
+  printf("2 Hz at 80 SPS, max error in counts: fixed point %.3f, float %.3f\n", fixedError * scale / 1000,
+         floatError * scale / 1000);
+  // plus the rounding to mN
+  TEST_ASSERT_LESS_THAN_FLOAT(MAX_ERROR * 1000 / scale + 0.5f, (float)fixedError);
+  TEST_ASSERT_LESS_THAN_FLOAT((float)floatError / 5, (float)fixedError);
+}
+
+static void test_error_of_a_low_cutoff_at_a_high_rate()
+{
+  // 2 Hz at 1000 SPS, and 20 Hz with the 50 Hz notch, as on the ADS1220: the float
+  // state loses the small differences of the feedback, the fixed point one does not
+  const float fs = 1000;
+  for (float notch : {0.0f, 50.0f})
+  {
+    float cutoff = notch > 0 ? 20 : 2;
+    Reference reference(cutoff, notch, fs);
+    BiquadBank bank;
+    bank.set_lowpass(FILTER_BUTTERWORTH, 2, cutoff);
+    bank.set_notch(notch);
+    TEST_ASSERT_TRUE(bank.begin(fs));
+
+    double fixedError = 0, floatError = 0;
+    for (int i = 0; i < 200000; i++)
+    {
+      long raw = reading(i, fs);
+      double expected = reference.filter(raw);
+      int32_t q = raw * (1 << Biquad::signalBits);
+      bank.filter_block(&q, 1);
+      float y = bank.filter((float)raw);
+      // the first second is the start from 0
+      if (i < fs)
+        continue;
+      fixedError = fmax(fixedError, fabs(q / (double)(1 << Biquad::signalBits) - expected));
+      floatError = fmax(floatError, fabs(y - expected));
+    }
+    printf("%.0f Hz, notch %.0f Hz at 1000 SPS, max error in counts: fixed point %.3f, float %.3f\n", cutoff, notch,
+           fixedError, floatError);
+    TEST_ASSERT_LESS_THAN_FLOAT(MAX_ERROR, (float)fixedError);
+    TEST_ASSERT_LESS_THAN_FLOAT((float)floatError / 10, (float)fixedError);
+  }
+}
+
+static void test_benchmark()
+{
+  // low pass and calibration per sample: float with a division, as before, and fixed
+  // point with the reciprocal, the arithmetic of LoadCellADC::calibrate()
+  const int n = 1000000;
+  static long raw[1024];
+  static int32_t block[32];
+  for (int i = 0; i < 1024; i++)
+    raw[i] = reading(i, 80);
+  const float scale = 10.7f;
+  const float zero = 4321;
+  const int32_t zeroFixed = lroundf(zero * (1 << Biquad::signalBits));
+  const int bits = 29; // fraction bits of the reciprocal, as update_calibration() picks them
+  const int32_t scaleInv = (int32_t)lround(ldexp(1000.0 / (scale * (1 << Biquad::signalBits)), bits));
+
+  BiquadBank bank;
+  bank.set_lowpass(FILTER_BUTTERWORTH, 2, 2);
+  bank.set_notch(0);
+  bank.begin(80);
+  volatile float sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++)
+    sink = sink + (bank.filter((float)raw[i & 1023]) - zero) / scale;
+  double floatNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+
+  volatile int32_t milli = 0;
+  (void)milli;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i += 32)
+  {
+    for (int k = 0; k < 32; k++)
+      block[k] = raw[(i + k) & 1023] * (1 << Biquad::signalBits);
+    bank.filter_block(block, 32);
+    for (int k = 0; k < 32; k++)
+      milli = (int32_t)((((int64_t)block[k] - zeroFixed) * scaleInv + (1 << (bits - 1))) >> bits);
+  }
+  double fixedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+
+  printf("low pass and calibration per sample: float %.1f ns, fixed point %.1f ns\n", floatNs, fixedNs);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_calibration_to_milli);
+  RUN_TEST(test_error_against_the_float_path);
+  RUN_TEST(test_error_of_a_low_cutoff_at_a_high_rate);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,213 @@
+// Sensor health: the state machine on scripted readings and times, then a simulated
+// HX711 whose DOUT behaves like a healthy, saturated, stuck or unplugged sensor.
+
+#include <unity.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "acquisition.h"
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+#include "loadcell_health.h"
+
+#define DOUT_PIN 4
+#define SCK_PIN 2
+#define INTERVAL_US 12500 // 80 SPS
+#define WAIT_MS 2000      // longest wait for the task
+
+static HX711Sim *chip;
+static HX711 *loadcell;
+static std::atomic<int> faults{0};
+static std::atomic<LoadCellHealth> lastFault{LOADCELL_HEALTH_OK};
+static Acquisition *acquisition;
+
+static void onFault(LoadCellHealth health)
+{
+  lastFault = health;
+  faults++;
+}
+
+// poll until the condition holds, false after WAIT_MS
+template <typename F>
+static bool waitFor(F condition)
+{
+  auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(WAIT_MS);
+  while (!condition())
+  {
+    if (std::chrono::steady_clock::now() > end)
+      return false;
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+void setUp()
+{
+  mock::reset();
+  faults = 0;
+  lastFault = LOADCELL_HEALTH_OK;
+  chip = new HX711Sim(DOUT_PIN, SCK_PIN);
+  loadcell = new HX711();
+  loadcell->begin(DOUT_PIN, SCK_PIN);
+  loadcell->set_rate(HX711_RATE_80SPS);
+  acquisition = new Acquisition();
+}
+
+void tearDown()
+{
+  mock::stop_tasks();
+  delete acquisition;
+  delete loadcell;
+  delete chip;
+}
+
+// one conversion after an interval, read out by try_read()
+static void convertAndRead(long value)
+{
+  mock::advance(INTERVAL_US);
+  chip->convert(value);
+  TEST_ASSERT_TRUE(loadcell->try_read(0));
+}
+
+static void test_monitor_timing()
+{
+  LoadCellHealthMonitor monitor;
+  monitor.begin(10000, 1000000, 50);
+  monitor.reset(0);
+  // no reading yet
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_STALE, monitor.state(0));
+
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, monitor.sample(1, 10000));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, monitor.state(25000));
+  TEST_ASSERT_TRUE(monitor.get_deadline() == 25000);
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_STALE, monitor.state(25001));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_STALE, monitor.state(1010000));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_DISCONNECTED, monitor.state(1010001));
+
+  // the next reading recovers
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, monitor.sample(2, 2000000));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, monitor.state(2000000));
+}
+
+static void test_monitor_saturated_and_stuck()
+{
+  LoadCellHealthMonitor monitor;
+  monitor.begin(10000, 1000000, 5);
+  monitor.reset(0);
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_SATURATED, monitor.sample(0x7FFFFF, 10000));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_SATURATED, monitor.sample(-0x800000, 20000));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, monitor.sample(0x7FFFFE, 30000));
+
+  // the fifth repetition of a reading is STUCK
+  int64_t t = 40000;
+  for (int i = 0; i < 5; i++)
+    TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, monitor.sample(1234, t += 10000));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_STUCK, monitor.sample(1234, t += 10000));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_STUCK, monitor.state(t));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, monitor.sample(1235, t += 10000));
+}
+
+static void test_names()
+{
+  TEST_ASSERT_EQUAL_STRING("OK", LoadCellHealthMonitor::name(LOADCELL_HEALTH_OK));
+  TEST_ASSERT_EQUAL_STRING("STALE", LoadCellHealthMonitor::name(LOADCELL_HEALTH_STALE));
+  TEST_ASSERT_EQUAL_STRING("SATUR.", LoadCellHealthMonitor::name(LOADCELL_HEALTH_SATURATED));
+  TEST_ASSERT_EQUAL_STRING("NO CONN", LoadCellHealthMonitor::name(LOADCELL_HEALTH_DISCONNECTED));
+  TEST_ASSERT_EQUAL_STRING("STUCK", LoadCellHealthMonitor::name(LOADCELL_HEALTH_STUCK));
+}
+
+static void test_healthy_sensor()
+{
+  for (int i = 0; i < 100; i++)
+  {
+    convertAndRead(1000 + (i & 3));
+    TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, loadcell->get_health());
+  }
+  // one reading missing
+  mock::advance(INTERVAL_US + INTERVAL_US / 2 + 1);
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_STALE, loadcell->get_health());
+  chip->convert(1000);
+  TEST_ASSERT_TRUE(loadcell->try_read(0));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, loadcell->get_health());
+}
+
+static void test_saturated_sensor()
+{
+  convertAndRead(500);
+  // an overload clips at the end of the range
+  convertAndRead(0x1000000);
+  TEST_ASSERT_EQUAL_INT32(0x7FFFFF, loadcell->get_raw_reading());
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_SATURATED, loadcell->get_health());
+  convertAndRead(-0x1000000);
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_SATURATED, loadcell->get_health());
+  convertAndRead(500);
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, loadcell->get_health());
+}
+
+static void test_stuck_sensor()
+{
+  // a live ADC never repeats the reading 50 times in a row
+  for (int i = 0; i < 50; i++)
+  {
+    convertAndRead(4711);
+    TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, loadcell->get_health());
+  }
+  convertAndRead(4711);
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_STUCK, loadcell->get_health());
+  convertAndRead(4712);
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_OK, loadcell->get_health());
+}
+
+static void test_unplugged_sensor_does_not_block()
+{
+  convertAndRead(100);
+  // DOUT stays high on the pull-up, try_read() gives up after its timeout
+  int64_t start = mock::now();
+  TEST_ASSERT_FALSE(loadcell->try_read(20));
+  TEST_ASSERT_TRUE(mock::now() - start >= 20000);
+  TEST_ASSERT_TRUE(mock::now() - start < 40000);
+  TEST_ASSERT_FALSE(loadcell->try_read(0));
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_STALE, loadcell->get_health());
+
+  mock::advance(1000000);
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_DISCONNECTED, loadcell->get_health());
+  TEST_ASSERT_EQUAL_UINT32(1, chip->readouts);
+}
+
+static void test_acquisition_reports_a_dead_sensor()
+{
+  acquisition->on_fault(onFault);
+  TEST_ASSERT_TRUE(acquisition->begin(loadcell));
+  TEST_ASSERT_TRUE(waitFor([]() { return mock::hw().irq[DOUT_PIN].handler != nullptr; }));
+
+  for (int i = 0; i < 10; i++)
+  {
+    mock::advance(INTERVAL_US);
+    chip->convert(100 + i);
+  }
+  TEST_ASSERT_TRUE(waitFor([]() { return acquisition->get_health() == LOADCELL_HEALTH_OK; }));
+  TEST_ASSERT_EQUAL_INT(0, faults.load());
+
+  // the next conversion does not come, the task wakes at the deadline by itself
+  mock::advance(INTERVAL_US + INTERVAL_US / 2 + 1);
+  TEST_ASSERT_TRUE(waitFor([]() { return faults.load() > 0; }));
+  TEST_ASSERT_EQUAL_INT(1, faults.load());
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_STALE, lastFault.load());
+  TEST_ASSERT_EQUAL_INT(LOADCELL_HEALTH_STALE, acquisition->get_health());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_monitor_timing);
+  RUN_TEST(test_monitor_saturated_and_stuck);
+  RUN_TEST(test_names);
+  RUN_TEST(test_healthy_sensor);
+  RUN_TEST(test_saturated_sensor);
+  RUN_TEST(test_stuck_sensor);
+  RUN_TEST(test_unplugged_sensor_does_not_block);
+  RUN_TEST(test_acquisition_reports_a_dead_sensor);
+  return UNITY_END();
+}
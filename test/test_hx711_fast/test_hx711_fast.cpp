@@ -0,0 +1,169 @@
+// HX711Fast against the simulated GPIO registers: bit order, sign extension, gain
+// pulses, pulse widths in CPU cycles and the pins of the upper register bank.
+
+#include <unity.h>
+
+#include <stdlib.h>
+
+#include <vector>
+
+#include "hx711_fast.h"
+#include "hx711_sim.h"
+
+// records the PD_SCK edges with the cycle counter
+class EdgeRecorder : public mock::Device
+{
+private:
+  uint8_t sck;
+
+public:
+  std::vector<uint32_t> rising;
+  std::vector<uint32_t> falling;
+  bool unmaskedEdge = false; // an edge outside of the critical section
+
+  EdgeRecorder(uint8_t sckPin) : sck(sckPin) { mock::attach(this); }
+
+  ~EdgeRecorder() { mock::detach(this); }
+
+  void on_write(uint8_t pin, uint8_t level) override
+  {
+    if (pin != sck)
+      return;
+    (level ? rising : falling).push_back(mock::hw().ccount);
+    if (!mock::hw().masked)
+      unmaskedEdge = true;
+  }
+};
+
+void setUp()
+{
+  mock::reset();
+}
+
+void tearDown()
+{
+}
+
+template <uint8_t DOUT_PIN, uint8_t SCK_PIN>
+static void checkValues()
+{
+  HX711Sim chip(DOUT_PIN, SCK_PIN);
+  HX711Fast<DOUT_PIN, SCK_PIN> loadcell;
+  loadcell.begin();
+
+  const long values[] = {0, 1, -1, 2, -2, 0x7FFFFF, -0x800000, 0x800000 - 2, 0x123456, -0x123456, 0x5A5A5A, -0x5A5A5B};
+  for (long value : values)
+  {
+    chip.convert(value);
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+    TEST_ASSERT_EQUAL_INT32(value, loadcell.get_raw_reading());
+  }
+  srand(1);
+  for (int i = 0; i < 1000; i++)
+  {
+    long value = (long)(rand() & 0xFFFFFF) - 0x800000;
+    chip.convert(value);
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+    TEST_ASSERT_EQUAL_INT32(value, loadcell.get_raw_reading());
+  }
+}
+
+static void test_bit_order_and_sign_extension()
+{
+  checkValues<4, 2>();
+}
+
+static void test_upper_register_bank()
+{
+  // DOUT and PD_SCK in GPIO.in1 and GPIO.out1_w1ts/out1_w1tc
+  checkValues<35, 33>();
+}
+
+static void test_same_result_as_digital_io()
+{
+  HX711Sim chip(4, 2);
+  HX711 slow;
+  slow.begin(4, 2);
+  HX711Fast<4, 2> fast;
+  fast.begin();
+
+  srand(2);
+  for (int i = 0; i < 200; i++)
+  {
+    long value = (long)(rand() & 0xFFFFFF) - 0x800000;
+    chip.convert(value);
+    TEST_ASSERT_TRUE(slow.try_read(0));
+    chip.convert(value);
+    TEST_ASSERT_TRUE(fast.try_read(0));
+    TEST_ASSERT_EQUAL_INT32(slow.get_raw_reading(), fast.get_raw_reading());
+  }
+}
+
+static void test_gain_pulses()
+{
+  HX711Sim chip(4, 2);
+  HX711Fast<4, 2> loadcell;
+  loadcell.begin(128);
+
+  const uint8_t gains[] = {128, 32, 64};
+  const uint8_t pulses[] = {1, 2, 3};
+  for (int i = 0; i < 3; i++)
+  {
+    loadcell.set_gain(gains[i]);
+    chip.convert(1000);
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+    TEST_ASSERT_EQUAL_UINT8(pulses[i], chip.get_gain_pulses());
+    TEST_ASSERT_EQUAL_UINT32(i + 1, chip.readouts);
+  }
+}
+
+static void test_pulse_width()
+{
+  HX711Sim chip(4, 2);
+  EdgeRecorder edges(2);
+  HX711Fast<4, 2> loadcell;
+  loadcell.begin(64);
+
+  chip.convert(-12345);
+  TEST_ASSERT_TRUE(loadcell.try_read(0));
+  TEST_ASSERT_EQUAL_UINT32(27, edges.rising.size());
+  TEST_ASSERT_EQUAL_UINT32(27, edges.falling.size());
+
+  // HX711_FAST_PULSE_NS at 240 MHz
+  const uint32_t minCycles = (HX711_FAST_PULSE_NS * 240 + 999) / 1000;
+  for (size_t i = 0; i < edges.rising.size(); i++)
+  {
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(minCycles, edges.falling[i] - edges.rising[i]);
+    if (i + 1 < edges.rising.size())
+      TEST_ASSERT_GREATER_OR_EQUAL_UINT32(minCycles, edges.rising[i + 1] - edges.falling[i]);
+  }
+  // the whole readout runs in the critical section
+  TEST_ASSERT_FALSE(edges.unmaskedEdge);
+}
+
+static void test_pulse_width_follows_cpu_clock()
+{
+  mock::hw().cpuMhz = 80;
+  HX711Sim chip(4, 2);
+  EdgeRecorder edges(2);
+  HX711Fast<4, 2> loadcell;
+  loadcell.begin();
+
+  chip.convert(1);
+  TEST_ASSERT_TRUE(loadcell.try_read(0));
+  const uint32_t minCycles = (HX711_FAST_PULSE_NS * 80 + 999) / 1000;
+  for (size_t i = 0; i < edges.rising.size(); i++)
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(minCycles, edges.falling[i] - edges.rising[i]);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_bit_order_and_sign_extension);
+  RUN_TEST(test_upper_register_bank);
+  RUN_TEST(test_same_result_as_digital_io);
+  RUN_TEST(test_gain_pulses);
+  RUN_TEST(test_pulse_width);
+  RUN_TEST(test_pulse_width_follows_cpu_clock);
+  return UNITY_END();
+}
@@ -0,0 +1,151 @@
+// HX711Multi with 1..8 simulated HX711 on a shared PD_SCK pin: every channel has to be
+// decoded bit-exact from the input register words of the common readout.
+
+#include <unity.h>
+
+#include <stdlib.h>
+
+#include "hx711_multi.h"
+#include "hx711_sim.h"
+
+#define SCK_PIN 2
+
+static const byte doutPins[HX711Multi::maxChannels] = {4, 5, 12, 13, 14, 15, 16, 17};
+
+void setUp()
+{
+  mock::reset();
+}
+
+void tearDown()
+{
+}
+
+static long randomReading()
+{
+  return (long)(rand() & 0xFFFFFF) - 0x800000;
+}
+
+static void test_begin_checks_the_pins()
+{
+  HX711Multi multi;
+  const byte upper[] = {4, 34};
+  TEST_ASSERT_FALSE(multi.begin(doutPins, 0, SCK_PIN));
+  TEST_ASSERT_FALSE(multi.begin(doutPins, HX711Multi::maxChannels + 1, SCK_PIN));
+  TEST_ASSERT_FALSE(multi.begin(upper, 2, SCK_PIN));
+  TEST_ASSERT_FALSE(multi.begin(doutPins, 2, 34));
+  TEST_ASSERT_TRUE(multi.begin(doutPins, 2, SCK_PIN));
+  TEST_ASSERT_EQUAL_UINT8(2, multi.get_channel_count());
+}
+
+static void test_deinterleave()
+{
+  // channel 0 on bit 0 all ones, channel 1 on bit 31 alternating from the MSB
+  uint32_t words[24];
+  for (int i = 0; i < 24; i++)
+    words[i] = 1UL | ((i & 1) ? 0 : 1UL << 31);
+  const byte dout[] = {0, 31};
+  long values[2];
+  HX711Multi::deinterleave(words, dout, 2, values);
+  TEST_ASSERT_EQUAL_INT32(-1, values[0]);
+  TEST_ASSERT_EQUAL_INT32(-0x555556, values[1]); // 0xAAAAAA
+}
+
+static void test_bit_exact_for_1_to_8_channels()
+{
+  srand(4);
+  for (byte count = 1; count <= HX711Multi::maxChannels; count++)
+  {
+    mock::reset();
+    HX711Sim *chips[HX711Multi::maxChannels];
+    for (byte c = 0; c < count; c++)
+      chips[c] = new HX711Sim(doutPins[c], SCK_PIN);
+    HX711Multi multi;
+    TEST_ASSERT_TRUE(multi.begin(doutPins, count, SCK_PIN));
+
+    for (int round = 0; round < 200; round++)
+    {
+      long expected[HX711Multi::maxChannels];
+      for (byte c = 0; c < count; c++)
+      {
+        // the extremes first, then random readings
+        if (round == 0)
+          expected[c] = (c & 1) ? -0x800000 : 0x7FFFFF;
+        else if (round == 1)
+          expected[c] = (c & 1) ? -1 : 1;
+        else
+          expected[c] = randomReading();
+        chips[c]->convert(expected[c]);
+      }
+      TEST_ASSERT_TRUE(multi.is_ready());
+      long values[HX711Multi::maxChannels];
+      TEST_ASSERT_TRUE(multi.try_read(values));
+      for (byte c = 0; c < count; c++)
+      {
+        TEST_ASSERT_EQUAL_INT32(expected[c], values[c]);
+        TEST_ASSERT_EQUAL_INT32(expected[c], multi.get_raw_reading(c));
+      }
+    }
+    // one readout of all chips per round
+    for (byte c = 0; c < count; c++)
+    {
+      TEST_ASSERT_EQUAL_UINT32(200, chips[c]->readouts);
+      delete chips[c];
+    }
+  }
+}
+
+static void test_gain_pulses_reach_all_chips()
+{
+  HX711Sim a(doutPins[0], SCK_PIN);
+  HX711Sim b(doutPins[1], SCK_PIN);
+  HX711Multi multi;
+  multi.begin(doutPins, 2, SCK_PIN, 64);
+
+  const byte gains[] = {64, 32, 128};
+  const uint8_t pulses[] = {3, 2, 1};
+  for (int i = 0; i < 3; i++)
+  {
+    multi.set_gain(gains[i]);
+    a.convert(i);
+    b.convert(-i);
+    long values[2];
+    TEST_ASSERT_TRUE(multi.try_read(values));
+    TEST_ASSERT_EQUAL_UINT8(pulses[i], a.get_gain_pulses());
+    TEST_ASSERT_EQUAL_UINT8(pulses[i], b.get_gain_pulses());
+  }
+}
+
+static void test_waits_for_the_slowest_chip()
+{
+  HX711Sim a(doutPins[0], SCK_PIN);
+  HX711Sim b(doutPins[1], SCK_PIN);
+  HX711Multi multi;
+  multi.begin(doutPins, 2, SCK_PIN);
+
+  a.convert(11);
+  long values[2];
+  TEST_ASSERT_FALSE(multi.is_ready());
+  int64_t start = mock::now();
+  TEST_ASSERT_FALSE(multi.try_read(values, 5));
+  TEST_ASSERT_TRUE(mock::now() - start >= 5000);
+  // nothing was clocked out
+  TEST_ASSERT_EQUAL_UINT32(0, a.risingEdges);
+  TEST_ASSERT_TRUE(a.is_ready());
+
+  b.convert(22);
+  TEST_ASSERT_TRUE(multi.try_read(values, 5));
+  TEST_ASSERT_EQUAL_INT32(11, values[0]);
+  TEST_ASSERT_EQUAL_INT32(22, values[1]);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_checks_the_pins);
+  RUN_TEST(test_deinterleave);
+  RUN_TEST(test_bit_exact_for_1_to_8_channels);
+  RUN_TEST(test_gain_pulses_reach_all_chips);
+  RUN_TEST(test_waits_for_the_slowest_chip);
+  return UNITY_END();
+}
@@ -0,0 +1,150 @@
+// HX711Spi: the conversion of the received bytes into readings and the SPI readout of a
+// simulated HX711, with the gain clocks, the deferred readout of the capture and the
+// power down that takes PD_SCK away from the peripheral.
+
+#include <unity.h>
+
+#include <stdlib.h>
+
+#include "hx711_sim.h"
+#include "hx711_spi.h"
+#include "soc/gpio_sig_map.h"
+
+#define DOUT_PIN 19
+#define SCK_PIN 18
+
+static HX711Sim *chip;
+static HX711Spi *loadcell;
+
+void setUp()
+{
+  mock::reset();
+  mock::reset_spi();
+  chip = new HX711Sim(DOUT_PIN, SCK_PIN);
+  loadcell = new HX711Spi();
+  TEST_ASSERT_TRUE(loadcell->begin(DOUT_PIN, SCK_PIN));
+}
+
+void tearDown()
+{
+  loadcell->end_capture();
+  delete loadcell;
+  delete chip;
+}
+
+static void test_word_to_sample()
+{
+  struct
+  {
+    uint8_t data[4];
+    long value;
+  } words[] = {
+      {{0x00, 0x00, 0x00, 0x00}, 0},
+      {{0x00, 0x00, 0x01, 0x00}, 1},
+      {{0xFF, 0xFF, 0xFF, 0x00}, -1},
+      {{0x7F, 0xFF, 0xFF, 0x00}, 0x7FFFFF},
+      {{0x80, 0x00, 0x00, 0x00}, -0x800000},
+      {{0x12, 0x34, 0x56, 0x00}, 0x123456},
+      {{0xED, 0xCB, 0xAA, 0x00}, -0x123456},
+      // the gain clocks in the fourth byte are ignored
+      {{0x00, 0x00, 0x01, 0xE0}, 1},
+      {{0x80, 0x00, 0x00, 0x80}, -0x800000},
+  };
+  for (auto &w : words)
+    TEST_ASSERT_EQUAL_INT32(w.value, LoadCellADC::word_to_sample(w.data));
+}
+
+static void test_word_to_sample_round_trip()
+{
+  srand(5);
+  for (int i = 0; i < 10000; i++)
+  {
+    long value = (long)(rand() & 0xFFFFFF) - 0x800000;
+    uint32_t word = (uint32_t)value & 0xFFFFFF;
+    uint8_t data[4] = {(uint8_t)(word >> 16), (uint8_t)(word >> 8), (uint8_t)word, (uint8_t)rand()};
+    TEST_ASSERT_EQUAL_INT32(value, LoadCellADC::word_to_sample(data));
+  }
+}
+
+static void test_spi_readout()
+{
+  const long values[] = {0, 1, -1, 0x7FFFFF, -0x800000, 0x2AAAAA, -0x2AAAAB, 42424};
+  for (long value : values)
+  {
+    chip->convert(value);
+    TEST_ASSERT_TRUE(loadcell->try_read(0));
+    TEST_ASSERT_EQUAL_INT32(value, loadcell->get_raw_reading());
+    TEST_ASSERT_FALSE(chip->is_ready());
+  }
+  TEST_ASSERT_EQUAL_UINT32(8, chip->readouts);
+  // never inside a critical section
+  TEST_ASSERT_FALSE(mock::hw().masked);
+}
+
+static void test_gain_clocks()
+{
+  const uint8_t gains[] = {128, 32, 64};
+  const uint8_t pulses[] = {1, 2, 3};
+  for (int i = 0; i < 3; i++)
+  {
+    loadcell->set_gain(gains[i]);
+    uint32_t edges = chip->risingEdges;
+    chip->convert(-1000);
+    TEST_ASSERT_TRUE(loadcell->try_read(0));
+    TEST_ASSERT_EQUAL_INT32(-1000, loadcell->get_raw_reading());
+    // one transaction of 25, 26 or 27 clocks
+    TEST_ASSERT_EQUAL_UINT32(24 + pulses[i], chip->risingEdges - edges);
+    TEST_ASSERT_EQUAL_UINT8(pulses[i], chip->get_gain_pulses());
+  }
+}
+
+static void test_capture_defers_the_readout_to_poll()
+{
+  loadcell->begin_capture();
+  mock::set_time(3000000);
+  chip->convert(-777);
+  // the interrupt only flagged the conversion
+  TEST_ASSERT_TRUE(chip->is_ready());
+  TEST_ASSERT_EQUAL_UINT32(0, chip->risingEdges);
+
+  LoadCellBlock block;
+  mock::set_time(3000500);
+  TEST_ASSERT_EQUAL_UINT32(1, loadcell->poll_block(block));
+  TEST_ASSERT_EQUAL_INT32(-777, block.raw[0]);
+  TEST_ASSERT_TRUE(block.timestamp[0] == 3000000);
+  TEST_ASSERT_FALSE(chip->is_ready());
+
+  // the interrupt is enabled again for the next conversion
+  chip->convert(778);
+  TEST_ASSERT_EQUAL_UINT32(1, loadcell->poll_block(block));
+  TEST_ASSERT_EQUAL_INT32(778, block.raw[0]);
+  TEST_ASSERT_EQUAL_UINT32(0, loadcell->poll_block(block));
+}
+
+static void test_power_down_and_up()
+{
+  loadcell->power_down();
+  mock::advance(100);
+  TEST_ASSERT_TRUE(chip->is_powered_down());
+  // the peripheral no longer drives PD_SCK
+  TEST_ASSERT_EQUAL_UINT32(SIG_GPIO_OUT_IDX, mock::out_signals()[SCK_PIN]);
+
+  loadcell->power_up();
+  TEST_ASSERT_FALSE(chip->is_powered_down());
+  TEST_ASSERT_EQUAL_UINT32(spi_periph_signal[SPI3_HOST].spiclk_out, mock::out_signals()[SCK_PIN]);
+  chip->convert(5);
+  TEST_ASSERT_TRUE(loadcell->try_read(0));
+  TEST_ASSERT_EQUAL_INT32(5, loadcell->get_raw_reading());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_word_to_sample);
+  RUN_TEST(test_word_to_sample_round_trip);
+  RUN_TEST(test_spi_readout);
+  RUN_TEST(test_gain_clocks);
+  RUN_TEST(test_capture_defers_the_readout_to_poll);
+  RUN_TEST(test_power_down_and_up);
+  return UNITY_END();
+}
@@ -0,0 +1,208 @@
+// KalmanCV: the start from the first two measurements, replays of simulated loading
+// against the true force and rate, the consistency of the reported variances, irregular
+// intervals and the estimate behind the LoadCellADC interface.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+#include "kalman_cv.h"
+
+#define FS 80.0f
+
+// normally distributed noise with the standard deviation sigma (Box-Muller)
+static float gauss(float sigma)
+{
+  float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+  float u2 = (float)rand() / RAND_MAX;
+  return sigma * sqrtf(-2 * logf(u1)) * cosf(2 * (float)M_PI * u2);
+}
+
+void setUp()
+{
+  mock::reset();
+}
+
+void tearDown()
+{
+}
+
+static void test_start_from_two_measurements()
+{
+  KalmanCV kalman;
+  kalman.begin(10, 0.5f);
+  kalman.update(100, 0);
+  TEST_ASSERT_EQUAL_FLOAT(100, kalman.get_value());
+  TEST_ASSERT_EQUAL_FLOAT(0, kalman.get_rate());
+  TEST_ASSERT_EQUAL_FLOAT(0.25f, kalman.get_value_variance());
+
+  // the rate from two points, with the variance of a difference
+  kalman.update(101, 0.1f);
+  TEST_ASSERT_EQUAL_FLOAT(101, kalman.get_value());
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 10, kalman.get_rate());
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2 * 0.25f / 0.01f, kalman.get_rate_variance());
+
+  // dt = 0 starts over, as does reset()
+  kalman.update(50, 0);
+  TEST_ASSERT_EQUAL_FLOAT(50, kalman.get_value());
+  kalman.reset();
+  kalman.update(7, 0.1f);
+  TEST_ASSERT_EQUAL_FLOAT(7, kalman.get_value());
+  TEST_ASSERT_EQUAL_FLOAT(0, kalman.get_rate());
+}
+
+static void test_noise_free_ramp()
+{
+  // a constant rate is followed exactly, whatever the noise parameters
+  KalmanCV kalman;
+  kalman.begin(500, 2);
+  for (int n = 0; n < 400; n++)
+    kalman.update(3 + 50 * n / FS, 1 / FS);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 3 + 50 * 399 / FS, kalman.get_value());
+  TEST_ASSERT_FLOAT_WITHIN(1e-2f, 50, kalman.get_rate());
+}
+
+static void test_variances_are_consistent()
+{
+  // Replay the model itself: the rate is a random walk with the spectral density
+  // accelNoise^2. The squared errors normalized by the reported variances average 1.
+  const float accelNoise = 50;
+  const float measurementNoise = 0.5f;
+  const float dt = 1 / FS;
+  const float q = accelNoise * accelNoise;
+  // Cholesky factor of the discrete process noise q [dt^3/3 dt^2/2; dt^2/2 dt]
+  float l00 = sqrtf(q * dt * dt * dt / 3);
+  float l10 = q * dt * dt / 2 / l00;
+  float l11 = sqrtf(q * dt - l10 * l10);
+
+  srand(6);
+  double valueNees = 0, rateNees = 0;
+  int count = 0;
+  for (int run = 0; run < 20; run++)
+  {
+    KalmanCV kalman;
+    kalman.begin(accelNoise, measurementNoise);
+    float force = 0, rate = 20;
+    for (int n = 0; n < 2000; n++)
+    {
+      float w0 = gauss(1), w1 = gauss(1);
+      force += dt * rate + l00 * w0;
+      rate += l10 * w0 + l11 * w1;
+      kalman.update(force + gauss(measurementNoise), dt);
+      if (n < 200)
+        continue; // the start is not in the steady state
+      float e0 = kalman.get_value() - force;
+      float e1 = kalman.get_rate() - rate;
+      valueNees += e0 * e0 / kalman.get_value_variance();
+      rateNees += e1 * e1 / kalman.get_rate_variance();
+      count++;
+    }
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 1, valueNees / count);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 1, rateNees / count);
+}
+
+static void test_irregular_intervals()
+{
+  KalmanCV kalman;
+  kalman.begin(20, 0.1f);
+  srand(7);
+  // the intervals scatter by +-30 %, the ramp is still followed
+  float t = 0;
+  for (int n = 0; n < 400; n++)
+  {
+    float dt = (0.7f + 0.6f * rand() / RAND_MAX) / FS;
+    t += dt;
+    kalman.update(10 * t + gauss(0.1f), dt);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 10 * t, kalman.get_value());
+  TEST_ASSERT_FLOAT_WITHIN(3 * sqrtf(kalman.get_rate_variance()), 10, kalman.get_rate());
+
+  // a gap of 1 s widens the uncertainty; the prediction carries the value along the rate
+  float rateVariance = kalman.get_rate_variance();
+  kalman.update(10 * (t + 1), 1);
+  TEST_ASSERT_GREATER_THAN_FLOAT(rateVariance, kalman.get_rate_variance());
+  TEST_ASSERT_FLOAT_WITHIN(0.2f, 10 * (t + 1), kalman.get_value());
+  TEST_ASSERT_FLOAT_WITHIN(1, 10, kalman.get_rate());
+}
+
+static void test_accel_noise_trades_lag_for_noise()
+{
+  // a step of the rate from 0 to 100 per s: a larger accelNoise follows it sooner, with
+  // a larger variance of the rate
+  float settle[2], variance[2];
+  const float accelNoise[] = {20, 500};
+  for (int k = 0; k < 2; k++)
+  {
+    KalmanCV kalman;
+    kalman.begin(accelNoise[k], 1);
+    float force = 0;
+    settle[k] = 0;
+    for (int n = 0; n < 800; n++)
+    {
+      if (n >= 400)
+        force += 100 / FS;
+      kalman.update(force, 1 / FS);
+      if (n >= 400 && settle[k] == 0 && kalman.get_rate() > 90)
+        settle[k] = (n - 400) / FS;
+    }
+    variance[k] = kalman.get_rate_variance();
+  }
+  TEST_ASSERT_GREATER_THAN_FLOAT(0, settle[1]);
+  TEST_ASSERT_LESS_THAN_FLOAT(settle[0] / 2, settle[1]);
+  TEST_ASSERT_GREATER_THAN_FLOAT(variance[0], variance[1]);
+}
+
+static void test_replay_through_the_loadcell()
+{
+  // 80 SPS with 2 N of noise per reading, a 4 s ramp at 50 N/s, then the rope breaks
+  HX711Sim chip(4, 2);
+  HX711 loadcell;
+  loadcell.begin(4, 2);
+  loadcell.set_rate(HX711_RATE_80SPS);
+  loadcell.set_scale(1000); // counts per N
+  loadcell.set_kalman_noise(500, 2);
+  srand(8);
+  float force = 0;
+  for (int n = 0; n < 320; n++)
+  {
+    force = 50 * n / FS;
+    mock::advance(12500);
+    chip.convert(lroundf(1000 * (force + gauss(2))));
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+  }
+  // the rate within its 3 sigma, the Kalman force without the lag of the low pass
+  float sigma = sqrtf(loadcell.get_force_rate_variance());
+  TEST_ASSERT_FLOAT_WITHIN(3 * sigma, 50, loadcell.get_force_rate());
+  TEST_ASSERT_FLOAT_WITHIN(3 * sqrtf(loadcell.get_kalman_force_variance()), force, loadcell.get_kalman_force());
+  TEST_ASSERT_LESS_THAN_FLOAT(force - 2, loadcell.get_cal_force());
+
+  // the drop shows as a negative rate with 3 sigma certainty within a few readings,
+  // long before the filtered force stays low for the usual 400 ms
+  int n = 0;
+  float rate = 0;
+  do
+  {
+    mock::advance(12500);
+    chip.convert(lroundf(1000 * gauss(2)));
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+    rate = loadcell.get_force_rate();
+    n++;
+  } while (!(rate < -200 && rate * rate > 9 * loadcell.get_force_rate_variance()) && n < 80);
+  TEST_ASSERT_LESS_OR_EQUAL(4, n);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_start_from_two_measurements);
+  RUN_TEST(test_noise_free_ramp);
+  RUN_TEST(test_variances_are_consistent);
+  RUN_TEST(test_irregular_intervals);
+  RUN_TEST(test_accel_noise_trades_lag_for_noise);
+  RUN_TEST(test_replay_through_the_loadcell);
+  return UNITY_END();
+}
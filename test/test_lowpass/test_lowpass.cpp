@@ -0,0 +1,222 @@
+// The 2nd order Butterworth low pass of the readings against the former LowPassFilter,
+// which recomputed its coefficients from micros() for every sample: frequency response,
+// the readings across the 32-bit wrap of micros() and a benchmark of the hot path.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
+
+#include "biquad.h"
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+
+#define FS 80.0f    // HX711 at 80 SPS
+#define CUTOFF 2.0f // default of all profiles
+
+// The former LowPassFilter of order 2 with the sample interval passed in: bilinear
+// transform of the analog Butterworth prototype without prewarping, the coefficients
+// recomputed for every sample.
+class ReferenceLowPass
+{
+private:
+  float a[2];
+  float b[3];
+  float omega0;
+  float x[3] = {};
+  float y[3] = {};
+
+  void setCoef(float dt)
+  {
+    float alpha = omega0 * dt;
+    float alphaSq = alpha * alpha;
+    float beta[] = {1, sqrtf(2), 1};
+    float D = alphaSq * beta[0] + 2 * alpha * beta[1] + 4 * beta[2];
+    b[0] = alphaSq / D;
+    b[1] = 2 * b[0];
+    b[2] = b[0];
+    a[0] = -(2 * alphaSq * beta[0] - 8 * beta[2]) / D;
+    a[1] = -(beta[0] * alphaSq - 2 * beta[1] * alpha + 4 * beta[2]) / D;
+  }
+
+public:
+  ReferenceLowPass(float f0) : omega0(2 * (float)M_PI * f0) {}
+
+  float filter(float xn, float dt)
+  {
+    setCoef(dt);
+    y[0] = 0;
+    x[0] = xn;
+    for (int k = 0; k < 2; k++)
+      y[0] += a[k] * y[k + 1] + b[k] * x[k];
+    y[0] += b[2] * x[2];
+    for (int k = 2; k > 0; k--)
+    {
+      y[k] = y[k - 1];
+      x[k] = x[k - 1];
+    }
+    return y[0];
+  }
+};
+
+// steady-state amplitude of a unit sine at f through a filter
+template <typename F>
+static float amplitude(F filter, float f)
+{
+  // let the transient decay for 10 s, then measure over at least 10 s and 5 periods
+  int settle = (int)(10 * FS);
+  int measure = (int)(fmaxf(10, 5 / f) * FS);
+  float peak = 0;
+  for (int n = 0; n < settle + measure; n++)
+  {
+    float y = filter(sinf(2 * (float)M_PI * f * n / FS));
+    if (n >= settle && fabsf(y) > peak)
+      peak = fabsf(y);
+  }
+  return peak;
+}
+
+static float biquadAmplitude(float f)
+{
+  BiquadBank bank;
+  bank.set_lowpass(FILTER_BUTTERWORTH, 2, CUTOFF);
+  bank.begin(FS);
+  return amplitude([&bank](float x) { return bank.filter(x); }, f);
+}
+
+static float referenceAmplitude(float f)
+{
+  ReferenceLowPass reference(CUTOFF);
+  return amplitude([&reference](float x) { return reference.filter(x, 1 / FS); }, f);
+}
+
+// Butterworth magnitude with the bilinear frequency warping, exact cutoff at CUTOFF
+static float expectedAmplitude(float f)
+{
+  float r = tanf((float)M_PI * f / FS) / tanf((float)M_PI * CUTOFF / FS);
+  return 1 / sqrtf(1 + r * r * r * r);
+}
+
+void setUp()
+{
+  mock::reset();
+}
+
+void tearDown()
+{
+}
+
+static void test_response_against_the_former_filter()
+{
+  const float freqs[] = {0.05f, 0.2f, 0.5f, 1, 1.5f, 2, 3, 5, 10, 20, 30};
+  float last = 2;
+  for (float f : freqs)
+  {
+    float biquad = biquadAmplitude(f);
+    float reference = referenceAmplitude(f);
+    // the sampled sine misses the peak by up to a few samples' worth of phase
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, expectedAmplitude(f), biquad);
+    // same pass band; the prewarped cutoff sits slightly above the former one
+    if (f <= 1)
+      TEST_ASSERT_FLOAT_WITHIN(0.01f, reference, biquad);
+    else
+      TEST_ASSERT_GREATER_OR_EQUAL_FLOAT(reference - 0.005f, biquad);
+    // monotonic, no ripple
+    TEST_ASSERT_LESS_THAN_FLOAT(last, biquad);
+    last = biquad;
+  }
+  // -3 dB at the cutoff, at least -40 dB per decade above it
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 1 / sqrtf(2), biquadAmplitude(CUTOFF));
+  TEST_ASSERT_LESS_THAN_FLOAT(1 / 25.0f, biquadAmplitude(5 * CUTOFF));
+}
+
+static void test_fixed_point_follows_the_float_response()
+{
+  BiquadBank bank;
+  bank.set_lowpass(FILTER_BUTTERWORTH, 2, CUTOFF);
+  bank.begin(FS);
+  BiquadBank fixedBank = bank;
+  fixedBank.reset_fixed();
+  const float scale = 10000 * (1 << Biquad::signalBits); // 10000 counts
+  for (int n = 0; n < 2000; n++)
+  {
+    float x = sinf(2 * (float)M_PI * 1.3f * n / FS) + 0.3f * sinf(2 * (float)M_PI * 7 * n / FS);
+    float y = bank.filter(x);
+    int32_t q = (int32_t)lroundf(x * scale);
+    fixedBank.filter_block(&q, 1);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, y, q / scale);
+  }
+}
+
+static void test_readings_across_the_micros_wrap()
+{
+  // micros() wraps after 2^32 us, about 71 minutes; the timestamps are 64-bit
+  mock::set_time((1LL << 32) - 2000000);
+  HX711Sim chip(4, 2);
+  HX711 loadcell;
+  loadcell.begin(4, 2);
+  loadcell.set_rate(HX711_RATE_80SPS);
+  for (int i = 0; i < 400; i++)
+  {
+    mock::advance(12500);
+    chip.convert(8000);
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+  }
+  TEST_ASSERT_TRUE(mock::now() > (1LL << 32));
+  // the interval also holds the simulated readout of the previous conversion
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 80, loadcell.get_sample_rate());
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 8000, loadcell.get_last_reading());
+}
+
+static void test_benchmark()
+{
+  const int n = 1000000;
+  static float x[1024];
+  static int32_t q[1024];
+  for (int i = 0; i < 1024; i++)
+  {
+    x[i] = 1000 * sinf(i * 0.1f) + (i % 7);
+    q[i] = (int32_t)x[i] * (1 << Biquad::signalBits);
+  }
+
+  ReferenceLowPass reference(CUTOFF);
+  volatile float sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++)
+    sink = sink + reference.filter(x[i & 1023], 1 / FS);
+  double referenceNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+
+  BiquadBank bank;
+  bank.set_lowpass(FILTER_BUTTERWORTH, 2, CUTOFF);
+  bank.begin(FS);
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i++)
+    sink = sink + bank.filter(x[i & 1023]);
+  double floatNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+
+  static int32_t block[32];
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; i += 32)
+  {
+    for (int k = 0; k < 32; k++)
+      block[k] = q[(i + k) & 1023];
+    bank.filter_block(block, 32);
+    sink = sink + block[31];
+  }
+  double fixedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+
+  printf("low pass per sample: former %.1f ns, biquad float %.1f ns, fixed point block %.1f ns\n", referenceNs,
+         floatNs, fixedNs);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_response_against_the_former_filter);
+  RUN_TEST(test_fixed_point_follows_the_float_response);
+  RUN_TEST(test_readings_across_the_micros_wrap);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
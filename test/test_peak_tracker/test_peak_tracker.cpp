@@ -0,0 +1,154 @@
+// PeakTracker: replays of synthetic loading with a known peak through the HX711, its
+// low pass and the Kalman rate, as the acquisition task feeds it. The filtered maximum
+// misses the peak of a ramp by the lag of the filter, the compensated one does not.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+#include "peak_tracker.h"
+
+#define FS 80.0f
+
+static float noiseN;     // noise of a reading in N
+static float accelNoise; // Kalman tuning, see LoadCellADC::set_kalman_noise()
+
+// normally distributed noise with the standard deviation sigma (Box-Muller)
+static float gauss(float sigma)
+{
+  float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+  float u2 = (float)rand() / RAND_MAX;
+  return sigma * sqrtf(-2 * logf(u1)) * cosf(2 * (float)M_PI * u2);
+}
+
+// Replay the force profile f(t) in N for the given time and feed the tracker with the
+// filtered and the unfiltered force and the Kalman rate, as the acquisition task does.
+template <typename F>
+static void replay(PeakTracker &peak, F force, float seconds)
+{
+  mock::reset();
+  HX711Sim chip(4, 2);
+  HX711 loadcell;
+  loadcell.begin(4, 2);
+  loadcell.set_rate(HX711_RATE_80SPS);
+  loadcell.set_scale(1000); // counts per N
+  loadcell.set_kalman_noise(accelNoise, noiseN > 0 ? noiseN : 0.1f);
+  peak.set_delay(loadcell.get_filter_delay());
+  peak.reset();
+  for (int n = 0; n < seconds * FS; n++)
+  {
+    mock::advance(12500);
+    chip.convert(lroundf(1000 * (force(n / FS) + gauss(noiseN))));
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+    float unfiltered = loadcell.get_raw_reading() / 1000.0f;
+    peak.update(loadcell.get_cal_force(), unfiltered, loadcell.get_force_rate(), loadcell.get_force_rate_variance());
+  }
+}
+
+void setUp()
+{
+  srand(14);
+  noiseN = 0;
+  accelNoise = 20;
+}
+
+void tearDown()
+{
+}
+
+static void test_update()
+{
+  PeakTracker peak;
+  peak.set_delay(0.1f);
+  TEST_ASSERT_EQUAL_FLOAT(0.1f, peak.get_delay());
+  peak.reset(5);
+  TEST_ASSERT_EQUAL_FLOAT(5, peak.get_filtered_max());
+  TEST_ASSERT_EQUAL_FLOAT(5, peak.get_compensated_max());
+
+  // the lag is added for a significant rising slope only, up to the unfiltered value
+  peak.update(10, 20, 50, 1);
+  TEST_ASSERT_EQUAL_FLOAT(10, peak.get_filtered_max());
+  TEST_ASSERT_EQUAL_FLOAT(15, peak.get_compensated_max());
+  peak.update(11, 20, 50, 300); // 3 sigma = 52
+  TEST_ASSERT_EQUAL_FLOAT(11, peak.get_filtered_max());
+  TEST_ASSERT_EQUAL_FLOAT(15, peak.get_compensated_max());
+  peak.update(12, 16, 50, 1);
+  TEST_ASSERT_EQUAL_FLOAT(16, peak.get_compensated_max());
+  peak.update(20, 0, -100, 1);
+  TEST_ASSERT_EQUAL_FLOAT(20, peak.get_filtered_max());
+  TEST_ASSERT_EQUAL_FLOAT(20, peak.get_compensated_max());
+  // never below the filtered value
+  peak.update(30, 0, 1000, 1);
+  TEST_ASSERT_EQUAL_FLOAT(30, peak.get_compensated_max());
+}
+
+static void test_ramps_with_a_break()
+{
+  // ramps to 100 N at different rates, then the rope breaks
+  for (float slope : {20.0f, 50.0f, 200.0f})
+  {
+    for (float noise : {0.0f, 0.5f, 2.0f})
+    {
+      noiseN = noise;
+      float rise = 100 / slope;
+      PeakTracker peak;
+      replay(peak, [rise](float t) { return t < rise ? 100 * t / rise : 0; }, rise + 1);
+      float lag = slope * peak.get_delay();
+      // the last reading before the break is up to one sample interval short of the peak
+      float step = slope / FS;
+      // the filtered maximum lags by the slope times the group delay
+      TEST_ASSERT_FLOAT_WITHIN(0.1f * lag + step + noise, 100 - lag, peak.get_filtered_max());
+      // the compensated one reaches the peak
+      TEST_ASSERT_FLOAT_WITHIN(1 + step + noise, 100, peak.get_compensated_max());
+    }
+  }
+}
+
+static void test_no_overshoot_after_the_break()
+{
+  // With a large accelNoise the rate estimate rings after the drop and turns positive
+  // while the filtered force is still high; the compensated maximum stays below the peak.
+  accelNoise = 500;
+  for (float slope : {5.0f, 20.0f, 50.0f, 200.0f})
+  {
+    float rise = 100 / slope;
+    PeakTracker peak;
+    replay(peak, [rise](float t) { return t < rise ? 100 * t / rise : 0; }, rise + 1);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(100, peak.get_compensated_max());
+    TEST_ASSERT_GREATER_OR_EQUAL_FLOAT(peak.get_filtered_max(), peak.get_compensated_max());
+  }
+}
+
+static void test_static_load()
+{
+  // a noisy static load: the slope is never significant for long, nothing is added
+  noiseN = 2;
+  PeakTracker peak;
+  replay(peak, [](float) { return 50.0f; }, 20);
+  TEST_ASSERT_FLOAT_WITHIN(4, 52, peak.get_filtered_max());
+  TEST_ASSERT_LESS_THAN_FLOAT(peak.get_filtered_max() + 1, peak.get_compensated_max());
+}
+
+static void test_smooth_peak()
+{
+  // a load that rounds off slowly (half a sine of 4 s): the slope goes to 0 at the peak,
+  // so the compensation does not push the maximum above the true one
+  PeakTracker peak;
+  replay(peak, [](float t) { return 100 * sinf((float)M_PI * t / 4); }, 4);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 100, peak.get_filtered_max());
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 100, peak.get_compensated_max());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_update);
+  RUN_TEST(test_ramps_with_a_break);
+  RUN_TEST(test_no_overshoot_after_the_break);
+  RUN_TEST(test_static_load);
+  RUN_TEST(test_smooth_peak);
+  return UNITY_END();
+}
@@ -0,0 +1,160 @@
+// ProfileFilter: bumpless switching between the idle and the test profile, in float and
+// in fixed point, on a constant reading and on a ramp, and the switch behind the
+// LoadCellADC interface.
+
+#include <unity.h>
+
+#include <math.h>
+
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+#include "profile_filter.h"
+
+#define FS 80.0f
+
+static ProfileFilter *profiles;
+
+void setUp()
+{
+  mock::reset();
+  profiles = new ProfileFilter();
+  profiles->get_bank(FILTER_PROFILE_IDLE).set_lowpass(FILTER_BUTTERWORTH, 2, 2);
+  profiles->get_bank(FILTER_PROFILE_TEST).set_lowpass(FILTER_BESSEL, 4, 10);
+  TEST_ASSERT_TRUE(profiles->begin(FS));
+}
+
+void tearDown()
+{
+  delete profiles;
+}
+
+static void test_select()
+{
+  TEST_ASSERT_EQUAL_INT(FILTER_PROFILE_IDLE, profiles->get_selected());
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, profiles->get_bank(FILTER_PROFILE_IDLE).get_group_delay(),
+                           profiles->get_group_delay());
+  profiles->select(FILTER_PROFILE_TEST);
+  TEST_ASSERT_EQUAL_INT(FILTER_PROFILE_TEST, profiles->get_selected());
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, profiles->get_bank(FILTER_PROFILE_TEST).get_group_delay(),
+                           profiles->get_group_delay());
+  // the wide profile lags less
+  TEST_ASSERT_LESS_THAN_FLOAT(profiles->get_bank(FILTER_PROFILE_IDLE).get_group_delay() / 3,
+                              profiles->get_group_delay());
+  profiles->select(FILTER_PROFILE_COUNT);
+  TEST_ASSERT_EQUAL_INT(FILTER_PROFILE_TEST, profiles->get_selected());
+
+  TEST_ASSERT_TRUE(profiles->set_sample_rate(1000));
+  TEST_ASSERT_EQUAL_FLOAT(1000, profiles->get_sample_rate());
+  // 10 Hz is too much for 16 SPS, the other profile is computed anyway
+  TEST_ASSERT_FALSE(profiles->set_sample_rate(16));
+  TEST_ASSERT_EQUAL_FLOAT(16, profiles->get_bank(FILTER_PROFILE_IDLE).get_sample_rate());
+}
+
+static void test_constant_reading_has_no_step()
+{
+  for (int n = 0; n < 800; n++)
+    profiles->filter(1234.5f);
+  for (int k = 0; k < 10; k++)
+  {
+    profiles->select(k & 1 ? FILTER_PROFILE_IDLE : FILTER_PROFILE_TEST);
+    for (int n = 0; n < 5; n++)
+      TEST_ASSERT_FLOAT_WITHIN(0.01f, 1234.5f, profiles->filter(1234.5f));
+  }
+
+  // fixed point: exactly the same reading
+  const int32_t x = 98765 * (1 << Biquad::signalBits);
+  for (int n = 0; n < 800; n++)
+  {
+    int32_t y = x;
+    profiles->filter_block(&y, 1);
+  }
+  for (int k = 0; k < 10; k++)
+  {
+    profiles->select(k & 1 ? FILTER_PROFILE_IDLE : FILTER_PROFILE_TEST);
+    int32_t y[5] = {x, x, x, x, x};
+    profiles->filter_block(y, 5);
+    for (int n = 0; n < 5; n++)
+      TEST_ASSERT_EQUAL_INT32(x, y[n]);
+  }
+}
+
+// Follow the ramp for n samples from *pos on, the ramp continues in *pos. The output
+// never falls and never passes the input; returns the change of the first output.
+static float followRamp(float slope, int n, int *pos, float *last)
+{
+  float first = 0;
+  for (int i = 0; i < n; i++, (*pos)++)
+  {
+    float x = slope * *pos;
+    float y = profiles->filter(x);
+    TEST_ASSERT_GREATER_OR_EQUAL_FLOAT(*last, y);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(x, y);
+    if (i == 0)
+      first = y - *last;
+    *last = y;
+  }
+  return first;
+}
+
+static void test_switch_on_a_ramp()
+{
+  // The first output after a switch continues from the last one, no step. Then the
+  // output catches up with (or falls back to) the group delay of the selected profile.
+  const float slope = 10; // per sample
+  int pos = 0;
+  float last = 0;
+  followRamp(slope, 800, &pos, &last);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, slope * (pos - 1 - profiles->get_group_delay()), last);
+
+  profiles->select(FILTER_PROFILE_TEST);
+  TEST_ASSERT_LESS_THAN_FLOAT(slope, followRamp(slope, 400, &pos, &last));
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, slope * (pos - 1 - profiles->get_group_delay()), last);
+
+  profiles->select(FILTER_PROFILE_IDLE);
+  TEST_ASSERT_LESS_THAN_FLOAT(slope, followRamp(slope, 800, &pos, &last));
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, slope * (pos - 1 - profiles->get_group_delay()), last);
+}
+
+static void test_switch_behind_the_loadcell()
+{
+  HX711Sim chip(4, 2);
+  HX711 loadcell;
+  loadcell.begin(4, 2);
+  loadcell.set_rate(HX711_RATE_80SPS);
+  loadcell.set_scale(1000); // counts per N
+  TEST_ASSERT_TRUE(loadcell.set_filter(FILTER_PROFILE_IDLE, FILTER_BUTTERWORTH, 2, 2));
+  TEST_ASSERT_TRUE(loadcell.set_filter(FILTER_PROFILE_TEST, FILTER_BESSEL, 4, 10));
+  TEST_ASSERT_EQUAL_INT(FILTER_PROFILE_IDLE, loadcell.get_filter_profile());
+  float idleDelay = loadcell.get_filter_delay();
+
+  // 5 s at 50 N, then the test starts with a ramp of 20 N/s
+  float last = 0;
+  float step = 0;
+  for (int n = 0; n < 800; n++)
+  {
+    if (n == 400)
+      loadcell.set_filter_profile(FILTER_PROFILE_TEST);
+    mock::advance(12500);
+    float force = n < 400 ? 50 : 50 + 20 * (n - 400) / FS;
+    chip.convert(lroundf(1000 * force));
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+    if (n >= 398)
+      step = fmaxf(step, fabsf(loadcell.get_cal_force() - last));
+    last = loadcell.get_cal_force();
+  }
+  TEST_ASSERT_EQUAL_INT(FILTER_PROFILE_TEST, loadcell.get_filter_profile());
+  TEST_ASSERT_LESS_THAN_FLOAT(idleDelay / 3, loadcell.get_filter_delay());
+  TEST_ASSERT_LESS_THAN_FLOAT(2 * 20 / FS, step);
+  // the lag of the test profile, in s
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 50 + 20 * (399 / FS - loadcell.get_filter_delay()), last);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_select);
+  RUN_TEST(test_constant_reading_has_no_step);
+  RUN_TEST(test_switch_on_a_ramp);
+  RUN_TEST(test_switch_behind_the_loadcell);
+  return UNITY_END();
+}
@@ -0,0 +1,108 @@
+// SampleStats: sequence numbers, missed conversions and the interval statistics of
+// conversion timestamps at 80 SPS with jitter and overwritten conversions, against a
+// direct computation, and what reset() keeps.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "sample_stats.h"
+
+void setUp()
+{
+  srand(20);
+}
+
+void tearDown()
+{
+}
+
+static void test_sequence_and_missed_conversions()
+{
+  const uint32_t nominal = 12500;
+  SampleStats stats;
+  stats.begin(nominal);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.sample(1000000));
+  TEST_ASSERT_EQUAL_UINT32(0, stats.get_sequence());
+
+  // one, then three periods: two conversions were overwritten
+  TEST_ASSERT_EQUAL_UINT32(1, stats.sample(1000000 + nominal + 150));
+  TEST_ASSERT_EQUAL_UINT32(3, stats.sample(1000000 + 4 * nominal - 100));
+  TEST_ASSERT_EQUAL_UINT32(4, stats.get_sequence());
+  TEST_ASSERT_EQUAL_UINT32(2, stats.get_missed());
+  // only the regular interval counts
+  TEST_ASSERT_EQUAL_UINT32(1, stats.get_count());
+  TEST_ASSERT_EQUAL_FLOAT(nominal + 150, stats.get_mean());
+}
+
+static void test_intervals_against_a_direct_computation()
+{
+  // 80 SPS with up to +-200 us of jitter, every 100th conversion overwritten unread
+  const uint32_t nominal = 12500;
+  SampleStats stats;
+  stats.begin(nominal);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.sample(1000000));
+
+  std::vector<int64_t> intervals;
+  int64_t conversion = 1000000;
+  int64_t last = 1000000;
+  uint32_t expectedMissed = 0;
+  for (int i = 1; i <= 20001; i++)
+  {
+    conversion += nominal;
+    if (i % 100 == 0)
+    {
+      expectedMissed++;
+      continue;
+    }
+    int64_t timestamp = conversion + rand() % 401 - 200;
+    uint32_t periods = stats.sample(timestamp);
+    TEST_ASSERT_EQUAL_UINT32(i % 100 == 1 && i > 1 ? 2 : 1, periods);
+    if (periods == 1)
+      intervals.push_back(timestamp - last);
+    last = timestamp;
+  }
+  TEST_ASSERT_EQUAL_UINT32(20001, stats.get_sequence());
+  TEST_ASSERT_EQUAL_UINT32(expectedMissed, stats.get_missed());
+  TEST_ASSERT_EQUAL_UINT32(intervals.size(), stats.get_count());
+
+  std::sort(intervals.begin(), intervals.end());
+  double sum = 0;
+  for (int64_t interval : intervals)
+    sum += interval;
+  TEST_ASSERT_EQUAL_FLOAT(intervals.front(), stats.get_min());
+  TEST_ASSERT_EQUAL_FLOAT(intervals.back(), stats.get_max());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, sum / intervals.size(), stats.get_mean());
+  // the percentiles have the resolution of a bin, rounded up
+  const float bin = nominal / 64.0f;
+  for (float p : {1.0f, 50.0f, 99.0f, 100.0f})
+  {
+    float exact = intervals[(size_t)ceilf(p / 100 * intervals.size()) - 1];
+    float percentile = stats.get_percentile(p);
+    TEST_ASSERT_GREATER_OR_EQUAL_FLOAT(exact, percentile);
+    TEST_ASSERT_LESS_THAN_FLOAT(exact + bin, percentile);
+  }
+
+  // reset() clears the statistics, the sequence goes on
+  stats.reset();
+  TEST_ASSERT_EQUAL_UINT32(0, stats.get_missed());
+  TEST_ASSERT_EQUAL_UINT32(0, stats.get_count());
+  TEST_ASSERT_EQUAL_FLOAT(0, stats.get_percentile(50));
+  TEST_ASSERT_EQUAL_UINT32(3, stats.sample(last + 3 * nominal));
+  TEST_ASSERT_EQUAL_UINT32(20004, stats.get_sequence());
+  TEST_ASSERT_EQUAL_UINT32(2, stats.get_missed());
+  // a timestamp out of order is ignored
+  TEST_ASSERT_EQUAL_UINT32(0, stats.sample(last));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_sequence_and_missed_conversions);
+  RUN_TEST(test_intervals_against_a_direct_computation);
+  return UNITY_END();
+}
@@ -0,0 +1,222 @@
+// SpikeFilter: the median networks, injected glitches on a noisy reading, steps, the
+// disabled filter, the stage in the LoadCellADC pipeline and a benchmark per window.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+#include "spike_filter.h"
+
+// about normally distributed noise with the standard deviation sigma
+static float noise(float sigma)
+{
+  float sum = 0;
+  for (int i = 0; i < 12; i++)
+    sum += (float)rand() / RAND_MAX;
+  return (sum - 6) * sigma;
+}
+
+void setUp()
+{
+  mock::reset();
+}
+
+void tearDown()
+{
+}
+
+static void test_disabled_passes_everything()
+{
+  SpikeFilter spike;
+  TEST_ASSERT_FALSE(spike.is_enabled());
+  TEST_ASSERT_TRUE(spike.begin(0));
+  TEST_ASSERT_FALSE(spike.is_enabled());
+  float x[] = {1, 2, 1e6f, -1, 3};
+  spike.filter_block(x, 5);
+  TEST_ASSERT_EQUAL_FLOAT(1e6f, x[2]);
+  TEST_ASSERT_EQUAL_FLOAT(-1, spike.filter(-1));
+  TEST_ASSERT_EQUAL_UINT32(0, spike.get_spike_count());
+
+  // only odd windows up to 9
+  for (uint8_t window : {1, 2, 4, 10, 255})
+  {
+    TEST_ASSERT_FALSE(spike.begin(window));
+    TEST_ASSERT_FALSE(spike.is_enabled());
+  }
+}
+
+static void test_median_networks()
+{
+  // with threshold 0 every value that is not the median is replaced by it
+  srand(3);
+  for (uint8_t window : {3, 5, 7, 9})
+  {
+    SpikeFilter spike;
+    TEST_ASSERT_TRUE(spike.begin(window, 0));
+    float history[9];
+    for (int n = 0; n < 2000; n++)
+    {
+      // few distinct values, so that ties are covered as well
+      float x = (float)(rand() % (n < 1000 ? 1000 : 5));
+      float y = spike.filter(x);
+      history[n % window] = x;
+      // the first values pass until the window is full
+      if (n < window)
+      {
+        TEST_ASSERT_EQUAL_FLOAT(x, y);
+        continue;
+      }
+      float sorted[9];
+      std::copy(history, history + window, sorted);
+      std::nth_element(sorted, sorted + window / 2, sorted + window);
+      TEST_ASSERT_EQUAL_FLOAT(sorted[window / 2], y);
+    }
+  }
+}
+
+static void test_injected_glitches()
+{
+  // noise of 20 counts on 100000 counts; every 37th reading is corrupted
+  const float corrupt[] = {-1, 0x7FFFFF, -0x800000, 100000 + 1000, 100000 - 1000};
+  for (uint8_t window : {3, 5, 7, 9})
+  {
+    srand(4);
+    // the MAD of a few values scatters widely, the minimum deviation of 5 sigma keeps
+    // the regular readings from being replaced, as LOADCELL_SPIKE_MIN_COUNTS does
+    SpikeFilter spike;
+    TEST_ASSERT_TRUE(spike.begin(window, 5, 100));
+    uint32_t injected = 0;
+    uint32_t passed = 0;
+    for (int n = 0; n < 5000; n++)
+    {
+      float clean = 100000 + noise(20);
+      bool glitch = n > window && n % 37 == 0;
+      float x = glitch ? corrupt[injected++ % 5] : clean;
+      float y = spike.filter(x);
+      if (glitch)
+      {
+        // replaced by the median of its neighbours
+        TEST_ASSERT_FLOAT_WITHIN(100, 100000, y);
+      }
+      else if (n >= window)
+      {
+        // regular readings pass unchanged, apart from the rare outliers of the noise
+        TEST_ASSERT_FLOAT_WITHIN(150, 100000, y);
+        passed += y == x;
+      }
+    }
+    // every glitch counted, hardly any regular reading
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(injected, spike.get_spike_count());
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(injected + 10, spike.get_spike_count());
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(4900 - injected - 10, passed);
+  }
+}
+
+static void test_step_passes_delayed()
+{
+  // a real step is held back by (window - 1) / 2 readings, then passes unchanged
+  for (uint8_t window : {3, 5, 7, 9})
+  {
+    SpikeFilter spike;
+    TEST_ASSERT_TRUE(spike.begin(window, 5, 10));
+    int delay = (window - 1) / 2;
+    for (int n = 0; n < 50; n++)
+    {
+      float x = n < 20 ? 1000 + (n & 1) : 50000 + (n & 1);
+      float y = spike.filter(x);
+      if (n < 20 || n >= 20 + delay)
+        TEST_ASSERT_EQUAL_FLOAT(x, y);
+      else
+        TEST_ASSERT_LESS_THAN_FLOAT(1002, y);
+    }
+    TEST_ASSERT_EQUAL_UINT32(delay, spike.get_spike_count());
+  }
+}
+
+static void test_min_deviation()
+{
+  // a noiseless reading has a MAD of 0; the minimum deviation still lets small changes pass
+  SpikeFilter spike;
+  TEST_ASSERT_TRUE(spike.begin(5, 5, 10));
+  for (int n = 0; n < 10; n++)
+    spike.filter(500);
+  TEST_ASSERT_EQUAL_FLOAT(509, spike.filter(509));
+  TEST_ASSERT_EQUAL_FLOAT(500, spike.filter(520));
+  TEST_ASSERT_EQUAL_UINT32(1, spike.get_spike_count());
+
+  // reset() drops the history, the next values pass until the window is full
+  spike.reset();
+  TEST_ASSERT_EQUAL_FLOAT(-5000, spike.filter(-5000));
+}
+
+// largest force over 10 s of a constant reading with single all-ones words in between
+static float peakForce(uint8_t window)
+{
+  mock::reset();
+  HX711Sim chip(4, 2);
+  HX711 loadcell;
+  loadcell.begin(4, 2);
+  loadcell.set_rate(HX711_RATE_80SPS);
+  loadcell.set_zeropoint_offset(0);
+  loadcell.set_scale(1000); // 100 N
+  TEST_ASSERT_TRUE(loadcell.set_spike_filter(window, 5, 500));
+  float peak = 0;
+  for (int n = 0; n < 800; n++)
+  {
+    mock::advance(12500);
+    chip.convert(n % 100 == 50 ? 0x7FFFFF : 100000 + (n & 3));
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+    if (n > 400 && loadcell.get_cal_force() > peak)
+      peak = loadcell.get_cal_force();
+  }
+  TEST_ASSERT_EQUAL_UINT32(window ? 8 : 0, loadcell.get_spike_count());
+  return peak;
+}
+
+static void test_pipeline_ignores_corrupted_words()
+{
+  // without the stage a saturated word raises the peak force by far
+  TEST_ASSERT_GREATER_THAN_FLOAT(150, peakForce(0));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100, peakForce(5));
+}
+
+static void test_benchmark()
+{
+  const int n = 1000000;
+  static float x[1024];
+  srand(5);
+  for (int i = 0; i < 1024; i++)
+    x[i] = 100000 + noise(20) + (i % 97 == 0 ? 50000 : 0);
+
+  for (uint8_t window : {0, 3, 5, 7, 9})
+  {
+    SpikeFilter spike;
+    spike.begin(window, 5);
+    volatile float sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+      sink = sink + spike.filter(x[i & 1023]);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+    printf("spike filter window %d: %.1f ns per sample\n", window, ns);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_disabled_passes_everything);
+  RUN_TEST(test_median_networks);
+  RUN_TEST(test_injected_glitches);
+  RUN_TEST(test_step_passes_delayed);
+  RUN_TEST(test_min_deviation);
+  RUN_TEST(test_pipeline_ignores_corrupted_words);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,155 @@
+// Statistics core of the self-tests: RunningStats against a direct computation in double
+// over a long stream at a large offset, and NoiseTest on raw readings with a known noise.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "noise_test.h"
+#include "running_stats.h"
+
+// normally distributed noise with the standard deviation sigma (Box-Muller)
+static float gauss(float sigma)
+{
+  float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+  float u2 = (float)rand() / RAND_MAX;
+  return sigma * sqrtf(-2 * logf(u1)) * cosf(2 * (float)M_PI * u2);
+}
+
+// Filtered readings near the top of the 24-bit range: noise, steps and a slow ramp,
+// with the fraction bits of the low pass.
+static float value(int i)
+{
+  float level = (i / 5000) % 3 == 1 ? 200000.0f : 0.0f;
+  return 8000000 - 0.5f * (i % 20000) + level + roundf(gauss(30) * 64) / 64;
+}
+
+struct Direct
+{
+  double mean, variance, min, max;
+};
+
+static Direct direct(const std::deque<float> &x)
+{
+  Direct d = {0, 0, x.front(), x.front()};
+  for (float v : x)
+  {
+    d.mean += v;
+    d.min = std::min(d.min, (double)v);
+    d.max = std::max(d.max, (double)v);
+  }
+  d.mean /= x.size();
+  for (float v : x)
+    d.variance += (v - d.mean) * (v - d.mean);
+  d.variance /= x.size();
+  return d;
+}
+
+void setUp()
+{
+  srand(20);
+}
+
+void tearDown()
+{
+}
+
+static void test_running_stats()
+{
+  RunningStats stats;
+  TEST_ASSERT_EQUAL_UINT32(0, stats.get_count());
+  TEST_ASSERT_EQUAL_FLOAT(0, stats.get_stddev());
+
+  std::deque<float> all;
+  std::vector<float> block;
+  for (int i = 0; i < 200000; i++)
+  {
+    float x = value(i);
+    all.push_back(x);
+    // half of them as blocks
+    if (i % 2000 < 1000)
+    {
+      stats.push(x);
+    }
+    else
+    {
+      block.push_back(x);
+      if (block.size() == 16)
+      {
+        stats.push_block(block.data(), block.size());
+        block.clear();
+      }
+    }
+  }
+  stats.push_block(block.data(), block.size());
+  Direct d = direct(all);
+  TEST_ASSERT_EQUAL_UINT32(all.size(), stats.get_count());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, d.mean, stats.get_mean());
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f * d.variance, d.variance, stats.get_variance());
+  TEST_ASSERT_EQUAL_FLOAT(d.min, stats.get_min());
+  TEST_ASSERT_EQUAL_FLOAT(d.max, stats.get_max());
+
+  // a constant has no variance, even far from 0
+  stats.reset();
+  for (int i = 0; i < 1000; i++)
+    stats.push(8388607);
+  TEST_ASSERT_EQUAL_FLOAT(0, stats.get_variance());
+  TEST_ASSERT_EQUAL_FLOAT(8388607, stats.get_mean());
+}
+
+static void test_noise_test()
+{
+  // white noise of 8 counts at a large reading: effective bits 24 - log2(8) = 21, the
+  // peak-to-peak noise of 10000 readings about 7.7 sigma
+  NoiseTest test;
+  TEST_ASSERT_FALSE(test.is_running());
+  TEST_ASSERT_FALSE(test.push(1));
+  test.begin(10000);
+  TEST_ASSERT_TRUE(test.is_running());
+  for (int i = 0; i < 9999; i++)
+    TEST_ASSERT_FALSE(test.push(8000000 + lroundf(gauss(8))));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.9999f, test.get_progress());
+  TEST_ASSERT_TRUE(test.push(8000000));
+  TEST_ASSERT_TRUE(test.is_done());
+  TEST_ASSERT_FALSE(test.is_running());
+  // no more readings count
+  test.push(0);
+  TEST_ASSERT_EQUAL_UINT32(10000, test.get_count());
+
+  TEST_ASSERT_FLOAT_WITHIN(0.2f, 8, test.get_rms());
+  TEST_ASSERT_FLOAT_WITHIN(10, 7.7f * 8, test.get_peak_to_peak());
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 21, test.get_effective_bits());
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 24 - log2f(test.get_peak_to_peak()), test.get_noise_free_bits());
+
+  // below one count the ADC resolves all its bits; 16-bit ADCs too
+  test.begin(100, 16);
+  for (int i = 0; i < 100; i++)
+    test.push(i % 2);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, test.get_rms());
+  TEST_ASSERT_EQUAL_FLOAT(16, test.get_effective_bits());
+  TEST_ASSERT_EQUAL_FLOAT(16, test.get_noise_free_bits());
+
+  // a cancelled test keeps what it has
+  test.begin(1000);
+  for (int i = 0; i < 10; i++)
+    test.push(i * 10);
+  test.cancel();
+  TEST_ASSERT_FALSE(test.is_running());
+  TEST_ASSERT_FALSE(test.is_done());
+  TEST_ASSERT_EQUAL_UINT32(10, test.get_count());
+  TEST_ASSERT_EQUAL_FLOAT(90, test.get_peak_to_peak());
+  TEST_ASSERT_EQUAL_FLOAT(0, test.get_progress());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_running_stats);
+  RUN_TEST(test_noise_test);
+  return UNITY_END();
+}
@@ -0,0 +1,189 @@
+// TareJob: synthetic settling curves at 80 SPS, as loop() feeds the filtered readings,
+// against the zero point they settle on. Decays and ringing that end within the timeout
+// give the zero point; a slow decay, creep and noise above the limit are rejected. And
+// the progress for the UI and the state changes of the job.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "hx711_sim.h"
+#include "hx711_zp.h"
+#include "tare_job.h"
+
+#define FS 80
+#define WINDOW FS      // ZERO_WINDOW_MS of 1 s
+#define LIMIT 50.0f    // counts, ZERO_MAX_STDDEV_N with 100 counts per N
+#define TIMEOUT 10000  // ms, ZERO_TIMEOUT_MS
+#define ZERO 123456.0f // counts the curves settle on
+
+// normally distributed noise with the standard deviation sigma (Box-Muller)
+static float gauss(float sigma)
+{
+  float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+  float u2 = (float)rand() / RAND_MAX;
+  return sigma * sqrtf(-2 * logf(u1)) * cosf(2 * (float)M_PI * u2);
+}
+
+// Feed the curve f(t) in counts until the job ends; returns the time in s it took.
+template <typename F>
+static float run(TareJob &job, F curve)
+{
+  TEST_ASSERT_TRUE(job.begin(WINDOW, LIMIT, TIMEOUT));
+  const int64_t start = 5000000; // us
+  int n = 0;
+  while (job.get_state() == TARE_RUNNING)
+  {
+    float t = (float)n / FS;
+    job.push(curve(t), start + (int64_t)n * 1000000 / FS);
+    n++;
+    TEST_ASSERT_TRUE(n <= (TIMEOUT / 1000 + 1) * FS);
+  }
+  return (float)n / FS;
+}
+
+void setUp()
+{
+  srand(18);
+}
+
+void tearDown()
+{
+}
+
+static void test_decays_settle_on_the_zero_point()
+{
+  // the load comes off and the reading decays; the window starts to count once the
+  // drift over it, a tau e^(-t / tau) / tau, shows less than the limit
+  for (float tau : {0.05f, 0.2f, 0.5f, 1.0f})
+  {
+    for (float noise : {0.0f, 20.0f})
+    {
+      TareJob job;
+      float amplitude = 20000;
+      float t = run(job, [=](float t) { return ZERO + amplitude * expf(-t / tau) + gauss(noise); });
+      TEST_ASSERT_EQUAL_INT(TARE_DONE, job.get_state());
+      TEST_ASSERT_EQUAL_FLOAT(1, job.get_progress());
+      TEST_ASSERT_LESS_OR_EQUAL_FLOAT(LIMIT, job.get_stddev());
+      // at least a full window, and no longer than needed for the decay
+      TEST_ASSERT_GREATER_OR_EQUAL_FLOAT(1.0f, t);
+      TEST_ASSERT_LESS_THAN_FLOAT(1 + tau * logf(amplitude / LIMIT) + 0.1f, t);
+      // what is left of the decay over the last window, plus the noise of its mean
+      float rest = amplitude * expf(-(t - 1) / tau);
+      TEST_ASSERT_FLOAT_WITHIN(rest + 4 * noise / sqrtf(WINDOW) + 0.01f, ZERO, job.get_result());
+    }
+  }
+}
+
+static void test_ringing_settles()
+{
+  // the frame rings at 6 Hz after the load is taken off
+  TareJob job;
+  run(job, [](float t) { return ZERO + 5000 * expf(-t / 0.3f) * cosf(2 * (float)M_PI * 6 * t) + gauss(10); });
+  TEST_ASSERT_EQUAL_INT(TARE_DONE, job.get_state());
+  TEST_ASSERT_FLOAT_WITHIN(10, ZERO, job.get_result());
+}
+
+static void test_moving_is_rejected()
+{
+  // a slow decay, a creep of 200 counts/s and noise above the limit: no zero point
+  // after the timeout; a drift d over the window shows as d / sqrt(12)
+  TareJob job;
+  float t = run(job, [](float t) { return ZERO + 20000 * expf(-t / 3); });
+  TEST_ASSERT_EQUAL_INT(TARE_MOVING, job.get_state());
+  TEST_ASSERT_FLOAT_WITHIN(0.02f, TIMEOUT / 1000.0f, t);
+
+  t = run(job, [](float t) { return ZERO + 200 * t; });
+  TEST_ASSERT_EQUAL_INT(TARE_MOVING, job.get_state());
+  TEST_ASSERT_FLOAT_WITHIN(2, 200 / sqrtf(12), job.get_stddev());
+  TEST_ASSERT_LESS_THAN_FLOAT(1, job.get_progress());
+
+  run(job, [](float) { return ZERO + gauss(2 * LIMIT); });
+  TEST_ASSERT_EQUAL_INT(TARE_MOVING, job.get_state());
+  TEST_ASSERT_FLOAT_WITHIN(0.3f, 0.5f, job.get_progress());
+
+  // a creep just below the limit is indistinguishable from a settled load
+  run(job, [](float t) { return ZERO + 150 * t; });
+  TEST_ASSERT_EQUAL_INT(TARE_DONE, job.get_state());
+}
+
+static void test_progress_and_states()
+{
+  TareJob job;
+  TEST_ASSERT_EQUAL_INT(TARE_IDLE, job.get_state());
+  TEST_ASSERT_EQUAL_FLOAT(0, job.get_progress());
+  // nothing counts before begin()
+  TEST_ASSERT_EQUAL_INT(TARE_IDLE, job.push(1, 0));
+
+  // a steady reading fills the window at a steady pace
+  TEST_ASSERT_TRUE(job.begin(WINDOW, LIMIT, TIMEOUT));
+  for (int n = 0; n < WINDOW - 1; n++)
+  {
+    TEST_ASSERT_EQUAL_INT(TARE_RUNNING, job.push(ZERO, n * 12500));
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, (n + 1.0f) / WINDOW, job.get_progress());
+  }
+  TEST_ASSERT_EQUAL_INT(TARE_DONE, job.push(ZERO, WINDOW * 12500));
+  TEST_ASSERT_EQUAL_FLOAT(ZERO, job.get_result());
+  // the result stays until the next start
+  TEST_ASSERT_EQUAL_INT(TARE_DONE, job.push(0, (WINDOW + 1) * 12500));
+  TEST_ASSERT_EQUAL_FLOAT(ZERO, job.get_result());
+
+  // a new start drops the old readings, cancel() stops the job
+  TEST_ASSERT_TRUE(job.begin(WINDOW / 2, LIMIT, TIMEOUT));
+  TEST_ASSERT_EQUAL_FLOAT(0, job.get_progress());
+  job.push(ZERO, 0);
+  job.cancel();
+  TEST_ASSERT_EQUAL_INT(TARE_IDLE, job.get_state());
+  TEST_ASSERT_EQUAL_INT(TARE_IDLE, job.push(ZERO, 12500));
+
+  // the timeout counts from the first reading
+  TEST_ASSERT_TRUE(job.begin(WINDOW, LIMIT, 100));
+  TEST_ASSERT_EQUAL_INT(TARE_RUNNING, job.push(0, 7000000));
+  TEST_ASSERT_EQUAL_INT(TARE_RUNNING, job.push(1000, 7099999));
+  TEST_ASSERT_EQUAL_INT(TARE_MOVING, job.push(0, 7100000));
+}
+
+static void test_filtered_readings_of_the_hx711()
+{
+  // the load of 500 N comes off at once; the job sees the readings after the low pass,
+  // which rings and lags, and settles on the zero point of the chip
+  mock::reset();
+  HX711Sim chip(4, 2);
+  HX711 loadcell;
+  loadcell.begin(4, 2);
+  loadcell.set_rate(HX711_RATE_80SPS);
+  for (int n = 0; n < 2 * FS; n++)
+  {
+    mock::advance(12500);
+    chip.convert(lroundf(ZERO) + 50000 + lroundf(gauss(20)));
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+  }
+
+  TareJob job;
+  TEST_ASSERT_TRUE(job.begin(WINDOW, LIMIT, TIMEOUT));
+  int n = 0;
+  while (job.get_state() == TARE_RUNNING && n < 20 * FS)
+  {
+    mock::advance(12500);
+    chip.convert(lroundf(ZERO) + lroundf(gauss(20)));
+    TEST_ASSERT_TRUE(loadcell.try_read(0));
+    job.push(loadcell.get_last_reading(), mock::now());
+    n++;
+  }
+  TEST_ASSERT_EQUAL_INT(TARE_DONE, job.get_state());
+  TEST_ASSERT_LESS_THAN(3 * FS, n);
+  // the end of the decay in the window shifts the mean by a part of the limit
+  TEST_ASSERT_FLOAT_WITHIN(LIMIT / 2, ZERO, job.get_result());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_decays_settle_on_the_zero_point);
+  RUN_TEST(test_ringing_settles);
+  RUN_TEST(test_moving_is_rejected);
+  RUN_TEST(test_progress_and_states);
+  RUN_TEST(test_filtered_readings_of_the_hx711);
+  return UNITY_END();
+}
@@ -0,0 +1,116 @@
+// WindowStats: the sliding mean, standard deviation, minimum and maximum against a
+// direct computation in double over every window of a long stream at a large offset,
+// and a window that is not full yet.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <deque>
+
+#include "window_stats.h"
+
+// normally distributed noise with the standard deviation sigma (Box-Muller)
+static float gauss(float sigma)
+{
+  float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+  float u2 = (float)rand() / RAND_MAX;
+  return sigma * sqrtf(-2 * logf(u1)) * cosf(2 * (float)M_PI * u2);
+}
+
+// Filtered readings near the top of the 24-bit range: noise, steps and a slow ramp,
+// with the fraction bits of the low pass.
+static float value(int i)
+{
+  float level = (i / 5000) % 3 == 1 ? 200000.0f : 0.0f;
+  return 8000000 - 0.5f * (i % 20000) + level + roundf(gauss(30) * 64) / 64;
+}
+
+struct Direct
+{
+  double mean, variance, min, max;
+};
+
+static Direct direct(const std::deque<float> &x)
+{
+  Direct d = {0, 0, x.front(), x.front()};
+  for (float v : x)
+  {
+    d.mean += v;
+    d.min = std::min(d.min, (double)v);
+    d.max = std::max(d.max, (double)v);
+  }
+  d.mean /= x.size();
+  for (float v : x)
+    d.variance += (v - d.mean) * (v - d.mean);
+  d.variance /= x.size();
+  return d;
+}
+
+void setUp()
+{
+  srand(20);
+}
+
+void tearDown()
+{
+}
+
+static void test_window_stats()
+{
+  // the sliding update against the direct computation over every window of a long
+  // stream: the rounding of the variance must not build up
+  for (uint16_t window : {1, 2, 20, 160, 1000})
+  {
+    WindowStats stats;
+    TEST_ASSERT_TRUE(stats.begin(window));
+    std::deque<float> last;
+    double worst = 0;
+    for (int i = 0; i < 300000; i++)
+    {
+      float x = value(i);
+      stats.push(x);
+      last.push_back(x);
+      if (last.size() > window)
+        last.pop_front();
+      TEST_ASSERT_EQUAL_UINT16(last.size(), stats.get_count());
+      if (i % 97 != 0 && i < 300000 - 1)
+        continue;
+      Direct d = direct(last);
+      TEST_ASSERT_FLOAT_WITHIN(0.01f, d.mean, stats.get_mean());
+      TEST_ASSERT_EQUAL_FLOAT(d.min, stats.get_min());
+      TEST_ASSERT_EQUAL_FLOAT(d.max, stats.get_max());
+      worst = std::max(worst, fabs(stats.get_stddev() - sqrt(d.variance)));
+    }
+    TEST_ASSERT_TRUE(stats.is_full());
+    // a fraction of the noise, also after the steps of 200000 left the window
+    TEST_ASSERT_LESS_THAN_FLOAT(0.01f, (float)worst);
+  }
+
+  // before the window is full it covers what is there; reset() drops it
+  WindowStats stats;
+  TEST_ASSERT_EQUAL_FLOAT(0, stats.get_mean());
+  TEST_ASSERT_TRUE(stats.begin(4));
+  stats.push(3);
+  stats.push(5);
+  TEST_ASSERT_FALSE(stats.is_full());
+  TEST_ASSERT_EQUAL_FLOAT(4, stats.get_mean());
+  TEST_ASSERT_EQUAL_FLOAT(1, stats.get_stddev());
+  TEST_ASSERT_EQUAL_FLOAT(3, stats.get_min());
+  TEST_ASSERT_EQUAL_FLOAT(5, stats.get_max());
+  stats.reset();
+  TEST_ASSERT_EQUAL_UINT16(0, stats.get_count());
+  TEST_ASSERT_EQUAL_FLOAT(0, stats.get_max());
+  TEST_ASSERT_FALSE(stats.begin(0));
+  stats.push(1);
+  TEST_ASSERT_EQUAL_UINT16(0, stats.get_count());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_window_stats);
+  return UNITY_END();
+}
@@ -0,0 +1,167 @@
+// Offline analysis of a recorded test: forward-backward filtering without lag, the peak
+// refined by a parabola and the peak before a break, replayed on synthetic records with a
+// known peak, and the time for a 60 s record at 80 SPS.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+#include "zero_phase.h"
+
+#define FS 80.0f
+#define CUTOFF 4.0f                   // LOADCELL_FILTER_CUTOFF_TEST of the HX711
+#define WIDTH ((int)(FS / CUTOFF) + 1) // as in analyzeTest()
+
+static BiquadBank bank;
+
+// normally distributed noise with the standard deviation sigma (Box-Muller)
+static float gauss(float sigma)
+{
+  float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+  float u2 = (float)rand() / RAND_MAX;
+  return sigma * sqrtf(-2 * logf(u1)) * cosf(2 * (float)M_PI * u2);
+}
+
+void setUp()
+{
+  srand(15);
+  bank.set_lowpass(FILTER_BUTTERWORTH, 2, CUTOFF);
+  bank.set_notch(0);
+  TEST_ASSERT_TRUE(bank.begin(FS));
+}
+
+void tearDown()
+{
+}
+
+static void test_filtfilt_has_no_lag()
+{
+  // a ramp stays the same ramp, up to the edges
+  const int n = 400;
+  std::vector<float> x(n);
+  for (int i = 0; i < n; i++)
+    x[i] = 10 + 0.5f * i;
+  filtfilt(bank, x.data(), n);
+  for (int i = 0; i < n; i++)
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 10 + 0.5f * i, x[i]);
+
+  // a sine in the pass band keeps its phase; its amplitude is the magnitude squared
+  const float f = 1;
+  float r = tanf((float)M_PI * f / FS) / tanf((float)M_PI * CUTOFF / FS);
+  float gain = 1 / (1 + r * r * r * r);
+  for (int i = 0; i < n; i++)
+    x[i] = sinf(2 * (float)M_PI * f * i / FS);
+  filtfilt(bank, x.data(), n);
+  for (int i = 2 * WIDTH; i < n - 2 * WIDTH; i++)
+    TEST_ASSERT_FLOAT_WITHIN(2e-3f, gain * sinf(2 * (float)M_PI * f * i / FS), x[i]);
+
+  // nothing to do for fewer than 2 values
+  float one = 3;
+  filtfilt(bank, &one, 1);
+  TEST_ASSERT_EQUAL_FLOAT(3, one);
+}
+
+static void test_find_peak()
+{
+  // the vertex of a sampled parabola is found exactly
+  float x[20];
+  for (int i = 0; i < 20; i++)
+    x[i] = 50 - 2 * (i - 7.3f) * (i - 7.3f);
+  float index;
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 50, find_peak(x, 20, &index));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 7.3f, index);
+
+  // a maximum at an end is not refined
+  TEST_ASSERT_EQUAL_FLOAT(x[8], find_peak(x + 8, 12, &index));
+  TEST_ASSERT_EQUAL_FLOAT(0, index);
+  TEST_ASSERT_EQUAL_FLOAT(x[6], find_peak(x, 7, &index));
+  TEST_ASSERT_EQUAL_FLOAT(6, index);
+  TEST_ASSERT_EQUAL_FLOAT(0, find_peak(x, 0, &index));
+  TEST_ASSERT_EQUAL_FLOAT(0, index);
+}
+
+// a noisy ramp to peak at tPeak s, then the rope breaks; returns the record of n values
+static std::vector<float> breakRecord(float peak, float tPeak, int n, float noise)
+{
+  std::vector<float> x(n);
+  for (int i = 0; i < n; i++)
+  {
+    float t = i / FS;
+    x[i] = (t <= tPeak ? peak * t / tPeak : 2) + gauss(noise);
+  }
+  return x;
+}
+
+static void test_break_peak_of_ramps()
+{
+  for (float tPeak : {0.5f, 2.0f, 10.0f})
+  {
+    for (float noise : {0.0f, 0.3f})
+    {
+      // the break somewhere between two readings
+      float t = tPeak + 0.3f / FS;
+      int n = (int)((t + 1) * FS);
+      std::vector<float> x = breakRecord(100, t, n, noise);
+      std::vector<float> y(n + 2 * WIDTH);
+      float index;
+      float peak = find_break_peak(bank, x.data(), n, WIDTH, y.data(), &index);
+      // the last reading before the break is up to one interval short of the peak
+      float step = 100 / (t * FS);
+      TEST_ASSERT_FLOAT_WITHIN(step + noise, 100, peak);
+      TEST_ASSERT_FLOAT_WITHIN(1, t * FS, index);
+
+      // the running maximum of the causal filter lags far behind on the fast ramps
+      bank.reset();
+      float running = 0;
+      for (int i = 0; i < n; i++)
+        running = fmaxf(running, bank.filter(x[i]));
+      TEST_ASSERT_LESS_THAN_FLOAT(100 - step - 0.5f * 100 / (t * FS) * bank.get_group_delay(), running);
+    }
+  }
+}
+
+static void test_peak_without_a_break()
+{
+  // the load is taken off slowly: the whole record is used, the peak is in the middle
+  const int n = 800;
+  std::vector<float> x(n);
+  for (int i = 0; i < n; i++)
+    x[i] = 100 * sinf((float)M_PI * i / n) + gauss(0.3f);
+  std::vector<float> y(n + 2 * WIDTH);
+  float index;
+  float peak = find_break_peak(bank, x.data(), n, WIDTH, y.data(), &index);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 100, peak);
+  TEST_ASSERT_FLOAT_WITHIN(10, n / 2.0f, index);
+}
+
+static void test_benchmark()
+{
+  // analysis of a 60 s test at 80 SPS, as after endTest()
+  const int n = 60 * 80;
+  std::vector<float> x = breakRecord(500, 59, n, 0.5f);
+  std::vector<float> y(n + 2 * WIDTH);
+  const int repeat = 200;
+  float index = 0;
+  volatile float sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeat; r++)
+    sink = sink + find_break_peak(bank, x.data(), n, WIDTH, y.data(), &index);
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeat;
+  printf("find_break_peak, 60 s at 80 SPS: %.0f us\n", us);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_filtfilt_has_no_lag);
+  RUN_TEST(test_find_peak);
+  RUN_TEST(test_break_peak_of_ramps);
+  RUN_TEST(test_peak_without_a_break);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
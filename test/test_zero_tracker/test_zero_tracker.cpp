@@ -0,0 +1,168 @@
+// ZeroTracker: hours of a slow temperature drift of the zero point at 80 SPS, with the
+// limits main.cpp uses at 100 counts per N. The correction follows the drift within
+// the lag of its window, at the limited rate and up to the limited distance; loads,
+// noise and movement are not tracked.
+
+#include <unity.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "zero_tracker.h"
+
+#define FS 80
+#define WINDOW (2 * FS)      // ZERO_TRACK_WINDOW_MS
+#define MAX_STDDEV 50.0f     // counts, ZERO_TRACK_MAX_STDDEV_N
+#define BAND 200.0f          // ZERO_TRACK_BAND_N
+#define MAX_CORRECTION 2000  // ZERO_TRACK_MAX_CORRECTION_N
+#define MAX_RATE 5.0f        // counts/s, ZERO_TRACK_RATE_N
+#define REFERENCE 8123456.0f // a large zero point: float resolves half a count there
+#define NOISE 10.0f          // counts
+
+static ZeroTracker tracker;
+static int64_t now; // us
+
+// normally distributed noise with the standard deviation sigma (Box-Muller)
+static float gauss(float sigma)
+{
+  float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+  float u2 = (float)rand() / RAND_MAX;
+  return sigma * sqrtf(-2 * logf(u1)) * cosf(2 * (float)M_PI * u2);
+}
+
+// Feed the zero point drift(t) plus the load(t) and noise for the given time in s; t
+// counts from the start of the test. Returns the largest distance of the correction
+// from the drift once the first window is full.
+template <typename D, typename L>
+static float run(float seconds, D drift, L load, float noise = NOISE)
+{
+  float worst = 0;
+  int64_t end = now + (int64_t)(seconds * 1e6f);
+  for (int n = 0; now < end; n++)
+  {
+    now += 1000000 / FS;
+    float t = now / 1e6f;
+    float correction = tracker.update(REFERENCE + drift(t) + load(t) + gauss(noise), now);
+    if (n >= WINDOW)
+      worst = fmaxf(worst, fabsf(correction - drift(t)));
+  }
+  return worst;
+}
+
+static float noLoad(float)
+{
+  return 0;
+}
+
+void setUp()
+{
+  srand(19);
+  now = 0;
+  TEST_ASSERT_TRUE(tracker.begin(WINDOW));
+  tracker.set_limits(MAX_STDDEV, BAND, MAX_CORRECTION, MAX_RATE);
+  tracker.set_reference(REFERENCE);
+}
+
+void tearDown()
+{
+}
+
+static void test_slow_drift_is_followed()
+{
+  // 300 counts up and down over 4 hours: at most 0.13 counts/s, the window mean lags
+  // by half a window, its noise is NOISE / sqrt(WINDOW)
+  auto drift = [](float t) { return 300 * sinf(2 * (float)M_PI * t / 14400); };
+  float worst = run(4 * 3600, drift, noLoad);
+  float lag = 300 * 2 * (float)M_PI / 14400 * WINDOW / 2 / FS;
+  TEST_ASSERT_LESS_THAN_FLOAT(lag + 5 * NOISE / sqrtf(WINDOW), worst);
+  TEST_ASSERT_FLOAT_WITHIN(lag + 5 * NOISE / sqrtf(WINDOW), drift(now / 1e6f), tracker.get_correction());
+}
+
+static void test_rate_is_limited()
+{
+  // a drift of 20 counts/s is followed at MAX_RATE only, until it has run out of the
+  // band; from then on it counts as a load
+  run(60, [](float t) { return 20 * t; }, noLoad);
+  float correction = tracker.get_correction();
+  TEST_ASSERT_LESS_OR_EQUAL_FLOAT(BAND / (20 - MAX_RATE) * MAX_RATE, correction);
+  TEST_ASSERT_GREATER_THAN_FLOAT(0, correction);
+  run(60, [](float t) { return 20 * t; }, noLoad);
+  TEST_ASSERT_EQUAL_FLOAT(correction, tracker.get_correction());
+
+  // a step of the zero point within the band is caught up at MAX_RATE
+  setUp();
+  run(10, [](float) { return 150.0f; }, noLoad);
+  TEST_ASSERT_FLOAT_WITHIN(1, (10 - WINDOW / (float)FS) * MAX_RATE, tracker.get_correction());
+  run(30, [](float) { return 150.0f; }, noLoad);
+  TEST_ASSERT_FLOAT_WITHIN(1, 150, tracker.get_correction());
+}
+
+static void test_magnitude_is_limited()
+{
+  // a drift beyond MAX_CORRECTION: the correction stops there, and once the readings
+  // leave the band they are a load and tracking ends
+  run(1000, [](float t) { return 3 * t; }, noLoad);
+  TEST_ASSERT_EQUAL_FLOAT(MAX_CORRECTION, tracker.get_correction());
+  setUp();
+  run(1000, [](float t) { return -3 * t; }, noLoad);
+  TEST_ASSERT_EQUAL_FLOAT(-MAX_CORRECTION, tracker.get_correction());
+}
+
+static void test_loads_and_noise_are_not_tracked()
+{
+  // a load beyond the band for an hour
+  run(3600, noLoad, [](float) { return 1.5f * BAND; });
+  TEST_ASSERT_EQUAL_FLOAT(0, tracker.get_correction());
+
+  // the machine vibrates: the deviation is above the limit
+  run(600, [](float) { return 100.0f; }, noLoad, 2 * MAX_STDDEV);
+  TEST_ASSERT_EQUAL_FLOAT(0, tracker.get_correction());
+
+  // a load that comes and goes never keeps the window static
+  run(600, [](float) { return 100.0f; }, [](float t) { return fmodf(t, 2) < 1 ? 0.0f : 3000.0f; });
+  TEST_ASSERT_EQUAL_FLOAT(0, tracker.get_correction());
+
+  // a small load within the band is taken as drift, but no faster than MAX_RATE
+  run(10, noLoad, [](float) { return 100.0f; });
+  TEST_ASSERT_LESS_OR_EQUAL_FLOAT(10 * MAX_RATE, tracker.get_correction());
+}
+
+static void test_hold_and_reference()
+{
+  run(120, [](float) { return 100.0f; }, noLoad);
+  TEST_ASSERT_FLOAT_WITHIN(2, 100, tracker.get_correction());
+
+  // held while the machine moves: nothing changes until a window is full again
+  tracker.hold();
+  run((WINDOW - 1) / (float)FS, [](float) { return 150.0f; }, noLoad);
+  TEST_ASSERT_FLOAT_WITHIN(2, 100, tracker.get_correction());
+  run(20, [](float) { return 150.0f; }, noLoad);
+  TEST_ASSERT_FLOAT_WITHIN(2, 150, tracker.get_correction());
+
+  // a new zero point from the calibration starts over
+  tracker.set_reference(REFERENCE + 150);
+  TEST_ASSERT_EQUAL_FLOAT(0, tracker.get_correction());
+  run(60, [](float) { return 150.0f; }, noLoad);
+  TEST_ASSERT_FLOAT_WITHIN(2, 0, tracker.get_correction());
+}
+
+static void test_fraction_of_a_count_adds_up()
+{
+  // 0.02 counts/s at a zero point of 8 million: every step is a fraction of a count,
+  // far below the float resolution of the zero point itself
+  float worst = run(3 * 3600, [](float t) { return 0.02f * t; }, noLoad, 1);
+  TEST_ASSERT_LESS_THAN_FLOAT(2, worst);
+  TEST_ASSERT_FLOAT_WITHIN(2, 0.02f * 3 * 3600, tracker.get_correction());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_slow_drift_is_followed);
+  RUN_TEST(test_rate_is_limited);
+  RUN_TEST(test_magnitude_is_limited);
+  RUN_TEST(test_loads_and_noise_are_not_tracked);
+  RUN_TEST(test_hold_and_reference);
+  RUN_TEST(test_fraction_of_a_count_adds_up);
+  return UNITY_END();
+}